@@ -0,0 +1,203 @@
+/**
+ * @file    bench-arena.cpp
+ *
+ * @brief   Benchmark of the per-thread ThreadArena against the global
+ *          allocator, as the number of threads grows. Two patterns are run:
+ *
+ *          - local:    each thread allocates a batch of blocks of mixed task
+ *                      sized lengths and frees them again itself, through
+ *                      new and delete, or through its own arena
+ *          - pool:     every thread queues tasks whose closures are too large
+ *                      to be held inside a Task, onto a ThreadPool of as many
+ *                      workers, which run and free them. The closure is either
+ *                      moved to the heap by hand, or left to Task, which
+ *                      takes it from the queueing thread's arena, so that
+ *                      almost every block is freed by another thread.
+ *
+ *          For each, the millions of blocks or tasks per second are shown.
+ *
+ *          Usage: bench-arena [max threads] [operations per thread]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+
+#include "../common/thread-arena.h"
+#include "../common/thread-pool.h"
+
+/// @brief  The clock used for the measurements
+using Clock = std::chrono::steady_clock;
+
+/// @brief  The lengths allocated in turn by the local pattern, as might be
+///         needed by a closure, a small message or a run's shared state
+static constexpr std::array<std::size_t, 4> LENGTHS = { 48, 96, 200, 640 };
+/// @brief  The number of blocks held at once by the local pattern
+static constexpr std::size_t BATCH = 64;
+
+/// @brief  Sink for the results of the tasks, preventing them from being
+///         optimised away
+static std::atomic<unsigned> gSink{ 0 };
+
+/// @brief  A closure too large to be held inside a Task
+struct Payload
+{
+    std::array<unsigned, 24> values{};
+};
+
+/// @brief  Runs a function on the given number of threads at once, returning
+///         the time taken once all have finished
+template<typename F>
+static double runThreads(std::size_t threads, F function)
+{
+    std::atomic<bool> go{ false };
+    std::vector<std::jthread> group;
+    for (std::size_t t = 0; t < threads; ++t)
+    {
+        group.emplace_back([&, t]() {
+            while (!go.load())
+            {
+                std::this_thread::yield();
+            }
+            function(t);
+        });
+    }
+    const auto start = Clock::now();
+    go.store(true);
+    group.clear();
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// @brief  The local pattern
+/// @param  threads     The number of threads
+/// @param  operations  The blocks allocated by each thread
+/// @param  arena       Whether to use the arena, rather than new and delete
+/// @returns    Millions of blocks per second
+static double local(std::size_t threads, int operations, bool arena)
+{
+    const double seconds = runThreads(threads, [&](std::size_t) {
+        std::array<void *, BATCH> blocks{};
+        std::pmr::memory_resource &resource = ThreadArena::local();
+        for (int done = 0; done < operations; done += static_cast<int>(BATCH))
+        {
+            for (std::size_t i = 0; i < BATCH; ++i)
+            {
+                const std::size_t length = LENGTHS[i % LENGTHS.size()];
+                blocks[i] = arena ? resource.allocate(length) : ::operator new(length);
+                static_cast<unsigned char *>(blocks[i])[0] = static_cast<unsigned char>(i);
+            }
+            for (std::size_t i = 0; i < BATCH; ++i)
+            {
+                const std::size_t length = LENGTHS[i % LENGTHS.size()];
+                if (arena)
+                {
+                    resource.deallocate(blocks[i], length);
+                }
+                else
+                {
+                    ::operator delete(blocks[i], length);
+                }
+            }
+        }
+    });
+    return static_cast<double>(threads) * operations / seconds / 1e6;
+}
+
+/// @brief  The pool pattern
+/// @param  threads     The number of queueing threads, and of workers
+/// @param  operations  The tasks queued by each thread
+/// @param  arena       Whether to leave the closure to Task, rather than
+///                     moving it to the heap by hand
+/// @returns    Millions of tasks per second
+static double pool(std::size_t threads, int operations, bool arena)
+{
+    ThreadPool workers(threads);
+    std::atomic<int> remaining{ static_cast<int>(threads) * operations };
+    const auto finish = [&remaining]() {
+        if (remaining.fetch_sub(1) == 1)
+        {
+            remaining.notify_all();
+        }
+    };
+    const auto start = Clock::now();
+    runThreads(threads, [&](std::size_t t) {
+        Payload payload;
+        payload.values[0] = static_cast<unsigned>(t);
+        for (int i = 0; i < operations; ++i)
+        {
+            if (arena)
+            {
+                workers.push(Task([payload, &finish]() {
+                    gSink.fetch_add(payload.values[0], std::memory_order_relaxed);
+                    finish();
+                }));
+            }
+            else
+            {
+                workers.push(Task([payload = std::make_unique<Payload>(payload), &finish]() {
+                    gSink.fetch_add(payload->values[0], std::memory_order_relaxed);
+                    finish();
+                }));
+            }
+        }
+    });
+    int current = remaining.load();
+    while (current != 0)
+    {
+        remaining.wait(current);
+        current = remaining.load();
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(threads) * operations / seconds / 1e6;
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    std::size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    int operations = 1000000;
+    try
+    {
+        if (argc > 1)
+        {
+            maxThreads = std::max<std::size_t>(std::stoul(argv[1]), 1);
+        }
+        if (argc > 2)
+        {
+            operations = std::max(std::stoi(argv[2]), 1);
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Usage: " << argv[0] << " [max threads] [operations per thread]" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::setw(8) << "threads"
+              << std::setw(14) << "local heap"
+              << std::setw(14) << "local arena"
+              << std::setw(14) << "pool heap"
+              << std::setw(14) << "pool arena"
+              << "   (millions per second)" << std::endl;
+    for (std::size_t threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        std::cout << std::setw(8) << threads << std::fixed << std::setprecision(2)
+                  << std::setw(14) << local(threads, operations, false)
+                  << std::setw(14) << local(threads, operations, true)
+                  << std::setw(14) << pool(threads, operations / 4, false)
+                  << std::setw(14) << pool(threads, operations / 4, true)
+                  << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file    bench-channel.cpp
+ *
+ * @brief   Benchmark of streaming values from producers to a single consumer:
+ *          through the single producer Channel, which takes no lock, through
+ *          the many producer Channel, whose senders take turns through a
+ *          mutex, and, as a baseline, through the shared TaskQueue, on which
+ *          the consumer takes the same mutex as every producer. The consumer
+ *          either takes values one at a time or in batches.
+ *
+ *          Each channel holds a limited number of values, so the producers
+ *          are held back to the consumer's pace, whereas the TaskQueue grows
+ *          without limit. For each, the millions of values per second are
+ *          shown.
+ *
+ *          Usage: bench-channel [max producers] [values per producer]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <span>
+#include <stop_token>
+
+#include "../common/channel.h"
+#include "../common/task-queue.h"
+
+/// @brief  The clock used for the measurements
+using Clock = std::chrono::steady_clock;
+
+/// @brief  The number of values each channel holds
+static constexpr std::size_t CAPACITY = 1024;
+/// @brief  The most values the consumer takes at once, when batching
+static constexpr std::size_t BATCH = 64;
+
+/// @brief  Sink for the values received, preventing them from being
+///         optimised away
+static std::atomic<unsigned long> gSink{ 0 };
+
+/// @brief  Runs the producers and the consumer, returning millions of values
+///         per second
+/// @param  producers   The number of producers
+/// @param  values      The values sent by each producer
+/// @param  send        Sends a value
+/// @param  receive     Receives up to out.size() values, returning the number
+template<typename Send, typename Receive>
+static double run(std::size_t producers, int values, Send send, Receive receive)
+{
+    const std::size_t total = producers * static_cast<std::size_t>(values);
+    const auto start = Clock::now();
+    {
+        std::jthread consumer([&]() {
+            std::array<unsigned, BATCH> out{};
+            unsigned long sum = 0;
+            for (std::size_t received = 0; received < total;)
+            {
+                const std::size_t count = receive(std::span<unsigned>(out));
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    sum += out[i];
+                }
+                received += count;
+            }
+            gSink.fetch_add(sum, std::memory_order_relaxed);
+        });
+        std::vector<std::jthread> group;
+        for (std::size_t p = 0; p < producers; ++p)
+        {
+            group.emplace_back([&]() {
+                for (int i = 0; i < values; ++i)
+                {
+                    send(static_cast<unsigned>(i));
+                }
+            });
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return static_cast<double>(total) / seconds / 1e6;
+}
+
+/// @brief  Runs a channel, taking one value or a batch at a time
+template<ChannelKind KIND>
+static double runChannel(std::size_t producers, int values, bool batch)
+{
+    Channel<unsigned, KIND> channel(CAPACITY);
+    return run(producers, values,
+        [&](unsigned value) { channel.send(value); },
+        [&](std::span<unsigned> out) -> std::size_t {
+            if (batch)
+            {
+                return channel.recvUpTo(out);
+            }
+            out[0] = *channel.recv();
+            return 1;
+        });
+}
+
+/// @brief  Runs the shared TaskQueue, taking one value or a batch at a time
+static double runQueue(std::size_t producers, int values, bool batch)
+{
+    TaskQueue<unsigned> queue;
+    const std::stop_token token;
+    return run(producers, values,
+        [&](unsigned value) { queue.push(value); },
+        [&](std::span<unsigned> out) {
+            return queue.popUpTo(batch ? out : out.first(1), token, true);
+        });
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    std::size_t maxProducers = std::max(1u, std::thread::hardware_concurrency());
+    int values = 2000000;
+    try
+    {
+        if (argc > 1)
+        {
+            maxProducers = std::max<std::size_t>(std::stoul(argv[1]), 1);
+        }
+        if (argc > 2)
+        {
+            values = std::max(std::stoi(argv[2]), 1);
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Usage: " << argv[0] << " [max producers] [values per producer]" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::setw(10) << "producers"
+              << std::setw(8) << "take"
+              << std::setw(10) << "spsc"
+              << std::setw(10) << "mpsc"
+              << std::setw(10) << "queue"
+              << "   (millions per second)" << std::endl;
+    for (std::size_t producers = 1; producers <= maxProducers; producers *= 2)
+    {
+        for (const bool batch : { false, true })
+        {
+            std::cout << std::setw(10) << producers
+                      << std::setw(8) << (batch ? "batch" : "single")
+                      << std::fixed << std::setprecision(2);
+            // The single producer channel only takes one producer
+            if (producers == 1)
+            {
+                std::cout << std::setw(10) << runChannel<ChannelKind::SPSC>(producers, values, batch);
+            }
+            else
+            {
+                std::cout << std::setw(10) << "-";
+            }
+            std::cout << std::setw(10) << runChannel<ChannelKind::MPSC>(producers, values, batch)
+                      << std::setw(10) << runQueue(producers, values, batch)
+                      << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file    bench-layout.cpp
+ *
+ * @brief   Benchmark of the shared state of the pools under contention, with
+ *          event counters, to show the cost of false sharing between values
+ *          written by different threads. Each run passes tiny tasks through:
+ *
+ *          - shared:   the batched TaskQueue of example 7
+ *          - steal:    the WorkStealingPool of example 7
+ *          - pool:     the ThreadPool of example 9
+ *
+ *          The counters come from perf_event_open(). Hardware counters, such
+ *          as cache misses, are only shown where the machine provides them,
+ *          which most virtual machines do not, and false sharing needs more
+ *          than one core to appear at all.
+ *
+ *          Usage: bench-layout [threads] [tasks]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+#include "perf-counters.h"
+#include "../common/task-queue.h"
+#include "../common/thread-pool.h"
+#include "../common/work-stealing-pool.h"
+
+/// @brief  The clock used for the measurements
+using Clock = std::chrono::steady_clock;
+
+/// @brief  The number of tasks queued at once by the producer
+static constexpr int BATCH = 64;
+
+/// @brief  Runs the tasks through the shared queue
+static void runShared(int threads, int tasks)
+{
+    TaskQueue<int> queue;
+    std::atomic<int> done{ 0 };
+    std::vector<std::jthread> workers;
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&](std::stop_token token) {
+            int batch[16];
+            std::size_t count = 0;
+            while ((count = queue.popUpTo(std::span<int>(batch), token, true)) > 0)
+            {
+                done.fetch_add(static_cast<int>(count), std::memory_order_relaxed);
+            }
+        });
+    }
+    std::vector<int> items(BATCH, 1);
+    for (int sent = 0; sent < tasks; sent += BATCH)
+    {
+        queue.pushBulk(items);
+    }
+    while (done.load() < tasks)
+    {
+        std::this_thread::yield();
+    }
+}
+
+/// @brief  Runs the tasks through the work stealing pool
+static void runSteal(int threads, int tasks)
+{
+    WorkStealingPool<int> pool(threads);
+    std::atomic<int> done{ 0 };
+    std::vector<std::jthread> workers;
+    for (int i = 0; i < threads; ++i)
+    {
+        workers.emplace_back([&, slot = pool.attach()](std::stop_token token) {
+            int batch[16];
+            std::size_t count = 0;
+            while ((count = pool.popUpTo(slot, std::span<int>(batch), token, true)) > 0)
+            {
+                done.fetch_add(static_cast<int>(count), std::memory_order_relaxed);
+            }
+        });
+    }
+    std::vector<int> items(BATCH, 1);
+    for (int sent = 0; sent < tasks; sent += BATCH)
+    {
+        pool.pushBulk(items);
+    }
+    while (done.load() < tasks)
+    {
+        std::this_thread::yield();
+    }
+}
+
+/// @brief  Runs the tasks through the thread pool
+static void runPool(int threads, int tasks)
+{
+    std::atomic<int> done{ 0 };
+    ThreadPool pool(threads);
+    for (int sent = 0; sent < tasks; ++sent)
+    {
+        pool.push(Task([&done]() { done.fetch_add(1, std::memory_order_relaxed); }));
+    }
+    while (done.load() < tasks)
+    {
+        std::this_thread::yield();
+    }
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    int threads = 4;
+    int tasks = 1000000;
+    try
+    {
+        if (argc > 1)
+        {
+            threads = std::stoi(argv[1]);
+        }
+        if (argc > 2)
+        {
+            tasks = std::stoi(argv[2]);
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Usage: " << argv[0] << " [threads] [tasks]" << std::endl;
+        return 1;
+    }
+
+    struct Scenario
+    {
+        const char *name;
+        std::function<void(int, int)> run;
+    };
+    const Scenario SCENARIOS[] = {
+        { "shared", runShared },
+        { "steal", runSteal },
+        { "pool", runPool },
+    };
+
+    std::cout << "Threads: " << threads << ", tasks per run: " << tasks << std::endl;
+    for (const Scenario &scenario : SCENARIOS)
+    {
+        PerfCounters counters;
+        const auto start = Clock::now();
+        counters.start();
+        scenario.run(threads, tasks);
+        const std::vector<PerfCounters::Reading> readings = counters.stop();
+        const std::chrono::duration<double> taken = Clock::now() - start;
+        std::cout << std::setw(8) << scenario.name
+                  << std::setw(14) << std::fixed << std::setprecision(0)
+                  << tasks / taken.count() << " tasks/s";
+        for (const PerfCounters::Reading &reading : readings)
+        {
+            std::cout << " | " << reading.name << " ";
+            if (reading.available)
+            {
+                std::cout << reading.value;
+            }
+            else
+            {
+                std::cout << "n/a";
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file    bench-log.cpp
+ *
+ * @brief   Benchmark comparing the cost of a log line through the original
+ *          LOG/DOT macros (a std::stringstream built colour, then std::cout
+ *          with std::endl) against the asynchronous logger, as the number of
+ *          logging threads grows.
+ *
+ *          The log lines themselves go to stdout and the results to stderr,
+ *          so run with stdout redirected, e.g. bench-log > /dev/null
+ *
+ *          Usage: bench-log [lines per thread] [max threads]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "../common/async-log.h"
+
+/// @brief  The colour code prefix
+static const std::string COL_PRE = "\033[1;";
+/// @brief  The colour code suffix
+static const std::string COL_SUF = "m";
+/// @brief  Colour code to return to normal
+static const std::string COL_NORM = "\033[0m";
+
+/// @brief  The original colour helper, as used by the examples
+std::string getColour(int col)
+{
+    std::stringstream ss;
+    ss << COL_PRE << std::to_string(col) << COL_SUF;
+    return ss.str();
+}
+
+/// @brief  The original log macro, as used by the examples
+#define COUT_LOG(col, name, msg)    std::cout << getColour(col) << name << ": " << \
+                                    msg << COL_NORM << std::endl;
+
+/// @brief  Runs the given number of log lines on each thread
+/// @param  threadCount The number of logging threads
+/// @param  lines       The number of lines logged by each thread
+/// @param  useAsync    Whether to use the asynchronous logger
+/// @returns    The average time per line, in nanoseconds
+static double run(int threadCount, int lines, bool useAsync)
+{
+    const std::string name = "Worker";
+    const auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<std::jthread> threads;
+        for (int t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back([&, t]() {
+                for (int i = 0; i < lines; ++i)
+                {
+                    const int code = COL_RED.code() + t % 6;
+                    if (useAsync)
+                    {
+                        LOG(Colour(code), name, "Doing action with ID: " << i);
+                    }
+                    else
+                    {
+                        COUT_LOG(code, name, "Doing action with ID: " << i);
+                    }
+                }
+            });
+        }
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / lines;
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    int lines = 100000;
+    int maxThreads = std::max(8, static_cast<int>(std::thread::hardware_concurrency()));
+    try
+    {
+        if (argc > 1)
+        {
+            lines = std::stoi(argv[1]);
+        }
+        if (argc > 2)
+        {
+            maxThreads = std::stoi(argv[2]);
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Usage: " << argv[0] << " [lines per thread] [max threads]" << std::endl;
+        return 1;
+    }
+
+    std::cerr << "Lines per thread: " << lines << std::endl;
+    std::cerr << std::setw(8) << "threads"
+              << std::setw(20) << "cout ns/line"
+              << std::setw(20) << "async ns/line" << std::endl;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        const double cout = run(threads, lines, false);
+        const double async = run(threads, lines, true);
+        std::cerr << std::setw(8) << threads << std::fixed << std::setprecision(1)
+                  << std::setw(20) << cout
+                  << std::setw(20) << async << std::endl;
+    }
+
+    return 0;
+}
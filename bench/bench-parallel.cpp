@@ -0,0 +1,172 @@
+/**
+ * @file    bench-parallel.cpp
+ *
+ * @brief   Benchmark of parallelFor() and parallelReduce() on a ThreadPool,
+ *          scaling from one worker to every core. Two loops are run:
+ *
+ *          - primes:   counts the primes below a limit, with the work per
+ *                      index growing along the range, by parallelReduce()
+ *          - scale:    scales a large array in place, bound by memory rather
+ *                      than compute, by parallelFor()
+ *
+ *          For each pool size, the time taken and the speed-up over a plain
+ *          loop on one thread are shown, along with how long a loop took to
+ *          return once a stop was requested part way through.
+ *
+ *          Usage: bench-parallel [max workers] [prime limit]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stop_token>
+#include <functional>
+#include <optional>
+#include <algorithm>
+
+#include "../common/parallel-for.h"
+
+/// @brief  The clock used for the measurements
+using Clock = std::chrono::steady_clock;
+
+/// @brief  The number of elements in the scaled array
+static constexpr std::size_t ARRAY_SIZE = 1 << 24;
+
+/// @brief  Whether a number is prime
+static bool isPrime(int n)
+{
+    if (n < 2)
+    {
+        return false;
+    }
+    for (int d = 2; d * d <= n; ++d)
+    {
+        if (n % d == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief  Counts the primes in a range
+static long countPrimes(int first, int last)
+{
+    long count = 0;
+    for (int n = first; n < last; ++n)
+    {
+        count += isPrime(n) ? 1 : 0;
+    }
+    return count;
+}
+
+/// @brief  Times a callable, in milliseconds
+template<typename F>
+static double timeMs(F &&f)
+{
+    const auto start = Clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/// @brief  Times how long a long loop takes to return once stopped
+/// @param  pool    The pool to run the loop on
+/// @returns    The time from the stop request to the loop returning, in ms
+static double stopLatencyMs(ThreadPool &pool)
+{
+    std::stop_source source;
+    std::atomic<Clock::rep> requested{ 0 };
+    std::jthread stopper([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        requested.store(Clock::now().time_since_epoch().count());
+        source.request_stop();
+    });
+    // Far more work than can be done before the stop
+    parallelFor(pool, 0, 1 << 30, 256, [](int first, int last) {
+        volatile long sink = countPrimes(first % 100000, first % 100000 + (last - first));
+        (void)sink;
+    }, source.get_token());
+    const auto returned = Clock::now();
+    stopper.join();
+    return std::chrono::duration<double, std::milli>(
+        returned - Clock::time_point(Clock::duration(requested.load()))).count();
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    std::size_t maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+    int limit = 5000000;
+    try
+    {
+        if (argc > 1)
+        {
+            maxWorkers = std::stoul(argv[1]);
+        }
+        if (argc > 2)
+        {
+            limit = std::stoi(argv[2]);
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Usage: " << argv[0] << " [max workers] [prime limit]" << std::endl;
+        return 1;
+    }
+
+    // The plain loops on one thread, as the baseline
+    long expected = 0;
+    const double serialPrimes = timeMs([&]() { expected = countPrimes(0, limit); });
+    std::vector<float> values(ARRAY_SIZE, 1.0f);
+    const double serialScale = timeMs([&]() {
+        for (float &value : values)
+        {
+            value *= 1.0001f;
+        }
+    });
+
+    std::cout << "Primes below " << limit << ": " << expected << ", " << ARRAY_SIZE <<
+        " floats scaled" << std::endl;
+    std::cout << "Serial: primes " << std::fixed << std::setprecision(1) << serialPrimes <<
+        " ms, scale " << serialScale << " ms" << std::endl;
+    std::cout << std::setw(8) << "workers"
+              << std::setw(12) << "primes ms"
+              << std::setw(10) << "speed-up"
+              << std::setw(12) << "scale ms"
+              << std::setw(10) << "speed-up"
+              << std::setw(12) << "stop ms" << std::endl;
+    for (std::size_t workers = 1; workers <= maxWorkers; ++workers)
+    {
+        ThreadPool pool(workers);
+        std::optional<long> primes;
+        const double parallelPrimes = timeMs([&]() {
+            primes = parallelReduce(pool, 0, limit, 0, 0L, countPrimes, std::plus<long>());
+        });
+        if (primes != expected)
+        {
+            std::cerr << "Wrong prime count: " << primes.value_or(-1) << std::endl;
+            return 1;
+        }
+        const double parallelScale = timeMs([&]() {
+            parallelFor(pool, std::size_t{ 0 }, values.size(), 0, [&values](std::size_t i) {
+                values[i] *= 1.0001f;
+            });
+        });
+        std::cout << std::setw(8) << workers
+                  << std::setw(12) << parallelPrimes
+                  << std::setw(10) << std::setprecision(2) << serialPrimes / parallelPrimes
+                  << std::setw(12) << std::setprecision(1) << parallelScale
+                  << std::setw(10) << std::setprecision(2) << serialScale / parallelScale
+                  << std::setw(12) << std::setprecision(1) << stopLatencyMs(pool)
+                  << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,315 @@
+/**
+ * @file    bench-pool.cpp
+ *
+ * @brief   Throughput benchmark comparing the single shared queue used by the
+ *          example 7 thread pool (one std::mutex, one std::queue and one
+ *          std::condition_variable_any) against the batched TaskQueue, the work
+ *          stealing pool and the lock-free bounded queue, as the number of
+ *          worker threads grows. Other than the original shared queue, which
+ *          is kept one item at a time as the baseline, tasks are added and
+ *          taken in batches of the given size.
+ *
+ *          Usage: bench-pool [tasks] [max threads] [batch]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <span>
+
+#include "../common/mpmc-queue.h"
+#include "../common/task-queue.h"
+#include "../common/work-stealing-pool.h"
+
+/// @brief  Sink for the results of the busy work, preventing it from being
+///         optimised away
+static std::atomic<unsigned> gSink{ 0 };
+
+/// @brief  A small amount of CPU bound work, standing in for a real task
+/// @param  value   The task value
+static void doWork(int value)
+{
+    unsigned x = static_cast<unsigned>(value);
+    for (int i = 0; i < 200; ++i)
+    {
+        x = x * 1664525u + 1013904223u;
+    }
+    gSink.fetch_add(x & 1u, std::memory_order_relaxed);
+}
+
+/// @brief  Counts completed tasks, waking the producer on the last one
+/// @param  done    The completion counter
+/// @param  tasks   The total number of tasks
+static void taskDone(std::atomic<int> &done, int tasks)
+{
+    if (done.fetch_add(1) + 1 == tasks)
+    {
+        done.notify_all();
+    }
+}
+
+/// @brief  Blocks until all tasks have completed
+/// @param  done    The completion counter
+/// @param  tasks   The total number of tasks
+static void waitForAll(std::atomic<int> &done, int tasks)
+{
+    int current = done.load();
+    while (current < tasks)
+    {
+        done.wait(current);
+        current = done.load();
+    }
+}
+
+/// @brief  Adds all of the tasks to a queue, in batches
+/// @param  queue   The queue, or anything else with pushBulk()
+/// @param  tasks   The number of tasks
+/// @param  batch   The number of tasks added at once
+template<typename Queue>
+static void produce(Queue &queue, int tasks, std::size_t batch)
+{
+    std::vector<int> items;
+    items.reserve(batch);
+    for (int i = 0; i < tasks; ++i)
+    {
+        items.push_back(i);
+        if (items.size() == batch || i + 1 == tasks)
+        {
+            queue.pushBulk(std::span<int>(items));
+            items.clear();
+        }
+    }
+}
+
+/// @brief  Runs the tasks through the shared queue, as example 7 originally
+///         did, one item per lock and one notification per item
+/// @param  threadCount The number of workers
+/// @param  tasks       The number of tasks to run
+/// @returns    Tasks completed per second
+static double runShared(int threadCount, int tasks)
+{
+    std::queue<int> queue;
+    std::mutex mutex;
+    std::condition_variable_any cv;
+    std::atomic<int> done{ 0 };
+
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([&](std::stop_token token) {
+            while (true)
+            {
+                int value = 0;
+                {
+                    std::unique_lock lock(mutex);
+                    if (!cv.wait(lock, token, [&]() { return !queue.empty(); }))
+                    {
+                        break;
+                    }
+                    value = queue.front();
+                    queue.pop();
+                }
+                doWork(value);
+                taskDone(done, tasks);
+            }
+        });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < tasks; ++i)
+    {
+        std::unique_lock lock(mutex);
+        queue.push(i);
+        cv.notify_one();
+    }
+    waitForAll(done, tasks);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    for (auto &thread : threads)
+    {
+        thread.request_stop();
+    }
+    return tasks / elapsed.count();
+}
+
+/// @brief  Runs the tasks through the batched shared TaskQueue
+/// @param  threadCount The number of workers
+/// @param  tasks       The number of tasks to run
+/// @param  batch       The number of tasks added and taken at once
+/// @returns    Tasks completed per second
+static double runTaskQueue(int threadCount, int tasks, std::size_t batch)
+{
+    TaskQueue<int> queue;
+    std::atomic<int> done{ 0 };
+
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([&](std::stop_token token) {
+            std::vector<int> items(batch);
+            std::size_t count = 0;
+            while ((count = queue.popUpTo(items, token, true)) > 0)
+            {
+                for (std::size_t j = 0; j < count; ++j)
+                {
+                    doWork(items[j]);
+                    taskDone(done, tasks);
+                }
+            }
+        });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    produce(queue, tasks, batch);
+    waitForAll(done, tasks);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    for (auto &thread : threads)
+    {
+        thread.request_stop();
+    }
+    return tasks / elapsed.count();
+}
+
+/// @brief  Runs the tasks through the work stealing pool
+/// @param  threadCount The number of workers
+/// @param  tasks       The number of tasks to run
+/// @param  batch       The number of tasks added and taken at once
+/// @returns    Tasks completed per second
+static double runStealing(int threadCount, int tasks, std::size_t batch)
+{
+    WorkStealingPool<int> pool(threadCount);
+    std::atomic<int> done{ 0 };
+
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([&, slot = pool.attach()](std::stop_token token) {
+            std::vector<int> items(batch);
+            std::size_t count = 0;
+            while ((count = pool.popUpTo(slot, items, token, true)) > 0)
+            {
+                for (std::size_t j = 0; j < count; ++j)
+                {
+                    doWork(items[j]);
+                    taskDone(done, tasks);
+                }
+            }
+        });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    produce(pool, tasks, batch);
+    waitForAll(done, tasks);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    for (auto &thread : threads)
+    {
+        thread.request_stop();
+    }
+    return tasks / elapsed.count();
+}
+
+/// @brief  Runs the tasks through the lock-free bounded queue
+/// @param  threadCount The number of workers
+/// @param  tasks       The number of tasks to run
+/// @param  batch       The number of tasks added and taken at once
+/// @returns    Tasks completed per second
+static double runLockFree(int threadCount, int tasks, std::size_t batch)
+{
+    BoundedMpmcQueue<int> queue(4096);
+    std::atomic<int> done{ 0 };
+
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([&](std::stop_token token) {
+            std::vector<int> items(batch);
+            std::size_t count = 0;
+            while ((count = queue.popUpTo(items, token, true)) > 0)
+            {
+                for (std::size_t j = 0; j < count; ++j)
+                {
+                    doWork(items[j]);
+                    taskDone(done, tasks);
+                }
+            }
+        });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    produce(queue, tasks, batch);
+    waitForAll(done, tasks);
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    for (auto &thread : threads)
+    {
+        thread.request_stop();
+    }
+    return tasks / elapsed.count();
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    int tasks = 200000;
+    int maxThreads = std::max(32, static_cast<int>(std::thread::hardware_concurrency()));
+    std::size_t batch = 16;
+    try
+    {
+        if (argc > 1)
+        {
+            tasks = std::stoi(argv[1]);
+        }
+        if (argc > 2)
+        {
+            maxThreads = std::stoi(argv[2]);
+        }
+        if (argc > 3)
+        {
+            batch = std::max<std::size_t>(1, std::stoul(argv[3]));
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Usage: " << argv[0] << " [tasks] [max threads] [batch]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Tasks per run: " << tasks << ", batch size: " << batch
+              << std::endl;
+    std::cout << std::setw(8) << "threads"
+              << std::setw(16) << "shared tasks/s"
+              << std::setw(16) << "batched tasks/s"
+              << std::setw(16) << "steal tasks/s"
+              << std::setw(18) << "lockfree tasks/s" << std::endl;
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        const double shared = runShared(threads, tasks);
+        const double batched = runTaskQueue(threads, tasks, batch);
+        const double stealing = runStealing(threads, tasks, batch);
+        const double lockFree = runLockFree(threads, tasks, batch);
+        std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0)
+                  << std::setw(16) << shared
+                  << std::setw(16) << batched
+                  << std::setw(16) << stealing
+                  << std::setw(18) << lockFree << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file    bench-restart.cpp
+ *
+ * @brief   Benchmark of restarting a worker many times, as the workers of
+ *          examples 5 and 6 are, comparing a new std::jthread for every run
+ *          against a RecycledThread, which reuses a parked thread from the
+ *          ThreadCache. Two shapes of job are run:
+ *
+ *          - short:    the job returns straight away, and is joined
+ *          - stopped:  the job waits on its stop token, and is stopped and
+ *                      joined once it has started
+ *
+ *          For each, the number of start-stop-join cycles per second, and the
+ *          p50/p99 time from starting to the job running, are shown.
+ *
+ *          Usage: bench-restart [cycles]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+
+#include "../common/thread-cache.h"
+
+/// @brief  The clock used for the measurements
+using Clock = std::chrono::steady_clock;
+
+/// @brief  The results of one thread type and job shape
+struct Result
+{
+    /// @brief  Cycles per second
+    double rate = 0.0;
+    /// @brief  Start-to-running latencies in us, sorted
+    std::vector<double> latencies;
+};
+
+/// @brief  Runs the cycles with the given thread type
+/// @tparam Thread  std::jthread or RecycledThread
+/// @param  cycles  The number of start-stop-join cycles
+/// @param  stopped Whether each job waits to be stopped
+template<typename Thread>
+static Result measure(int cycles, bool stopped)
+{
+    Result result;
+    result.latencies.reserve(cycles);
+    std::atomic<Clock::rep> running{ 0 };
+    const auto start = Clock::now();
+    for (int i = 0; i < cycles; ++i)
+    {
+        running.store(0);
+        const auto begin = Clock::now();
+        Thread thread([&running, stopped](std::stop_token token) {
+            running.store(Clock::now().time_since_epoch().count());
+            running.notify_one();
+            if (stopped)
+            {
+                std::mutex mutex;
+                std::condition_variable_any cv;
+                std::unique_lock lock(mutex);
+                cv.wait(lock, token, []() { return false; });
+            }
+        });
+        running.wait(0);
+        const std::chrono::duration<double, std::micro> latency =
+            Clock::time_point(Clock::duration(running.load())) - begin;
+        result.latencies.push_back(latency.count());
+        thread.request_stop();
+        thread.join();
+    }
+    const std::chrono::duration<double> taken = Clock::now() - start;
+    result.rate = cycles / taken.count();
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+}
+
+/// @brief  Gets a percentile from sorted values
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    return sorted[static_cast<std::size_t>(p * (sorted.size() - 1))];
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    int cycles = 20000;
+    if (argc > 1)
+    {
+        try
+        {
+            cycles = std::stoi(argv[1]);
+        }
+        catch (const std::exception &)
+        {
+            std::cerr << "Usage: " << argv[0] << " [cycles]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Cycles per run: " << cycles << std::endl;
+    std::cout << std::setw(10) << "job"
+              << std::setw(10) << "thread"
+              << std::setw(14) << "cycles/s"
+              << std::setw(12) << "start p50"
+              << std::setw(12) << "start p99" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    for (const bool stopped : { false, true })
+    {
+        const Result results[] = {
+            measure<std::jthread>(cycles, stopped),
+            measure<RecycledThread>(cycles, stopped),
+        };
+        const char *names[] = { "jthread", "recycled" };
+        for (int i = 0; i < 2; ++i)
+        {
+            std::cout << std::setw(10) << (stopped ? "stopped" : "short")
+                      << std::setw(10) << names[i]
+                      << std::setw(14) << results[i].rate
+                      << std::setw(12) << percentile(results[i].latencies, 0.5)
+                      << std::setw(12) << percentile(results[i].latencies, 0.99)
+                      << std::endl;
+        }
+    }
+    std::cout << "Threads created by the cache: " << ThreadCache::instance().created()
+              << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file    bench-setdata.cpp
+ *
+ * @brief   Benchmark of the example 6 setData() path, comparing the original
+ *          mutex and condition variable DataSignal against the lock-free
+ *          std::atomic specialisation.
+ *
+ *          Two things are measured for each. The first is the rate at which
+ *          setData() can be called with values that do not meet the target,
+ *          while the worker waits. The second is the wake-up latency, from
+ *          setting the target value until the worker sees it.
+ *
+ *          Usage: bench-setdata [updates] [wake-ups]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+
+#include "../common/data-signal.h"
+
+using namespace std::chrono_literals;
+
+/// @brief  The clock used for the measurements
+using Clock = std::chrono::steady_clock;
+
+/// @brief  The rate of updates that do not complete the worker's task
+/// @param  updates The number of updates to make
+/// @returns    The number of setData() calls per second
+template<bool ATOMIC>
+static double updateRate(int updates)
+{
+    static const int TARGET = -1;
+    DataSignal<int, ATOMIC> signal(0);
+    const auto complete = [](const int &value) { return value == TARGET; };
+
+    std::jthread worker([&](std::stop_token token) {
+        signal.wait(token, complete);
+    });
+    std::this_thread::sleep_for(10ms);
+
+    const auto start = Clock::now();
+    for (int i = 0; i < updates; ++i)
+    {
+        signal.set(i, complete);
+    }
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    signal.set(TARGET, complete);
+    return updates / elapsed.count();
+}
+
+/// @brief  The time taken for the worker to wake once the target is set
+/// @param  wakes   The number of wake-ups to measure
+/// @returns    The latency of each wake-up, in microseconds, sorted
+template<bool ATOMIC>
+static std::vector<double> wakeLatency(int wakes)
+{
+    DataSignal<int, ATOMIC> signal(-1);
+    std::atomic<Clock::time_point> setAt{ Clock::time_point() };
+    std::vector<double> latencies;
+    latencies.reserve(wakes);
+    std::atomic<int> woken{ -1 };
+
+    std::jthread worker([&](std::stop_token token) {
+        for (int i = 0; i < wakes; ++i)
+        {
+            if (!signal.wait(token, [i](const int &value) { return value == i; }))
+            {
+                return;
+            }
+            const std::chrono::duration<double, std::micro> latency =
+                Clock::now() - setAt.load();
+            latencies.push_back(latency.count());
+            woken.store(i);
+            woken.notify_one();
+        }
+    });
+
+    for (int i = 0; i < wakes; ++i)
+    {
+        // Let the worker get back to sleep before the next wake-up
+        std::this_thread::sleep_for(200us);
+        setAt.store(Clock::now());
+        signal.set(i, [i](const int &value) { return value == i; });
+        int seen = woken.load();
+        while (seen != i)
+        {
+            woken.wait(seen);
+            seen = woken.load();
+        }
+    }
+    worker.join();
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+/// @brief  Gets a percentile from sorted values
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    const std::size_t index = static_cast<std::size_t>(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    int updates = 2000000;
+    int wakes = 2000;
+    try
+    {
+        if (argc > 1)
+        {
+            updates = std::stoi(argv[1]);
+        }
+        if (argc > 2)
+        {
+            wakes = std::stoi(argv[2]);
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Usage: " << argv[0] << " [updates] [wake-ups]" << std::endl;
+        return 1;
+    }
+
+    const double lockedRate = updateRate<false>(updates);
+    const double atomicRate = updateRate<true>(updates);
+    const std::vector<double> lockedWake = wakeLatency<false>(wakes);
+    const std::vector<double> atomicWake = wakeLatency<true>(wakes);
+
+    std::cout << std::setw(10) << "signal"
+              << std::setw(16) << "setData/s"
+              << std::setw(14) << "wake p50 us"
+              << std::setw(14) << "wake p99 us" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::setw(10) << "mutex+cv"
+              << std::setw(16) << std::setprecision(0) << lockedRate
+              << std::setw(14) << std::setprecision(1) << percentile(lockedWake, 0.5)
+              << std::setw(14) << percentile(lockedWake, 0.99) << std::endl;
+    std::cout << std::setw(10) << "atomic"
+              << std::setw(16) << std::setprecision(0) << atomicRate
+              << std::setw(14) << std::setprecision(1) << percentile(atomicWake, 0.5)
+              << std::setw(14) << percentile(atomicWake, 0.99) << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,237 @@
+/**
+ * @file    bench-stop.cpp
+ *
+ * @brief   Benchmark of the time from requesting a stop to the thread having
+ *          been joined, for each of the shutdown patterns used across the
+ *          examples, as the number of threads grows:
+ *
+ *          - poll:      request_stop() with a loop polling the token between
+ *                       1ms sleeps                                (ex2, ex3)
+ *          - sleep:     the same loop using interruptibleSleep()  (ex2, ex3)
+ *          - callback:  a std::stop_callback calling notify_all() on a
+ *                       std::condition_variable                   (ex4, ex6)
+ *          - cv_any:    std::condition_variable_any::wait(lock, token, pred)
+ *                                                                 (ex7)
+ *
+ *          For each, every thread is stopped and joined one at a time while
+ *          the others remain waiting, giving the p50/p99/p999 latency of a
+ *          single stop. The time taken to stop the whole group at once, by
+ *          requesting every stop and then joining every thread, is also shown.
+ *          Note that thousands of threads polling every millisecond will keep
+ *          a machine with few cores busy, so the poll pattern takes far longer
+ *          than the others to measure there. A third argument runs only the
+ *          named pattern.
+ *
+ *          Usage: bench-stop [max threads] [samples] [pattern]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+
+#include "../common/interruptible-sleep.h"
+
+using namespace std::chrono_literals;
+
+/// @brief  The clock used for the measurements
+using Clock = std::chrono::steady_clock;
+
+/// @brief  Polls the token between plain sleeps, as example 2 first did
+static void pollWorker(std::stop_token token)
+{
+    while (!token.stop_requested())
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+}
+
+/// @brief  Polls the token between sleeps that end when a stop is requested
+static void sleepWorker(std::stop_token token)
+{
+    while (!token.stop_requested())
+    {
+        interruptibleSleep(token, 1s);
+    }
+}
+
+/// @brief  Waits on a std::condition_variable, woken by a stop callback
+static void callbackWorker(std::stop_token token)
+{
+    std::mutex mutex;
+    std::condition_variable cv;
+    // Taking the lock in the callback ensures the notification cannot fall
+    // between the waiter checking the token and going to sleep
+    std::stop_callback stop(token, [&]() {
+        std::lock_guard lock(mutex);
+        cv.notify_all();
+    });
+    std::unique_lock lock(mutex);
+    cv.wait(lock, [&]() { return token.stop_requested(); });
+}
+
+/// @brief  Waits on a std::condition_variable_any, with the token passed in
+static void cvAnyWorker(std::stop_token token)
+{
+    std::mutex mutex;
+    std::condition_variable_any cv;
+    std::unique_lock lock(mutex);
+    cv.wait(lock, token, []() { return false; });
+}
+
+/// @brief  The results for one pattern and thread count
+struct Result
+{
+    /// @brief  The stop-to-join latencies of single threads, sorted
+    std::vector<double> latencies;
+    /// @brief  The average time to stop and join all of the threads at once
+    double allMs = 0.0;
+};
+
+/// @brief  Starts a group of threads, and waits until they have all started
+/// @param  count   The number of threads
+/// @param  worker  The thread function
+static std::vector<std::jthread> startGroup(int count, void (*worker)(std::stop_token))
+{
+    std::atomic<int> started{ 0 };
+    std::vector<std::jthread> group;
+    group.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        group.emplace_back([&started, worker](std::stop_token token) {
+            started.fetch_add(1);
+            worker(token);
+        });
+    }
+    while (started.load() < count)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    // Give the last threads time to reach their wait
+    std::this_thread::sleep_for(20ms);
+    return group;
+}
+
+/// @brief  Measures one pattern at one thread count
+/// @param  threads The number of threads in the group
+/// @param  samples The least number of single stops to measure
+/// @param  worker  The thread function
+static Result measure(int threads, int samples, void (*worker)(std::stop_token))
+{
+    Result result;
+    const int rounds = std::max(1, (samples + threads - 1) / threads);
+    result.latencies.reserve(static_cast<std::size_t>(rounds) * threads);
+    for (int round = 0; round < rounds; ++round)
+    {
+        std::vector<std::jthread> group = startGroup(threads, worker);
+        for (auto &thread : group)
+        {
+            const auto start = Clock::now();
+            thread.request_stop();
+            thread.join();
+            const std::chrono::duration<double, std::micro> latency = Clock::now() - start;
+            result.latencies.push_back(latency.count());
+        }
+    }
+
+    // Stopping the whole group at once, as a pool would on shutdown
+    const int groupRounds = std::min(rounds, 10);
+    for (int round = 0; round < groupRounds; ++round)
+    {
+        std::vector<std::jthread> group = startGroup(threads, worker);
+        const auto start = Clock::now();
+        for (auto &thread : group)
+        {
+            thread.request_stop();
+        }
+        group.clear();
+        const std::chrono::duration<double, std::milli> taken = Clock::now() - start;
+        result.allMs += taken.count() / groupRounds;
+    }
+
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+}
+
+/// @brief  Gets a percentile from sorted values
+static double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    return sorted[static_cast<std::size_t>(p * (sorted.size() - 1))];
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    int maxThreads = 4096;
+    int samples = 2000;
+    const std::string only = (argc > 3) ? argv[3] : "";
+    try
+    {
+        if (argc > 1)
+        {
+            maxThreads = std::stoi(argv[1]);
+        }
+        if (argc > 2)
+        {
+            samples = std::stoi(argv[2]);
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Usage: " << argv[0] << " [max threads] [samples] [pattern]" << std::endl;
+        return 1;
+    }
+
+    struct Pattern
+    {
+        const char *name;
+        void (*worker)(std::stop_token);
+    };
+    static const Pattern PATTERNS[] = {
+        { "poll", pollWorker },
+        { "sleep", sleepWorker },
+        { "callback", callbackWorker },
+        { "cv_any", cvAnyWorker },
+    };
+
+    std::cout << "Latencies of a single stop in us, of stopping all in ms" << std::endl;
+    std::cout << std::setw(10) << "pattern"
+              << std::setw(9) << "threads"
+              << std::setw(10) << "p50"
+              << std::setw(10) << "p99"
+              << std::setw(10) << "p999"
+              << std::setw(12) << "all" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    for (const Pattern &pattern : PATTERNS)
+    {
+        if (!only.empty() && only != pattern.name)
+        {
+            continue;
+        }
+        for (int threads = 1; threads <= maxThreads; threads *= 16)
+        {
+            const Result result = measure(threads, samples, pattern.worker);
+            std::cout << std::setw(10) << pattern.name
+                      << std::setw(9) << threads
+                      << std::setw(10) << percentile(result.latencies, 0.5)
+                      << std::setw(10) << percentile(result.latencies, 0.99)
+                      << std::setw(10) << percentile(result.latencies, 0.999)
+                      << std::setw(12) << result.allMs << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,253 @@
+/**
+ * @file    bench-wait.cpp
+ *
+ * @brief   Benchmark of how idle workers wait for work, comparing parking on
+ *          the condition variable straight away against spinning first, for
+ *          a fixed budget or an adaptive one. A single producer adds tasks one
+ *          at a time, a fixed gap apart, to the shared TaskQueue and to the
+ *          work stealing pool, and each worker records how long every task
+ *          waited between being added and being taken.
+ *
+ *          For each queue, wait mode and gap, the median and 99th percentile
+ *          of that pickup latency are shown, along with the CPU time used per
+ *          task and as a share of one core. The CPU time is that of the whole
+ *          process, so includes the producer, which does the same in every
+ *          mode. Spinning should cut the latency of short gaps, at the cost
+ *          of CPU, whilst the adaptive wait should stop spinning, and so cost
+ *          no more than parking, once the gaps are too long for it to pay.
+ *
+ *          Usage: bench-wait [workers] [tasks]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <span>
+#include <stop_token>
+
+#include "../common/adaptive-wait.h"
+#include "../common/task-queue.h"
+#include "../common/work-stealing-pool.h"
+
+/// @brief  The clock used for the measurements
+using Clock = std::chrono::steady_clock;
+
+/// @brief  A task, stamped with when it was added
+struct Item
+{
+    /// @brief  When the item was added to the queue
+    Clock::time_point queued;
+};
+
+/// @brief  The results of a single run
+struct Result
+{
+    /// @brief  The median pickup latency
+    std::chrono::nanoseconds p50{ 0 };
+    /// @brief  The 99th percentile pickup latency
+    std::chrono::nanoseconds p99{ 0 };
+    /// @brief  The process CPU time per task
+    std::chrono::nanoseconds cpuPerTask{ 0 };
+    /// @brief  The process CPU time as a share of one core, in percent
+    double cpuShare = 0.0;
+};
+
+/// @brief  The process CPU time used so far
+static std::chrono::nanoseconds cpuTime()
+{
+    return std::chrono::nanoseconds(static_cast<long long>(
+        static_cast<double>(std::clock()) * 1e9 / CLOCKS_PER_SEC));
+}
+
+/// @brief  Waits until the given time, spinning for short gaps, as a sleep
+///         cannot be trusted to wake within a few microseconds
+/// @param  until   The time to wait until
+/// @param  gap     The gap being waited out
+static void waitUntil(Clock::time_point until, Clock::duration gap)
+{
+    if (gap >= std::chrono::microseconds(200))
+    {
+        std::this_thread::sleep_until(until);
+        return;
+    }
+    while (Clock::now() < until)
+    {
+        std::this_thread::yield();
+    }
+}
+
+/// @brief  Runs one producer and a group of workers over a queue
+/// @param  workers The number of workers
+/// @param  tasks   The number of tasks
+/// @param  gap     The time between tasks being added
+/// @param  mode    How the workers wait before parking
+/// @param  push    Adds an item to the queue
+/// @param  take    Takes an item as the given worker, with its stop token and
+///                 wait, returning false once it should stop
+template<typename Push, typename Take>
+static Result run(std::size_t workers, int tasks, Clock::duration gap, WaitMode mode,
+    Push push, Take take)
+{
+    std::vector<std::vector<Clock::duration>> latencies(workers);
+    std::atomic<int> done{ 0 };
+    const auto cpuStart = cpuTime();
+    const auto start = Clock::now();
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t w = 0; w < workers; ++w)
+        {
+            latencies[w].reserve(static_cast<std::size_t>(tasks));
+            threads.emplace_back([&, w](std::stop_token token) {
+                AdaptiveWait wait(mode);
+                Item item;
+                while (take(w, item, token, wait))
+                {
+                    latencies[w].push_back(Clock::now() - item.queued);
+                    if (done.fetch_add(1) + 1 == tasks)
+                    {
+                        done.notify_all();
+                    }
+                }
+            });
+        }
+        // Let the workers settle into waiting before the first task
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        Clock::time_point next = Clock::now();
+        for (int i = 0; i < tasks; ++i)
+        {
+            waitUntil(next, gap);
+            push(Item{ Clock::now() });
+            next += gap;
+        }
+        int current = done.load();
+        while (current < tasks)
+        {
+            done.wait(current);
+            current = done.load();
+        }
+        for (std::jthread &thread : threads)
+        {
+            thread.request_stop();
+        }
+    }
+    const auto wall = Clock::now() - start;
+    const auto cpu = cpuTime() - cpuStart;
+
+    std::vector<Clock::duration> all;
+    for (const std::vector<Clock::duration> &worker : latencies)
+    {
+        all.insert(all.end(), worker.begin(), worker.end());
+    }
+    std::sort(all.begin(), all.end());
+    Result result;
+    result.p50 = all[all.size() / 2];
+    result.p99 = all[std::min(all.size() - 1, all.size() * 99 / 100)];
+    result.cpuPerTask = cpu / tasks;
+    result.cpuShare = 100.0 * std::chrono::duration<double>(cpu).count() /
+        std::chrono::duration<double>(wall).count();
+    return result;
+}
+
+/// @brief  Runs the shared queue
+static Result runShared(std::size_t workers, int tasks, Clock::duration gap, WaitMode mode)
+{
+    TaskQueue<Item> queue;
+    return run(workers, tasks, gap, mode,
+        [&](Item item) { queue.push(item); },
+        [&](std::size_t, Item &item, const std::stop_token &token, AdaptiveWait &wait) {
+            return queue.popUpTo(std::span<Item>(&item, 1), token, true, nullptr, &wait) == 1;
+        });
+}
+
+/// @brief  Runs the work stealing pool, which spreads the tasks across the
+///         workers' queues
+static Result runSteal(std::size_t workers, int tasks, Clock::duration gap, WaitMode mode)
+{
+    WorkStealingPool<Item> pool(workers);
+    std::vector<std::size_t> slots;
+    for (std::size_t w = 0; w < workers; ++w)
+    {
+        slots.push_back(pool.attach());
+    }
+    return run(workers, tasks, gap, mode,
+        [&](Item item) { pool.push(item); },
+        [&](std::size_t w, Item &item, const std::stop_token &token, AdaptiveWait &wait) {
+            return pool.popUpTo(slots[w], std::span<Item>(&item, 1), token, true, &wait) == 1;
+        });
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    std::size_t workers = 4;
+    int tasks = 20000;
+    try
+    {
+        if (argc > 1)
+        {
+            workers = std::max<std::size_t>(std::stoul(argv[1]), 1);
+        }
+        if (argc > 2)
+        {
+            tasks = std::max(std::stoi(argv[2]), 1);
+        }
+    }
+    catch (const std::exception &)
+    {
+        std::cerr << "Usage: " << argv[0] << " [workers] [tasks]" << std::endl;
+        return 1;
+    }
+
+    using std::chrono::microseconds;
+    const std::vector<microseconds> GAPS = {
+        microseconds(2), microseconds(20), microseconds(200), microseconds(2000) };
+    const std::vector<std::pair<const char *, WaitMode>> MODES = {
+        { "park", WaitMode::PARK }, { "spin", WaitMode::SPIN },
+        { "adaptive", WaitMode::ADAPTIVE } };
+    // The runs with the longest gaps take fewer tasks, to keep them short
+    const auto tasksFor = [tasks](microseconds gap) {
+        return std::clamp(static_cast<int>(microseconds(400000) / gap), 200, tasks);
+    };
+
+    std::cout << workers << " workers, up to " << tasks << " tasks per run, on " <<
+        std::thread::hardware_concurrency() << " CPUs" << std::endl;
+    std::cout << std::setw(8) << "queue"
+              << std::setw(10) << "wait"
+              << std::setw(10) << "gap us"
+              << std::setw(10) << "p50 us"
+              << std::setw(10) << "p99 us"
+              << std::setw(14) << "cpu us/task"
+              << std::setw(8) << "cpu %" << std::endl;
+    for (const char *queue : { "shared", "steal" })
+    {
+        for (const microseconds gap : GAPS)
+        {
+            for (const auto &[name, mode] : MODES)
+            {
+                const Result result = (std::string(queue) == "shared") ?
+                    runShared(workers, tasksFor(gap), gap, mode) :
+                    runSteal(workers, tasksFor(gap), gap, mode);
+                std::cout << std::setw(8) << queue
+                          << std::setw(10) << name
+                          << std::setw(10) << gap.count()
+                          << std::fixed << std::setprecision(1)
+                          << std::setw(10) << result.p50.count() / 1000.0
+                          << std::setw(10) << result.p99.count() / 1000.0
+                          << std::setw(14) << result.cpuPerTask.count() / 1000.0
+                          << std::setw(8) << std::setprecision(0) << result.cpuShare
+                          << std::endl;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file    perf-counters.h
+ *
+ * @brief   A minimal wrapper over Linux perf_event_open(), counting hardware
+ *          and software events for the calling process, including any threads
+ *          it creates once counting has started. Counters the machine or
+ *          kernel does not provide, such as the hardware counters inside most
+ *          virtual machines, are reported as unavailable, as is everything on
+ *          other platforms.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// @brief  A set of event counters for the calling process
+class PerfCounters
+{
+public:
+    /// @brief  A single counter value
+    struct Reading
+    {
+        /// @brief  The event name, as perf names it
+        std::string name;
+        /// @brief  Whether the counter could be opened
+        bool available = false;
+        /// @brief  The count, if available
+        std::uint64_t value = 0;
+    };
+
+    /// @brief  Constructor, opening every counter, disabled
+    PerfCounters()
+    {
+#if defined(__linux__)
+        const std::uint64_t l1dReadMiss = PERF_COUNT_HW_CACHE_L1D |
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        open("cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open("instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open("cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        open("L1-dcache-load-misses", PERF_TYPE_HW_CACHE, l1dReadMiss);
+        open("task-clock-us", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+        open("context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES);
+        open("cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS);
+#endif
+    }
+
+    /// @brief  Destructor, closing the counters
+    ~PerfCounters()
+    {
+#if defined(__linux__)
+        for (const Counter &counter : mCounters)
+        {
+            if (counter.fd >= 0)
+            {
+                close(counter.fd);
+            }
+        }
+#endif
+    }
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    /// @brief  Zeroes and starts every counter
+    void start()
+    {
+#if defined(__linux__)
+        for (const Counter &counter : mCounters)
+        {
+            if (counter.fd >= 0)
+            {
+                ioctl(counter.fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(counter.fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    /// @brief  Stops every counter and reads it
+    /// @returns    The readings, in a fixed order
+    std::vector<Reading> stop()
+    {
+        std::vector<Reading> readings;
+        for (const Counter &counter : mCounters)
+        {
+            Reading reading{ counter.name, false, 0 };
+#if defined(__linux__)
+            if (counter.fd >= 0)
+            {
+                ioctl(counter.fd, PERF_EVENT_IOC_DISABLE, 0);
+                std::uint64_t value = 0;
+                if (read(counter.fd, &value, sizeof(value)) == sizeof(value))
+                {
+                    reading.available = true;
+                    // The task clock counts nanoseconds
+                    reading.value = counter.micros ? value / 1000 : value;
+                }
+            }
+#endif
+            readings.push_back(std::move(reading));
+        }
+        return readings;
+    }
+
+private:
+    /// @brief  An open counter
+    struct Counter
+    {
+        std::string name;
+        int fd = -1;
+        bool micros = false;
+    };
+
+#if defined(__linux__)
+    /// @brief  Opens a counter for this process and the threads it creates
+    void open(const char *name, std::uint32_t type, std::uint64_t config)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_hv = 1;
+        // Software events such as context switches happen in the kernel, so
+        // are only counted with it included, where the kernel permits that
+        int fd = -1;
+        if (type == PERF_TYPE_SOFTWARE)
+        {
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        if (fd < 0)
+        {
+            attr.exclude_kernel = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        mCounters.push_back(Counter{ name, fd,
+            type == PERF_TYPE_SOFTWARE && config == PERF_COUNT_SW_TASK_CLOCK });
+    }
+#endif
+
+    /// @brief  The counters, in the order reported
+    std::vector<Counter> mCounters;
+};
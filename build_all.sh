@@ -1,23 +1,56 @@
 #!/usr/bin/bash
 
+# A quick build of everything into the current directory. The CMake build
+# (see CMakeLists.txt) adds Release, RelWithDebInfo, LTO and PGO profiles,
+# along with sanitizer builds.
+
 echo "Building Example 1"
-g++ -std=c++20 -o ex1 jthread-ex1-basic/jthread-ex1-basic.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex1 jthread-ex1-basic/jthread-ex1-basic.cpp
 
 echo "Building Example 2"
-g++ -std=c++20 -o ex2 jthread-ex2-stopping/jthread-ex2-stopping.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex2 jthread-ex2-stopping/jthread-ex2-stopping.cpp
 
 echo "Building Example 3"
-g++ -std=c++20 -o ex3 jthread-ex3-more-stopping/jthread-ex3-more-stopping.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex3 jthread-ex3-more-stopping/jthread-ex3-more-stopping.cpp
 
 echo "Building Example 4"
-g++ -std=c++20 -o ex4 jthread-ex4-adv-stopping/jthread-ex4-adv-stopping.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex4 jthread-ex4-adv-stopping/jthread-ex4-adv-stopping.cpp
 
 echo "Building Example 5"
-g++ -std=c++20 -o ex5 jthread-ex5-class-basic/jthread-ex5-class-basic.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex5 jthread-ex5-class-basic/jthread-ex5-class-basic.cpp
 
 echo "Building Example 6"
-g++ -std=c++20 -o ex6 jthread-ex6-class-adv/jthread-ex6-class-adv.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex6 jthread-ex6-class-adv/jthread-ex6-class-adv.cpp
 
 echo "Building Example 7"
-g++ -std=c++20 -o ex7 jthread-ex7-class-more/jthread-ex7-class-more.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex7 jthread-ex7-class-more/jthread-ex7-class-more.cpp
+
+echo "Building Example 8"
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex8 jthread-ex8-timer-wheel/jthread-ex8-timer-wheel.cpp
+
+echo "Building Example 9"
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex9 jthread-ex9-thread-pool/jthread-ex9-thread-pool.cpp
+
+echo "Building Example 10"
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex10 jthread-ex10-coroutines/jthread-ex10-coroutines.cpp
+
+echo "Building Example 11"
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex11 jthread-ex11-task-graph/jthread-ex11-task-graph.cpp
+
+echo "Building Example 12"
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex12 jthread-ex12-channels/jthread-ex12-channels.cpp
+
+echo "Building Example 13"
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o ex13 jthread-ex13-pipeline/jthread-ex13-pipeline.cpp
 
+echo "Building Benchmarks"
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o bench-pool bench/bench-pool.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o bench-log bench/bench-log.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o bench-setdata bench/bench-setdata.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o bench-stop bench/bench-stop.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o bench-restart bench/bench-restart.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o bench-layout bench/bench-layout.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o bench-parallel bench/bench-parallel.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o bench-wait bench/bench-wait.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o bench-arena bench/bench-arena.cpp
+g++ -std=c++20 -O2 -Wall -Wextra -pthread -o bench-channel bench/bench-channel.cpp
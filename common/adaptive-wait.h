@@ -0,0 +1,189 @@
+/**
+ * @file    adaptive-wait.h
+ *
+ * @brief   A short wait for work, made before a worker parks on its queue's
+ *          condition variable. When items arrive microseconds apart, parking
+ *          costs every item a sleep and a wake-up in the kernel, for both the
+ *          worker and whoever queues the item, whereas a worker that is still
+ *          spinning when the item arrives simply sees it.
+ *
+ *          The wait spins with a pause instruction first, then yields the CPU
+ *          to other threads, and gives up once its budget has been used, so
+ *          that the caller can park as before. Spinning only pays off when the
+ *          item arrives within the budget, so in ADAPTIVE mode each worker
+ *          keeps a moving average of how long its recent waits for work took,
+ *          and only spins for around twice that, not at all once the gaps are
+ *          longer than the largest budget. The wait is stop-token aware,
+ *          leaving a stop request to the caller's park, which returns at once.
+ *
+ *          Each worker owns its own AdaptiveWait. It is not shared.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <stop_token>
+#include <thread>
+
+#include "cpu.h"
+
+/// @brief  How a worker waits for work before parking
+enum class WaitMode
+{
+    /// @brief  Parks straight away
+    PARK,
+    /// @brief  Always spins, then yields, for the largest budget
+    SPIN,
+    /// @brief  Spins and yields for a budget learnt from recent waits
+    ADAPTIVE,
+};
+
+/// @brief  A single worker's spin-then-yield wait, made before it parks
+class AdaptiveWait
+{
+public:
+    /// @brief  The clock used for the budgets
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief  Constructor
+    /// @param  mode        How to wait
+    /// @param  maxSpin     The longest time spent spinning
+    /// @param  maxYield    The longest time spent yielding, once spinning
+    explicit AdaptiveWait(WaitMode mode = WaitMode::ADAPTIVE,
+        Clock::duration maxSpin = std::chrono::microseconds(50),
+        Clock::duration maxYield = std::chrono::microseconds(50))
+        : mMode(mode)
+        , mMaxSpin(maxSpin)
+        , mMaxYield(maxYield)
+    {
+    }
+
+    /// @brief  Waits for work to become ready, for no more than the budget.
+    /// @param  token   The stop token of the calling worker, ending the wait
+    ///                 once stopped
+    /// @param  ready   Returns true once work is ready, without blocking
+    /// @returns    True if work became ready, false if the caller should park.
+    ///             If it parks, it should call parked() once it has work.
+    template<typename Ready>
+    bool wait(const std::stop_token &token, Ready &&ready)
+    {
+        if (ready())
+        {
+            // Work was already waiting, which says nothing of the gaps
+            // between items
+            mStart.reset();
+            return true;
+        }
+        const Clock::time_point start = Clock::now();
+        mStart = start;
+        const Clock::duration budget = this->budget();
+        if (budget == Clock::duration::zero())
+        {
+            return false;
+        }
+
+        // Spinning only helps if another core can make progress meanwhile
+        static const bool canSpin = std::thread::hardware_concurrency() > 1;
+        const Clock::time_point spinEnd = start + (canSpin ?
+            std::min(budget, mMaxSpin) : Clock::duration::zero());
+        const Clock::time_point end = start + budget;
+        Clock::time_point now = start;
+        for (unsigned i = 0; now < end; ++i)
+        {
+            if (token.stop_requested())
+            {
+                return false;
+            }
+            if (ready())
+            {
+                learn(Clock::now() - start);
+                return true;
+            }
+            if (now < spinEnd)
+            {
+                cpuRelax();
+                // Reading the clock costs more than a pause, so only check it
+                // every so often whilst spinning
+                if ((i % CLOCK_PERIOD) == 0)
+                {
+                    now = Clock::now();
+                }
+            }
+            else
+            {
+                std::this_thread::yield();
+                now = Clock::now();
+            }
+        }
+        return false;
+    }
+
+    /// @brief  Records that the worker parked after wait() returned false,
+    ///         and has since found work, teaching ADAPTIVE mode how long the
+    ///         wait took
+    void parked()
+    {
+        if (mStart)
+        {
+            learn(Clock::now() - *mStart);
+            mStart.reset();
+        }
+    }
+
+    /// @brief  The time the next wait will spin and yield for
+    Clock::duration budget() const
+    {
+        switch (mMode)
+        {
+        case WaitMode::SPIN:
+            return mMaxSpin + mMaxYield;
+        case WaitMode::ADAPTIVE:
+        {
+            // Spinning for a gap much longer than the largest budget only
+            // burns CPU before parking anyway
+            const Clock::duration wanted = mAverage * 2;
+            return (wanted <= mMaxSpin + mMaxYield) ? wanted : Clock::duration::zero();
+        }
+        default:
+            return Clock::duration::zero();
+        }
+    }
+
+    /// @brief  How the worker waits
+    WaitMode mode() const
+    {
+        return mMode;
+    }
+
+private:
+    /// @brief  The pauses between reading the clock whilst spinning
+    static constexpr unsigned CLOCK_PERIOD = 64;
+    /// @brief  The weight of each new wait in the average, as a shift
+    static constexpr int AVERAGE_SHIFT = 3;
+
+    /// @brief  Adds a wait to the moving average
+    /// @param  waited  How long the wait for work took
+    void learn(Clock::duration waited)
+    {
+        mAverage += (waited - mAverage) / (1 << AVERAGE_SHIFT);
+    }
+
+    /// @brief  How to wait
+    const WaitMode mMode;
+    /// @brief  The longest time spent spinning
+    const Clock::duration mMaxSpin;
+    /// @brief  The longest time spent yielding
+    const Clock::duration mMaxYield;
+    /// @brief  The moving average of recent waits for work, starting at zero
+    ///         so that a new worker parks until it has seen how long its
+    ///         waits take
+    Clock::duration mAverage{ 0 };
+    /// @brief  When the current wait started, until it has been learnt
+    std::optional<Clock::time_point> mStart;
+};
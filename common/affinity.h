@@ -0,0 +1,304 @@
+/**
+ * @file    affinity.h
+ *
+ * @brief   Helpers for placing threads and memory: discovering which CPUs
+ *          belong to which NUMA node, pinning a std::thread or std::jthread
+ *          to a set of CPUs through its native_handle(), and allocating
+ *          memory bound to a node.
+ *
+ *          On a machine with a single node, or where the platform does not
+ *          expose the topology, everything is reported as one node holding
+ *          every CPU, and the allocations are ordinary ones. Pinning and
+ *          binding are hints to the OS, and a failure is reported rather
+ *          than thrown, so that the caller can carry on unpinned.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// @brief  The CPUs of each NUMA node
+struct CpuTopology
+{
+    /// @brief  A single node
+    struct Node
+    {
+        /// @brief  The OS node number
+        int id = 0;
+        /// @brief  The CPUs within the node
+        std::vector<std::size_t> cpus;
+    };
+
+    /// @brief  Every node with at least one CPU
+    std::vector<Node> nodes;
+
+    /// @brief  Discovers the topology of this machine
+    static CpuTopology detect()
+    {
+        CpuTopology topology;
+#if defined(_WIN32)
+        ULONG highest = 0;
+        if (GetNumaHighestNodeNumber(&highest))
+        {
+            for (ULONG node = 0; node <= highest; ++node)
+            {
+                ULONGLONG mask = 0;
+                if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask) || mask == 0)
+                {
+                    continue;
+                }
+                Node entry{ static_cast<int>(node), {} };
+                for (std::size_t cpu = 0; cpu < 64; ++cpu)
+                {
+                    if (mask & (ULONGLONG{ 1 } << cpu))
+                    {
+                        entry.cpus.push_back(cpu);
+                    }
+                }
+                topology.nodes.push_back(std::move(entry));
+            }
+        }
+#elif defined(__linux__)
+        for (int node = 0; node < 1024; ++node)
+        {
+            std::ifstream file("/sys/devices/system/node/node" +
+                std::to_string(node) + "/cpulist");
+            if (!file)
+            {
+                // Node numbers may have gaps, but never past the first few
+                if (node >= 64)
+                {
+                    break;
+                }
+                continue;
+            }
+            std::string list;
+            std::getline(file, list);
+            Node entry{ node, parseCpuList(list) };
+            if (!entry.cpus.empty())
+            {
+                topology.nodes.push_back(std::move(entry));
+            }
+        }
+#endif
+        if (topology.nodes.empty())
+        {
+            Node all;
+            const std::size_t count = std::max(1u, std::thread::hardware_concurrency());
+            for (std::size_t cpu = 0; cpu < count; ++cpu)
+            {
+                all.cpus.push_back(cpu);
+            }
+            topology.nodes.push_back(std::move(all));
+        }
+        return topology;
+    }
+
+    /// @brief  Parses a Linux CPU list, such as "0-3,8,10-11"
+    /// @param  list    The list
+    /// @returns    The CPUs listed
+    static std::vector<std::size_t> parseCpuList(const std::string &list)
+    {
+        std::vector<std::size_t> cpus;
+        std::stringstream ranges(list);
+        std::string range;
+        while (std::getline(ranges, range, ','))
+        {
+            try
+            {
+                const std::size_t dash = range.find('-');
+                const std::size_t first = std::stoul(range.substr(0, dash));
+                const std::size_t last = (dash == std::string::npos) ?
+                    first : std::stoul(range.substr(dash + 1));
+                for (std::size_t cpu = first; cpu <= last; ++cpu)
+                {
+                    cpus.push_back(cpu);
+                }
+            }
+            catch (const std::exception &)
+            {
+                // Skip anything malformed, such as an empty list
+            }
+        }
+        return cpus;
+    }
+};
+
+/// @brief  Pins a thread to a set of CPUs
+/// @param  thread  The thread, which must be running
+/// @param  cpus    The CPUs it may run on
+/// @returns    True if the thread was pinned
+template<typename Thread>
+bool pinThread(Thread &thread, const std::vector<std::size_t> &cpus)
+{
+    if (cpus.empty())
+    {
+        return false;
+    }
+#if defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (const std::size_t cpu : cpus)
+    {
+        if (cpu < sizeof(DWORD_PTR) * 8)
+        {
+            mask |= DWORD_PTR{ 1 } << cpu;
+        }
+    }
+    return mask != 0 &&
+        SetThreadAffinityMask(static_cast<HANDLE>(thread.native_handle()), mask) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const std::size_t cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void)thread;
+    return false;
+#endif
+}
+
+/// @brief  Allocates memory whose pages are bound to a NUMA node, falling
+///         back to an ordinary allocation where that is not possible.
+///         Release it with freeOnNode().
+/// @param  bytes   The size of the allocation
+/// @param  node    The OS node number, or -1 for no preference
+/// @returns    The memory, aligned to at least a page when bound
+inline void *allocateOnNode(std::size_t bytes, int node)
+{
+    if (bytes == 0)
+    {
+        bytes = 1;
+    }
+#if defined(_WIN32)
+    if (node >= 0)
+    {
+        void *memory = VirtualAllocExNuma(GetCurrentProcess(), nullptr, bytes,
+            MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, static_cast<DWORD>(node));
+        if (memory != nullptr)
+        {
+            return memory;
+        }
+    }
+    return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#elif defined(__linux__)
+    void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        throw std::bad_alloc();
+    }
+#if defined(SYS_mbind)
+    if (node >= 0 && node < 64)
+    {
+        // MPOL_PREFERRED, so the pages still come from elsewhere if the node
+        // is full. Without NUMA support this fails, and the memory is simply
+        // placed by first touch.
+        static constexpr int MPOL_PREFERRED_MODE = 1;
+        const unsigned long mask = 1ul << node;
+        syscall(SYS_mbind, memory, bytes, MPOL_PREFERRED_MODE, &mask,
+            sizeof(mask) * 8, 0);
+    }
+#endif
+    return memory;
+#else
+    (void)node;
+    return ::operator new(bytes);
+#endif
+}
+
+/// @brief  Releases memory from allocateOnNode()
+/// @param  memory  The memory
+/// @param  bytes   The size it was allocated with
+inline void freeOnNode(void *memory, std::size_t bytes)
+{
+    if (memory == nullptr)
+    {
+        return;
+    }
+#if defined(_WIN32)
+    (void)bytes;
+    VirtualFree(memory, 0, MEM_RELEASE);
+#elif defined(__linux__)
+    munmap(memory, bytes == 0 ? 1 : bytes);
+#else
+    (void)bytes;
+    ::operator delete(memory);
+#endif
+}
+
+/// @brief  A standard allocator placing its memory on a NUMA node, for use
+///         with containers that allocate in large blocks, such as the ring of
+///         a queue. Each allocation takes at least one page.
+template<typename T>
+class NodeAllocator
+{
+public:
+    using value_type = T;
+
+    /// @brief  Constructor
+    /// @param  node    The OS node number, or -1 for no preference
+    explicit NodeAllocator(int node = -1) noexcept
+        : mNode(node)
+    {
+    }
+
+    template<typename U>
+    NodeAllocator(const NodeAllocator<U> &other) noexcept
+        : mNode(other.node())
+    {
+    }
+
+    T *allocate(std::size_t count)
+    {
+        return static_cast<T *>(allocateOnNode(count * sizeof(T), mNode));
+    }
+
+    void deallocate(T *memory, std::size_t count) noexcept
+    {
+        freeOnNode(memory, count * sizeof(T));
+    }
+
+    /// @brief  The node allocated on
+    int node() const noexcept
+    {
+        return mNode;
+    }
+
+    template<typename U>
+    bool operator==(const NodeAllocator<U> &other) const noexcept
+    {
+        return mNode == other.node();
+    }
+
+private:
+    /// @brief  The node allocated on
+    int mNode;
+};
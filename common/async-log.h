@@ -0,0 +1,467 @@
+/**
+ * @file    async-log.h
+ *
+ * @brief   An asynchronous logger used by the LOG and DOT macros. Each thread
+ *          formats its messages into its own single producer, single consumer
+ *          ring buffer, so logging never takes a lock, allocates or flushes.
+ *          A background std::jthread drains every ring, merging the messages
+ *          back into the order in which they were logged, and writes each
+ *          batch to stdout with a single write().
+ *
+ *          Once the drainer has stopped, such as during static destruction,
+ *          each thread writes out its own messages as it logs them.
+ *
+ *          Colour escape sequences come from colour.h, and are built at
+ *          compile time rather than through a std::stringstream on every call.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "colour.h"
+#include "cpu.h"
+
+/// @brief  Provides a standardised log message with colour
+#define LOG(col, name, msg)     LogLine(col, true) << name << ": " << msg;
+
+/// @brief  Prints a coloured dot to screen, indicating a thread is still
+///         running.
+#define DOT(col)                LogLine(col, false) << ".";
+
+/// @brief  Ends the current line of dots
+#define NEWLINE()               LogLine(Colour::none(), true);
+
+/// @brief  The logger shared by all threads, owning the drainer thread and
+///         every thread's ring buffer
+class AsyncLog
+{
+public:
+    /// @brief  The size of each thread's ring buffer, in bytes
+    static constexpr std::size_t RING_SIZE = 16 * 1024;
+    /// @brief  The longest message kept, anything beyond this is dropped so
+    ///         that a message always fits in the ring
+    static constexpr std::size_t MAX_MESSAGE = RING_SIZE / 2;
+    /// @brief  How often the drainer writes out whatever has been logged
+    static constexpr std::chrono::milliseconds FLUSH_PERIOD{ 5 };
+
+    /// @brief  A single thread's messages. Only the owning thread writes, and
+    ///         only the drainer reads.
+    class Ring
+    {
+    public:
+        /// @brief  The header before each message in the ring
+        struct Header
+        {
+            /// @brief  Global position of the message, used to merge rings
+            std::uint64_t sequence;
+            /// @brief  The number of bytes following the header
+            std::uint32_t length;
+        };
+
+        /// @brief  Copies bytes into the ring, wrapping where required
+        /// @param  position    The unwrapped position to write at
+        /// @param  data        The bytes to write
+        /// @param  length      The number of bytes
+        void put(std::size_t position, const void *data, std::size_t length)
+        {
+            const std::size_t offset = position % RING_SIZE;
+            const std::size_t first = std::min(length, RING_SIZE - offset);
+            std::memcpy(mData.get() + offset, data, first);
+            std::memcpy(mData.get(), static_cast<const char *>(data) + first,
+                length - first);
+        }
+
+        /// @brief  Copies bytes out of the ring, wrapping where required
+        /// @param  position    The unwrapped position to read from
+        /// @param  data        Storage for the bytes
+        /// @param  length      The number of bytes
+        void get(std::size_t position, void *data, std::size_t length) const
+        {
+            const std::size_t offset = position % RING_SIZE;
+            const std::size_t first = std::min(length, RING_SIZE - offset);
+            std::memcpy(data, mData.get() + offset, first);
+            std::memcpy(static_cast<char *>(data) + first, mData.get(),
+                length - first);
+        }
+
+        /// @brief  The bytes of the ring
+        std::unique_ptr<char[]> mData = std::make_unique<char[]>(RING_SIZE);
+        /// @brief  Position up to which the drainer has read
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mHead{ 0 };
+        /// @brief  Position up to which complete messages have been written
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mTail{ 0 };
+        /// @brief  Whether a thread currently owns this ring
+        std::atomic<bool> mOwned{ true };
+    };
+
+    /// @brief  Gets the logger, starting it on first use
+    static AsyncLog &instance()
+    {
+        static AsyncLog log;
+        return log;
+    }
+
+    /// @brief  Gets the ring buffer for the calling thread, claiming one the
+    ///         first time the thread logs
+    static Ring &ring()
+    {
+        thread_local const RingOwner owner(instance().claim());
+        return *owner.ring;
+    }
+
+    /// @brief  Allocates the next sequence number for a message
+    std::uint64_t nextSequence()
+    {
+        return mSequence.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// @brief  Makes room in a full ring, by waking the drainer early, or
+    ///         once the drainer has stopped, by writing out every message
+    void kick()
+    {
+        if (mClosed.load(std::memory_order_acquire))
+        {
+            drain();
+            return;
+        }
+        {
+            std::lock_guard lock(mMutex);
+            mKicked = true;
+        }
+        mCv.notify_one();
+    }
+
+    /// @brief  Called after a thread publishes a message. Once the drainer has
+    ///         stopped, nothing else would write it out, so it is written now.
+    void published()
+    {
+        // The message was published by a seq_cst exchange of the ring's tail,
+        // and the drainer closes with a seq_cst exchange before it reads the
+        // tails, so either the final drain sees the message, or the closed
+        // flag is seen here
+        if (mClosed.load(std::memory_order_seq_cst))
+        {
+            drain();
+        }
+    }
+
+    AsyncLog(const AsyncLog &) = delete;
+    AsyncLog &operator=(const AsyncLog &) = delete;
+
+private:
+    /// @brief  Releases a thread's ring when the thread exits, so that it can
+    ///         be reused by a later thread, which carries on after whatever the
+    ///         drainer has still to write out
+    struct RingOwner
+    {
+        explicit RingOwner(Ring &owned) : ring(&owned) {}
+        ~RingOwner() { ring->mOwned.store(false, std::memory_order_release); }
+        Ring *ring;
+    };
+
+    /// @brief  Constructor, starting the drainer
+    AsyncLog()
+        : mDrainer(std::bind_front(&AsyncLog::drainer, this))
+    {
+    }
+
+    /// @brief  Destructor. The drainer writes out anything left before it is
+    ///         joined.
+    ~AsyncLog() = default;
+
+    /// @brief  Claims a ring that is no longer owned, or creates a new one
+    Ring &claim()
+    {
+        std::lock_guard lock(mRingsMutex);
+        for (auto &ring : mRings)
+        {
+            bool owned = false;
+            if (ring->mOwned.compare_exchange_strong(owned, true,
+                std::memory_order_acquire))
+            {
+                return *ring;
+            }
+        }
+        mRings.push_back(std::make_unique<Ring>());
+        return *mRings.back();
+    }
+
+    /// @brief  The drainer thread, writing out the rings every FLUSH_PERIOD
+    ///         until stopped, and once more after that, leaving any later
+    ///         messages to the threads logging them
+    /// @param  token   The stop token for this thread
+    void drainer(std::stop_token token)
+    {
+        mOutput.reserve(RING_SIZE);
+        while (!token.stop_requested())
+        {
+            {
+                std::unique_lock lock(mMutex);
+                mCv.wait_for(lock, token, FLUSH_PERIOD, [&]() { return mKicked; });
+                mKicked = false;
+            }
+            drain();
+        }
+        mClosed.exchange(true, std::memory_order_seq_cst);
+        drain();
+    }
+
+    /// @brief  The read state of a single ring during a drain
+    struct Cursor
+    {
+        Ring *ring;
+        std::size_t head;
+        std::size_t tail;
+        Ring::Header next;
+    };
+
+    /// @brief  Writes out every complete message, in sequence order
+    void drain()
+    {
+        std::lock_guard drainLock(mDrainMutex);
+        mCursors.clear();
+        {
+            std::lock_guard lock(mRingsMutex);
+            for (auto &ring : mRings)
+            {
+                Cursor cursor{ ring.get(),
+                    ring->mHead.load(std::memory_order_relaxed),
+                    ring->mTail.load(std::memory_order_seq_cst), {} };
+                if (cursor.head != cursor.tail)
+                {
+                    cursor.ring->get(cursor.head, &cursor.next, sizeof(Ring::Header));
+                    mCursors.push_back(cursor);
+                }
+            }
+        }
+
+        // Merge the rings, always taking the oldest message next
+        while (!mCursors.empty())
+        {
+            auto oldest = mCursors.begin();
+            for (auto it = mCursors.begin(); it != mCursors.end(); ++it)
+            {
+                if (it->next.sequence < oldest->next.sequence)
+                {
+                    oldest = it;
+                }
+            }
+            Cursor &cursor = *oldest;
+            const std::size_t size = mOutput.size();
+            mOutput.resize(size + cursor.next.length);
+            cursor.ring->get(cursor.head + sizeof(Ring::Header),
+                mOutput.data() + size, cursor.next.length);
+            cursor.head += sizeof(Ring::Header) + cursor.next.length;
+            cursor.ring->mHead.store(cursor.head, std::memory_order_release);
+
+            if (cursor.head == cursor.tail)
+            {
+                *oldest = mCursors.back();
+                mCursors.pop_back();
+            }
+            else
+            {
+                cursor.ring->get(cursor.head, &cursor.next, sizeof(Ring::Header));
+            }
+        }
+        flush();
+    }
+
+    /// @brief  Writes the output buffer to stdout with as few calls as
+    ///         possible, normally just one
+    void flush()
+    {
+        std::size_t written = 0;
+        while (written < mOutput.size())
+        {
+#if defined(_WIN32)
+            const auto result = _write(1, mOutput.data() + written,
+                static_cast<unsigned>(mOutput.size() - written));
+#else
+            const auto result = ::write(1, mOutput.data() + written,
+                mOutput.size() - written);
+#endif
+            if (result <= 0)
+            {
+                break;
+            }
+            written += static_cast<std::size_t>(result);
+        }
+        mOutput.clear();
+    }
+
+    /// @brief  Source of the message sequence numbers
+    std::atomic<std::uint64_t> mSequence{ 0 };
+    /// @brief  Mutex protecting the list of rings
+    std::mutex mRingsMutex;
+    /// @brief  Every ring ever claimed, reused as threads come and go
+    std::vector<std::unique_ptr<Ring>> mRings;
+    /// @brief  Mutex held for each drain, only ever contended once the
+    ///         drainer has stopped and the logging threads drain themselves
+    std::mutex mDrainMutex;
+    /// @brief  The read state of each ring, protected by mDrainMutex
+    std::vector<Cursor> mCursors;
+    /// @brief  Bytes waiting to be written, protected by mDrainMutex
+    std::vector<char> mOutput;
+    /// @brief  Set once the drainer has stopped
+    std::atomic<bool> mClosed{ false };
+    /// @brief  Mutex used only to wake the drainer early
+    std::mutex mMutex;
+    /// @brief  Condition variable the drainer waits on between flushes
+    std::condition_variable_any mCv;
+    /// @brief  Set when a full ring needs the drainer, protected by mMutex
+    bool mKicked = false;
+    /// @brief  The drainer thread, declared last so it is stopped and joined
+    ///         before anything it uses is destroyed
+    std::jthread mDrainer;
+};
+
+/// @brief  A single message, written straight into the calling thread's ring
+///         and published when the object is destroyed, at the end of the
+///         LOG or DOT statement.
+class LogLine
+{
+public:
+    /// @brief  Constructor
+    /// @param  colour  The colour for the message
+    /// @param  newline Whether the message ends the line
+    LogLine(Colour colour, bool newline)
+        : mRing(AsyncLog::ring())
+        , mStart(mRing.mTail.load(std::memory_order_relaxed))
+        , mPosition(mStart + sizeof(AsyncLog::Ring::Header))
+        , mColour(colour)
+        , mNewline(newline)
+    {
+        append(colour.prefix());
+    }
+
+    /// @brief  Destructor, publishing the message to the drainer
+    ~LogLine()
+    {
+        write(mColour.suffix());
+        if (mNewline)
+        {
+            write("\n");
+        }
+        const AsyncLog::Ring::Header header{ AsyncLog::instance().nextSequence(),
+            static_cast<std::uint32_t>(mPosition - mStart -
+                sizeof(AsyncLog::Ring::Header)) };
+        reserve(mStart, sizeof(header));
+        mRing.put(mStart, &header, sizeof(header));
+        // A seq_cst exchange, ordered against the closed flag in published()
+        mRing.mTail.exchange(mPosition, std::memory_order_seq_cst);
+        AsyncLog::instance().published();
+    }
+
+    LogLine(const LogLine &) = delete;
+    LogLine &operator=(const LogLine &) = delete;
+
+    /// @brief  Appends text
+    LogLine &operator<<(std::string_view text)
+    {
+        append(text);
+        return *this;
+    }
+
+    /// @brief  Appends a C string. Without this, a string literal would be
+    ///         converted to bool rather than to std::string_view.
+    LogLine &operator<<(const char *text)
+    {
+        append(text);
+        return *this;
+    }
+
+    /// @brief  Appends a single character
+    LogLine &operator<<(char c)
+    {
+        append(std::string_view(&c, 1));
+        return *this;
+    }
+
+    /// @brief  Appends a boolean as 1 or 0, as std::cout would
+    LogLine &operator<<(bool value)
+    {
+        append(value ? "1" : "0");
+        return *this;
+    }
+
+    /// @brief  Appends a number
+    template<typename T>
+        requires std::is_arithmetic_v<T>
+    LogLine &operator<<(T value)
+    {
+        std::array<char, 32> text;
+        const auto result = std::to_chars(text.data(), text.data() + text.size(),
+            value);
+        append(std::string_view(text.data(), result.ptr - text.data()));
+        return *this;
+    }
+
+private:
+    /// @brief  Appends bytes to the message, dropping any beyond MAX_MESSAGE
+    /// @param  text    The bytes to append
+    void append(std::string_view text)
+    {
+        const std::size_t used = mPosition - mStart;
+        const std::size_t limit = AsyncLog::MAX_MESSAGE;
+        write(text.substr(0, used < limit ? limit - used : 0));
+    }
+
+    /// @brief  Writes bytes to the ring after the message so far
+    /// @param  text    The bytes to write
+    void write(std::string_view text)
+    {
+        reserve(mPosition, text.size());
+        mRing.put(mPosition, text.data(), text.size());
+        mPosition += text.size();
+    }
+
+    /// @brief  Waits for the drainer to free enough of the ring, or once it
+    ///         has stopped, frees it directly
+    /// @param  position    The position to be written at
+    /// @param  length      The number of bytes to be written
+    void reserve(std::size_t position, std::size_t length)
+    {
+        while (position + length - mRing.mHead.load(std::memory_order_acquire) >
+            AsyncLog::RING_SIZE)
+        {
+            AsyncLog::instance().kick();
+            std::this_thread::yield();
+        }
+    }
+
+    /// @brief  The calling thread's ring
+    AsyncLog::Ring &mRing;
+    /// @brief  Where this message's header goes
+    const std::size_t mStart;
+    /// @brief  Where the next byte of the message goes
+    std::size_t mPosition;
+    /// @brief  The colour of the message
+    const Colour mColour;
+    /// @brief  Whether the message ends the line
+    const bool mNewline;
+};
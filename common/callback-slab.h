@@ -0,0 +1,206 @@
+/**
+ * @file    callback-slab.h
+ *
+ * @brief   Fixed storage for std::stop_callback objects, held inline by the
+ *          object that owns the thread. The callable is stored directly in the
+ *          std::stop_callback rather than in a std::function, so registering a
+ *          callback allocates nothing, and each one is deregistered by the RAII
+ *          handle returned for it.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+/// @brief  Inline storage for up to CAPACITY stop callbacks, each of no more
+///         than SLOT_SIZE bytes
+template<std::size_t CAPACITY, std::size_t SLOT_SIZE = 96>
+class CallbackSlab
+{
+    static_assert(CAPACITY > 0 && CAPACITY <= 64, "CAPACITY must be 1 to 64");
+
+public:
+    /// @brief  Owns a single registered callback, deregistering it when
+    ///         destroyed. A handle must not outlive the slab it came from.
+    class Handle
+    {
+    public:
+        /// @brief  Constructs an empty handle, owning nothing
+        Handle() = default;
+
+        /// @brief  Destructor, deregistering the callback
+        ~Handle()
+        {
+            reset();
+        }
+
+        Handle(const Handle &) = delete;
+        Handle &operator=(const Handle &) = delete;
+
+        /// @brief  Move constructor, taking ownership of the callback
+        Handle(Handle &&other) noexcept
+            : mSlab(std::exchange(other.mSlab, nullptr))
+            , mIndex(other.mIndex)
+        {
+        }
+
+        /// @brief  Move assignment, deregistering any callback already owned
+        Handle &operator=(Handle &&other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                mSlab = std::exchange(other.mSlab, nullptr);
+                mIndex = other.mIndex;
+            }
+            return *this;
+        }
+
+        /// @brief  Deregisters the callback now. If it is running on another
+        ///         thread, this waits for it to finish, as std::stop_callback
+        ///         does.
+        void reset()
+        {
+            if (mSlab != nullptr)
+            {
+                mSlab->release(mIndex);
+                mSlab = nullptr;
+            }
+        }
+
+        /// @brief  Whether the handle owns a callback
+        explicit operator bool() const
+        {
+            return mSlab != nullptr;
+        }
+
+    private:
+        friend class CallbackSlab;
+
+        /// @brief  Constructor, used by the slab
+        Handle(CallbackSlab *slab, std::size_t index)
+            : mSlab(slab)
+            , mIndex(index)
+        {
+        }
+
+        /// @brief  The slab holding the callback
+        CallbackSlab *mSlab = nullptr;
+        /// @brief  The slot within the slab
+        std::size_t mIndex = 0;
+    };
+
+    CallbackSlab() = default;
+    CallbackSlab(const CallbackSlab &) = delete;
+    CallbackSlab &operator=(const CallbackSlab &) = delete;
+
+    /// @brief  Destructor, deregistering any callbacks still held
+    ~CallbackSlab()
+    {
+        std::uint64_t used = mUsed.load();
+        while (used != 0)
+        {
+            const std::size_t index = static_cast<std::size_t>(std::countr_zero(used));
+            mSlots[index].destroy(mSlots[index].storage);
+            used &= used - 1;
+        }
+    }
+
+    /// @brief  Registers a callback on the token, constructing the
+    ///         std::stop_callback in place within a free slot. As with any
+    ///         std::stop_callback, if a stop has already been requested the
+    ///         callback runs immediately.
+    /// @param  token       The stop token to register with
+    /// @param  callback    The callback to be run when a stop is requested
+    /// @returns    The handle owning the registration
+    /// @throws std::length_error if every slot is in use
+    template<typename F>
+    [[nodiscard]] Handle add(const std::stop_token &token, F &&callback)
+    {
+        using Callback = std::stop_callback<std::decay_t<F>>;
+        static_assert(sizeof(Callback) <= SLOT_SIZE,
+            "Callback is too large for the slab, increase SLOT_SIZE");
+        static_assert(alignof(Callback) <= alignof(std::max_align_t),
+            "Callback is over-aligned for the slab");
+
+        const std::size_t index = claim();
+        Slot &slot = mSlots[index];
+        try
+        {
+            new (slot.storage) Callback(token, std::forward<F>(callback));
+        }
+        catch (...)
+        {
+            mUsed.fetch_and(~(std::uint64_t{ 1 } << index));
+            throw;
+        }
+        slot.destroy = [](void *storage) {
+            std::launder(static_cast<Callback *>(storage))->~Callback();
+        };
+        return Handle(this, index);
+    }
+
+    /// @brief  The number of callbacks currently registered
+    std::size_t size() const
+    {
+        return static_cast<std::size_t>(std::popcount(mUsed.load()));
+    }
+
+private:
+    /// @brief  Storage for a single callback
+    struct Slot
+    {
+        /// @brief  The std::stop_callback itself
+        alignas(std::max_align_t) std::byte storage[SLOT_SIZE];
+        /// @brief  Destroys the std::stop_callback of whichever type is held
+        void (*destroy)(void *) = nullptr;
+    };
+
+    /// @brief  Claims a free slot
+    /// @returns    The index of the slot
+    std::size_t claim()
+    {
+        std::uint64_t used = mUsed.load();
+        while (true)
+        {
+            const std::uint64_t free = ~used & FULL;
+            if (free == 0)
+            {
+                throw std::length_error("CallbackSlab: no free callback slots");
+            }
+            const std::uint64_t bit = free & (~free + 1);
+            if (mUsed.compare_exchange_weak(used, used | bit))
+            {
+                return static_cast<std::size_t>(std::countr_zero(bit));
+            }
+        }
+    }
+
+    /// @brief  Destroys the callback in a slot, and frees the slot
+    /// @param  index   The slot index
+    void release(std::size_t index)
+    {
+        mSlots[index].destroy(mSlots[index].storage);
+        mUsed.fetch_and(~(std::uint64_t{ 1 } << index));
+    }
+
+    /// @brief  The bits of mUsed that correspond to a slot
+    static constexpr std::uint64_t FULL = (CAPACITY == 64) ?
+        ~std::uint64_t{ 0 } : ((std::uint64_t{ 1 } << CAPACITY) - 1);
+
+    /// @brief  The slots
+    Slot mSlots[CAPACITY];
+    /// @brief  One bit per slot, set when the slot is in use
+    std::atomic<std::uint64_t> mUsed{ 0 };
+};
@@ -0,0 +1,473 @@
+/**
+ * @file    channel.h
+ *
+ * @brief   A bounded channel carrying a stream of values from one or more
+ *          sending threads to one or more receiving threads. Where examples
+ *          4 and 6 hand a lone value over through a reference, a mutex and a
+ *          condition variable, a channel queues as many values as it has room
+ *          for, each moved in and out rather than copied, and once full, makes
+ *          senders wait, so that a fast producer is held back to the pace of
+ *          its consumer rather than queueing without limit.
+ *
+ *          The values are held in a ring. With a single sender (SPSC), each
+ *          side owns one index, only ever written by itself, so neither
+ *          sending nor receiving takes a lock. With many senders (MPSC), the
+ *          senders take turns through a mutex of their own, which the receiver
+ *          never touches. With many receivers as well (MPMC), the receivers
+ *          likewise take turns through another, each holding it until it has
+ *          received, so that only one waits on the channel at a time.
+ *
+ *          Only a thread that has to wait touches the channel's mutex, waiting
+ *          on a std::condition_variable_any with its stop token, so that a
+ *          stop request wakes it through the same stop_callback and
+ *          notify_all() as the shared queue. Each side flags that it is
+ *          waiting, so the other only takes the mutex to wake it when it is,
+ *          and only once. Senders held back by a full channel are woken once
+ *          half of it is free, to send a run of values at a time.
+ *
+ *          Closing a channel refuses further values, while the receiver still
+ *          takes those already sent, before being told the channel is done.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <utility>
+
+#include "cpu.h"
+
+/// @brief  The senders a Channel allows
+enum class ChannelKind
+{
+    /// @brief  A single sending thread, taking no lock
+    SPSC,
+    /// @brief  Any number of sending threads
+    MPSC,
+    /// @brief  Any number of sending and receiving threads
+    MPMC,
+};
+
+/// @brief  A bounded channel of values between threads
+/// @tparam T       The value type, which need only be movable
+/// @tparam KIND    Whether one or many threads may send and receive
+template<typename T, ChannelKind KIND = ChannelKind::SPSC>
+class Channel
+{
+public:
+    /// @brief  Constructor
+    /// @param  capacity    The most values held at once, rounded up to a
+    ///                     power of two
+    /// @throws std::invalid_argument if the capacity is zero
+    explicit Channel(std::size_t capacity)
+        : mMask(std::bit_ceil(checkCapacity(capacity)) - 1)
+        , mSlots(std::make_unique<Slot[]>(mMask + 1))
+    {
+    }
+
+    /// @brief  Destructor, destroying any values not received
+    ~Channel()
+    {
+        const std::size_t tail = mTail.load(std::memory_order_relaxed);
+        for (std::size_t head = mHead.load(std::memory_order_relaxed); head != tail; ++head)
+        {
+            slot(head)->~T();
+        }
+    }
+
+    Channel(const Channel &) = delete;
+    Channel &operator=(const Channel &) = delete;
+
+    /// @brief  Sends a value, waiting whilst the channel is full
+    /// @param  value   The value, moved into the channel
+    /// @param  token   Ends the wait once stopped
+    /// @returns    False, without sending, if stopped whilst full or closed
+    template<typename U>
+    bool send(U &&value, const std::stop_token &token = std::stop_token())
+    {
+        while (true)
+        {
+            const Result result = trySendOne(value);
+            if (result != Result::FULL)
+            {
+                return result == Result::DONE;
+            }
+            if (!waitForSpace(token))
+            {
+                return false;
+            }
+        }
+    }
+
+    /// @brief  Sends a value if there is room for it, without waiting
+    /// @param  value   The value, only moved from if sent
+    /// @returns    False if the channel is full or closed
+    template<typename U>
+    bool trySend(U &&value)
+    {
+        return trySendOne(value) == Result::DONE;
+    }
+
+    /// @brief  Sends a batch of values, as many at a time as there is room
+    ///         for, waiting whilst the channel is full
+    /// @param  values  The values, each moved from once sent
+    /// @param  token   Ends the wait once stopped
+    /// @returns    The number of values sent, which is fewer than given only
+    ///             if stopped whilst full, or closed
+    std::size_t sendBulk(std::span<T> values, const std::stop_token &token = std::stop_token())
+    {
+        std::size_t sent = 0;
+        while (sent < values.size())
+        {
+            const std::size_t count = trySendSome(values.subspan(sent));
+            sent += count;
+            if (count == 0 && (closed() || !waitForSpace(token)))
+            {
+                break;
+            }
+        }
+        return sent;
+    }
+
+    /// @brief  Receives a value, waiting whilst the channel is empty. Values
+    ///         already sent are received even once a stop has been requested.
+    ///         Receiving thread only, unless MPMC, where a receiver waiting its
+    ///         turn behind another is only woken by a stop once that one
+    ///         has received.
+    /// @param  token   Ends the wait once stopped
+    /// @returns    The value, or nothing if stopped whilst empty, or the
+    ///             channel is closed and empty
+    std::optional<T> recv(const std::stop_token &token = std::stop_token())
+    {
+        std::optional<T> value;
+        receive(std::span<T>(), token, &value);
+        return value;
+    }
+
+    /// @brief  Receives a value if there is one, without waiting. Receiving
+    ///         thread only, unless MPMC.
+    std::optional<T> tryRecv()
+    {
+        const ReceiveLock turn(mReceiveMutex);
+        std::optional<T> value;
+        if (available() > 0)
+        {
+            value.emplace(take(mHead.load(std::memory_order_relaxed)));
+            release(1);
+        }
+        return value;
+    }
+
+    /// @brief  Receives up to out.size() values at once, waiting whilst the
+    ///         channel is empty. Receiving thread only, unless MPMC.
+    /// @param  out     Storage for the values received
+    /// @param  token   Ends the wait once stopped
+    /// @returns    The number of values received, zero only if stopped whilst
+    ///             empty, or if the channel is closed and empty
+    std::size_t recvUpTo(std::span<T> out, const std::stop_token &token = std::stop_token())
+    {
+        return out.empty() ? 0 : receive(out, token, nullptr);
+    }
+
+    /// @brief  Refuses any further values, waking every waiting thread. The
+    ///         receiver still receives the values already sent.
+    void close()
+    {
+        {
+            std::lock_guard lock(mMutex);
+            mClosed.store(true);
+        }
+        mNotEmpty.notify_all();
+        mNotFull.notify_all();
+    }
+
+    /// @brief  Whether the channel has been closed
+    bool closed() const
+    {
+        return mClosed.load();
+    }
+
+    /// @brief  The number of values waiting, which may already be out of date
+    std::size_t size() const
+    {
+        return mTail.load(std::memory_order_relaxed) - mHead.load(std::memory_order_relaxed);
+    }
+
+    /// @brief  The most values held at once
+    std::size_t capacity() const
+    {
+        return mMask + 1;
+    }
+
+private:
+    /// @brief  The outcome of trying to send
+    enum class Result
+    {
+        DONE,
+        FULL,
+        CLOSED,
+    };
+
+    /// @brief  Storage for a single value
+    struct Slot
+    {
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    /// @brief  Throws if a capacity is zero
+    static std::size_t checkCapacity(std::size_t capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument("Channel: the capacity must be at least one");
+        }
+        return capacity;
+    }
+
+    /// @brief  The value at the given index
+    T *slot(std::size_t index)
+    {
+        return std::launder(reinterpret_cast<T *>(mSlots[index & mMask].storage));
+    }
+
+    /// @brief  Moves the value out of the given index, destroying it
+    T take(std::size_t index)
+    {
+        T *value = slot(index);
+        T taken(std::move(*value));
+        value->~T();
+        return taken;
+    }
+
+    /// @brief  Holds one side's mutex, if that side may have many threads
+    template<bool MANY>
+    struct SideLock
+    {
+        explicit SideLock(std::mutex &mutex)
+        {
+            if constexpr (MANY)
+            {
+                lock = std::unique_lock(mutex);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock;
+    };
+
+    /// @brief  Held by a sender whilst sending
+    using SendLock = SideLock<KIND != ChannelKind::SPSC>;
+    /// @brief  Held by a receiver whilst receiving, including whilst waiting
+    using ReceiveLock = SideLock<KIND == ChannelKind::MPMC>;
+
+    /// @brief  Tries to send a single value
+    template<typename U>
+    Result trySendOne(U &value)
+    {
+        const SendLock lock(mSendMutex);
+        if (mClosed.load(std::memory_order_relaxed))
+        {
+            return Result::CLOSED;
+        }
+        const std::size_t tail = mTail.load(std::memory_order_relaxed);
+        if (space(tail) == 0)
+        {
+            return Result::FULL;
+        }
+        new (mSlots[tail & mMask].storage) T(std::forward<U>(value));
+        publish(tail + 1);
+        return Result::DONE;
+    }
+
+    /// @brief  Sends as many of the values as there is room for
+    /// @returns    The number sent
+    std::size_t trySendSome(std::span<T> values)
+    {
+        const SendLock lock(mSendMutex);
+        if (mClosed.load(std::memory_order_relaxed))
+        {
+            return 0;
+        }
+        const std::size_t tail = mTail.load(std::memory_order_relaxed);
+        const std::size_t count = std::min(values.size(), space(tail));
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            new (mSlots[(tail + i) & mMask].storage) T(std::move(values[i]));
+        }
+        if (count > 0)
+        {
+            publish(tail + count);
+        }
+        return count;
+    }
+
+    /// @brief  The room left for sending, refreshing the senders' copy of the
+    ///         receiver's index only once the old copy shows the ring full.
+    ///         Must be called by the only sender, or with the senders' mutex.
+    std::size_t space(std::size_t tail)
+    {
+        if (tail - mCachedHead == capacity())
+        {
+            mCachedHead = mHead.load(std::memory_order_acquire);
+        }
+        return capacity() - (tail - mCachedHead);
+    }
+
+    /// @brief  The values ready to receive, refreshing the receiver's copy of
+    ///         the senders' index only once the old copy shows none
+    std::size_t available()
+    {
+        const std::size_t head = mHead.load(std::memory_order_relaxed);
+        if (mCachedTail == head)
+        {
+            mCachedTail = mTail.load(std::memory_order_acquire);
+        }
+        return mCachedTail - head;
+    }
+
+    /// @brief  Makes values up to the given index visible to the receiver,
+    ///         waking it if it is waiting
+    void publish(std::size_t tail)
+    {
+        // Either the receiver registering to wait sees the new values, or
+        // they are published after it registered, and it is woken here. The
+        // flag is cleared by whichever thread wakes it, so only one does.
+        mTail.store(tail, std::memory_order_seq_cst);
+        if (mReceiverWaiting.load(std::memory_order_seq_cst) &&
+            mReceiverWaiting.exchange(false, std::memory_order_seq_cst))
+        {
+            {
+                std::lock_guard lock(mMutex);
+            }
+            mNotEmpty.notify_one();
+        }
+    }
+
+    /// @brief  Frees the given number of values' slots for the senders,
+    ///         waking any that are waiting once there is room enough
+    void release(std::size_t count)
+    {
+        const std::size_t head = mHead.load(std::memory_order_relaxed) + count;
+        mHead.store(head, std::memory_order_seq_cst);
+        if (mSendersWaiting.load(std::memory_order_seq_cst) &&
+            capacity() - (mTail.load(std::memory_order_relaxed) - head) >= wakeSpace() &&
+            mSendersWaiting.exchange(false, std::memory_order_seq_cst))
+        {
+            {
+                std::lock_guard lock(mMutex);
+            }
+            mNotFull.notify_all();
+        }
+    }
+
+    /// @brief  The room a waiting sender waits for, half the channel, so that
+    ///         senders held back are woken to send a run of values, rather
+    ///         than one at a time
+    std::size_t wakeSpace() const
+    {
+        return std::max<std::size_t>(capacity() / 2, 1);
+    }
+
+    /// @brief  Waits for room to send
+    /// @returns    False if stopped or closed
+    bool waitForSpace(const std::stop_token &token)
+    {
+        std::unique_lock lock(mMutex);
+        // Every sender registers again before each check, as another may have
+        // cleared the flag, on being woken along with it
+        const bool ready = mNotFull.wait(lock, token, [this]() {
+            mSendersWaiting.store(true, std::memory_order_seq_cst);
+            return mClosed.load(std::memory_order_relaxed) ||
+                capacity() - (mTail.load(std::memory_order_seq_cst) -
+                mHead.load(std::memory_order_seq_cst)) >= wakeSpace();
+        });
+        return ready && !mClosed.load(std::memory_order_relaxed);
+    }
+
+    /// @brief  Waits for a value, then receives either one into single, or
+    ///         up to out.size() into out
+    std::size_t receive(std::span<T> out, const std::stop_token &token, std::optional<T> *single)
+    {
+        const ReceiveLock turn(mReceiveMutex);
+        std::size_t count = available();
+        if (count == 0)
+        {
+            std::unique_lock lock(mMutex);
+            mNotEmpty.wait(lock, token, [this]() {
+                mReceiverWaiting.store(true, std::memory_order_seq_cst);
+                return mClosed.load(std::memory_order_relaxed) ||
+                    mTail.load(std::memory_order_seq_cst) != mHead.load(std::memory_order_relaxed);
+            });
+            mReceiverWaiting.store(false, std::memory_order_relaxed);
+            lock.unlock();
+            // Values sent before closing are still received
+            count = available();
+            if (count == 0)
+            {
+                return 0;
+            }
+        }
+
+        const std::size_t head = mHead.load(std::memory_order_relaxed);
+        if (single != nullptr)
+        {
+            count = 1;
+            single->emplace(take(head));
+        }
+        else
+        {
+            count = std::min(count, out.size());
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                out[i] = take(head + i);
+            }
+        }
+        release(count);
+        return count;
+    }
+
+    // The read-mostly ring comes first, then the senders' state, the
+    // receiver's state, and the waiting state, each on lines of their own, so
+    // that the two sides do not share a line they write.
+
+    /// @brief  Index mask, the capacity being a power of two
+    const std::size_t mMask;
+    /// @brief  The ring of values
+    const std::unique_ptr<Slot[]> mSlots;
+    /// @brief  The index of the next value sent
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mTail{ 0 };
+    /// @brief  The senders' copy of mHead, which may be behind it
+    std::size_t mCachedHead = 0;
+    /// @brief  Taken by each sender in turn, unless SPSC
+    std::mutex mSendMutex;
+    /// @brief  The index of the next value received
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mHead{ 0 };
+    /// @brief  The receiver's copy of mTail, which may be behind it
+    std::size_t mCachedTail = 0;
+    /// @brief  Taken by each receiver in turn, for MPMC only
+    std::mutex mReceiveMutex;
+    /// @brief  Mutex taken only to wait, or to wake a waiting thread
+    alignas(CACHE_LINE_SIZE) std::mutex mMutex;
+    /// @brief  Signalled once values have been sent, to a waiting receiver
+    std::condition_variable_any mNotEmpty;
+    /// @brief  Signalled once values have been received, to waiting senders
+    std::condition_variable_any mNotFull;
+    /// @brief  Set whilst any sender may be waiting
+    std::atomic<bool> mSendersWaiting{ false };
+    /// @brief  Set whilst the receiver may be waiting
+    std::atomic<bool> mReceiverWaiting{ false };
+    /// @brief  Set once the channel refuses new values
+    std::atomic<bool> mClosed{ false };
+};
@@ -0,0 +1,133 @@
+/**
+ * @file    colour.h
+ *
+ * @brief   Terminal colours used to tell the threads of each example apart.
+ *          Every escape sequence is built by the compiler, so selecting a
+ *          colour never formats or allocates a string at run time.
+ *
+ *          Defining LOG_NO_COLOUR, e.g. -DLOG_NO_COLOUR, removes every escape
+ *          sequence at compile time, for output that is not going to a
+ *          terminal.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+/// @brief  An ANSI terminal colour, such as 31 for red
+class Colour
+{
+public:
+    /// @brief  Whether colour escape sequences are written at all
+#if defined(LOG_NO_COLOUR)
+    static constexpr bool ENABLED = false;
+#else
+    static constexpr bool ENABLED = true;
+#endif
+
+    /// @brief  The number of colour codes with a precomputed escape sequence
+    static constexpr int CODES = 108;
+
+    /// @brief  Constructor
+    /// @param  code    The ANSI colour code, or -1 for no colour
+    constexpr explicit Colour(int code) : mCode(code) {}
+
+    /// @brief  No colour, leaving the terminal as it is
+    static constexpr Colour none()
+    {
+        return Colour(-1);
+    }
+
+    /// @brief  The ANSI colour code
+    constexpr int code() const
+    {
+        return mCode;
+    }
+
+    /// @brief  The escape sequence to switch to this colour, empty if there is
+    ///         no colour or colour is disabled
+    constexpr std::string_view prefix() const
+    {
+        if (!ENABLED || mCode < 0 || mCode >= CODES)
+        {
+            return {};
+        }
+        return std::string_view(TABLE[mCode].text.data(), TABLE[mCode].length);
+    }
+
+    /// @brief  The escape sequence to return to normal after prefix(), empty
+    ///         if prefix() is
+    constexpr std::string_view suffix() const
+    {
+        return prefix().empty() ? std::string_view() : NORMAL;
+    }
+
+    constexpr bool operator==(const Colour &) const = default;
+
+private:
+    /// @brief  A single "\033[1;<code>m" escape sequence, stored inline
+    struct Escape
+    {
+        std::array<char, 8> text{};
+        std::size_t length = 0;
+    };
+
+    /// @brief  Builds the escape sequence for every colour code
+    static constexpr std::array<Escape, CODES> makeTable()
+    {
+        std::array<Escape, CODES> table{};
+        for (int code = 0; code < CODES; ++code)
+        {
+            Escape &entry = table[code];
+            for (char c : std::string_view("\033[1;"))
+            {
+                entry.text[entry.length++] = c;
+            }
+            if (code >= 100)
+            {
+                entry.text[entry.length++] = static_cast<char>('0' + code / 100);
+            }
+            if (code >= 10)
+            {
+                entry.text[entry.length++] = static_cast<char>('0' + code / 10 % 10);
+            }
+            entry.text[entry.length++] = static_cast<char>('0' + code % 10);
+            entry.text[entry.length++] = 'm';
+        }
+        return table;
+    }
+
+    /// @brief  The escape sequence to return to normal
+    static constexpr std::string_view NORMAL = "\033[0m";
+
+    /// @brief  The escape sequences, computed by the compiler
+    static const std::array<Escape, CODES> TABLE;
+
+    /// @brief  The ANSI colour code
+    int mCode;
+};
+
+// Defined outside the class, as makeTable() cannot be used before the class
+// is complete
+inline constexpr std::array<Colour::Escape, Colour::CODES> Colour::TABLE =
+    Colour::makeTable();
+
+static_assert(!Colour::ENABLED || Colour(31).prefix() == "\033[1;31m");
+
+/// @brief  Sets the terminal text red
+inline constexpr Colour COL_RED{ 31 };
+/// @brief  Sets the terminal text green
+inline constexpr Colour COL_GRN{ 32 };
+/// @brief  Sets the terminal text yellow
+inline constexpr Colour COL_YLW{ 33 };
+/// @brief  Sets the terminal text blue
+inline constexpr Colour COL_BLU{ 34 };
+/// @brief  Sets the terminal text magenta
+inline constexpr Colour COL_MAG{ 35 };
+/// @brief  Sets the terminal text cyan
+inline constexpr Colour COL_CYN{ 36 };
@@ -0,0 +1,718 @@
+/**
+ * @file    coroutine.h
+ *
+ * @brief   C++20 coroutines run on a small pool of std::jthreads, as an
+ *          alternative to giving every blocking wait a thread of its own. A
+ *          suspended CoTask costs only its heap allocated frame, so tens of
+ *          thousands of them can wait on a handful of threads.
+ *
+ *          Within a CoTask, three awaitables stand in for the blocking waits
+ *          of the earlier examples:
+ *
+ *          - co_await dataReady(signal, complete), for a CoSignal's data to
+ *            satisfy a predicate, as with DataSignal::wait()
+ *          - co_await sleepFor(duration), as with interruptibleSleep()
+ *          - co_await stopRequested(), for the task's stop token
+ *
+ *          Each is ended early by a stop request on the task's std::stop_token,
+ *          through a std::stop_callback registered while it is suspended, and
+ *          yields false if so. Whichever of the wait ending and the stop
+ *          request comes first resumes the coroutine, exactly once, by queueing
+ *          it on the executor's ThreadPool.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+#include "thread-pool.h"
+
+class CoExecutor;
+
+/// @brief  A coroutine to be run on a CoExecutor. It does not start until it
+///         has been passed to CoExecutor::spawn(), after which the executor
+///         owns it, and its frame is freed as soon as it finishes.
+class CoTask
+{
+public:
+    /// @brief  The coroutine state
+    struct promise_type
+    {
+        /// @brief  Destructor, telling the executor the task has finished
+        ~promise_type();
+
+        CoTask get_return_object()
+        {
+            return CoTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        /// @brief  Nothing is run until the task is spawned
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        /// @brief  The frame is freed as soon as the task finishes
+        std::suspend_never final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void() noexcept
+        {
+        }
+
+        /// @brief  As with ThreadPool::post(), there is no one to hand an
+        ///         exception to, so anything thrown is discarded
+        void unhandled_exception() noexcept
+        {
+        }
+
+        /// @brief  Ends the task's waits early when a stop is requested
+        std::stop_token token;
+        /// @brief  The executor running the task, once spawned
+        CoExecutor *executor = nullptr;
+    };
+
+    /// @brief  The handle of a CoTask coroutine
+    using Handle = std::coroutine_handle<promise_type>;
+
+    CoTask(CoTask &&other) noexcept
+        : mHandle(std::exchange(other.mHandle, nullptr))
+    {
+    }
+
+    CoTask &operator=(CoTask &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (mHandle)
+            {
+                mHandle.destroy();
+            }
+            mHandle = std::exchange(other.mHandle, nullptr);
+        }
+        return *this;
+    }
+
+    /// @brief  Destructor, freeing the coroutine if it was never spawned
+    ~CoTask()
+    {
+        if (mHandle)
+        {
+            mHandle.destroy();
+        }
+    }
+
+private:
+    friend class CoExecutor;
+
+    /// @brief  Constructor, from get_return_object()
+    explicit CoTask(Handle handle)
+        : mHandle(handle)
+    {
+    }
+
+    /// @brief  The coroutine, until spawned
+    Handle mHandle;
+};
+
+/// @brief  The part of every awaitable that suspends a CoTask, and makes sure
+///         that it is resumed exactly once, either when the wait ends or when
+///         a stop is requested, whichever comes first.
+class CoWaiter
+{
+public:
+    CoWaiter() = default;
+    CoWaiter(const CoWaiter &) = delete;
+    CoWaiter &operator=(const CoWaiter &) = delete;
+
+protected:
+    /// @brief  Resumes the coroutine with the given result, unless something
+    ///         already has. The waiter must still be registered with whatever
+    ///         calls this, which keeps it alive for the duration of the call.
+    /// @param  result  The value of the co_await expression
+    void wake(bool result);
+
+    /// @brief  Records the coroutine about to be suspended. Must be called
+    ///         first from await_suspend().
+    /// @param  handle  The coroutine
+    void prepare(CoTask::Handle handle)
+    {
+        mHandle = handle;
+        mExecutor = handle.promise().executor;
+    }
+
+    /// @brief  Finishes suspending, once the wait itself has been registered,
+    ///         by registering the stop callback. Must be the last use of the
+    ///         waiter in await_suspend(), as the coroutine may be resumed on
+    ///         another thread as soon as this returns true.
+    /// @param  token   The stop token of the coroutine
+    /// @returns    The value for await_suspend() to return, false if the wait
+    ///             has already ended and the coroutine should carry on
+    bool arm(const std::stop_token &token)
+    {
+        if (token.stop_possible())
+        {
+            mStop.emplace(token, StopWake{ this });
+        }
+        // Anything waking the coroutine whilst it was being suspended could
+        // not resume it, as it was not yet suspended, so carry on instead
+        return mState.exchange(ARMED, std::memory_order_acq_rel) != FIRED;
+    }
+
+    /// @brief  Removes the stop callback. Must be called first from
+    ///         await_resume(), and waits for the callback to finish, if it is
+    ///         running on another thread.
+    /// @returns    The value of the co_await expression
+    bool disarm()
+    {
+        mStop.reset();
+        return mResult;
+    }
+
+    /// @brief  Sets the result where the wait ends without suspending
+    void complete(bool result)
+    {
+        mResult = result;
+    }
+
+private:
+    friend class CoExecutor;
+
+    /// @brief  The stop callback, which wakes the waiter with false
+    struct StopWake
+    {
+        CoWaiter *waiter;
+
+        void operator()() noexcept
+        {
+            waiter->wake(false);
+        }
+    };
+
+    /// @brief  The stages of suspending
+    enum State : int
+    {
+        SUSPENDING,
+        ARMED,
+        FIRED,
+    };
+
+    /// @brief  The suspended coroutine
+    std::coroutine_handle<> mHandle;
+    /// @brief  The executor that resumes it
+    CoExecutor *mExecutor = nullptr;
+    /// @brief  Set by the first to wake the coroutine
+    std::atomic<bool> mClaimed{ false };
+    /// @brief  The stage of suspending reached
+    std::atomic<int> mState{ SUSPENDING };
+    /// @brief  The value of the co_await expression
+    bool mResult = false;
+    /// @brief  Wakes the coroutine on a stop request whilst suspended
+    std::optional<std::stop_callback<StopWake>> mStop;
+};
+
+/// @brief  Runs CoTasks on a ThreadPool, plus a single timer thread for
+///         sleepFor(). Every task spawned without a token of its own is given
+///         the executor's, which is stopped on destruction.
+class CoExecutor
+{
+public:
+    /// @brief  The clock used by sleepFor()
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief  Constructor, starting the threads
+    /// @param  threads The number of threads resuming coroutines
+    explicit CoExecutor(std::size_t threads = std::thread::hardware_concurrency())
+        : mPool(threads)
+        , mTimer(std::bind_front(&CoExecutor::timer, this))
+    {
+    }
+
+    /// @brief  Destructor. A stop is requested on the executor's token, and
+    ///         every task is waited for. Tasks spawned with tokens of their
+    ///         own must have been stopped through those.
+    ~CoExecutor()
+    {
+        mStop.request_stop();
+        wait();
+        mTimer.request_stop();
+        mTimer.join();
+    }
+
+    CoExecutor(const CoExecutor &) = delete;
+    CoExecutor &operator=(const CoExecutor &) = delete;
+
+    /// @brief  Starts a task, stopped along with the executor
+    /// @param  task    The task, which the executor takes ownership of
+    void spawn(CoTask task)
+    {
+        spawn(std::move(task), mStop.get_token());
+    }
+
+    /// @brief  Starts a task with a stop token of its own
+    /// @param  task    The task, which the executor takes ownership of
+    /// @param  token   Ends the task's waits when a stop is requested
+    void spawn(CoTask task, std::stop_token token)
+    {
+        CoTask::Handle handle = std::exchange(task.mHandle, nullptr);
+        handle.promise().token = std::move(token);
+        handle.promise().executor = this;
+        {
+            std::lock_guard lock(mActiveMutex);
+            ++mActive;
+        }
+        resume(handle);
+    }
+
+    /// @brief  Requests a stop on the executor's token, ending the waits of
+    ///         every task spawned without a token of its own
+    void requestStop()
+    {
+        mStop.request_stop();
+    }
+
+    /// @brief  Waits until every task has finished
+    void wait()
+    {
+        std::unique_lock lock(mActiveMutex);
+        mActiveCv.wait(lock, [this]() { return mActive == 0; });
+    }
+
+    /// @brief  The number of tasks spawned and not yet finished
+    std::size_t active() const
+    {
+        std::lock_guard lock(mActiveMutex);
+        return mActive;
+    }
+
+    /// @brief  The number of threads resuming coroutines
+    std::size_t threads() const
+    {
+        return mPool.size();
+    }
+
+private:
+    friend class CoWaiter;
+    friend struct CoTask::promise_type;
+    friend class SleepAwaiter;
+
+    /// @brief  Queues a coroutine to be resumed. The inline Task storage
+    ///         holds the handle, so this does not allocate.
+    void resume(std::coroutine_handle<> handle)
+    {
+        mPool.push(Task([handle]() { handle.resume(); }));
+    }
+
+    /// @brief  Called as each task's frame is freed
+    void finished()
+    {
+        // Notified under the lock, so that the destructor cannot return
+        // before this has finished with the executor
+        std::lock_guard lock(mActiveMutex);
+        if (--mActive == 0)
+        {
+            mActiveCv.notify_all();
+        }
+    }
+
+    /// @brief  The position of a sleeping waiter in mTimers
+    using TimerEntry = std::multimap<Clock::time_point, CoWaiter *>::iterator;
+
+    /// @brief  Adds a sleeping waiter, woken with true at the deadline
+    TimerEntry addTimer(Clock::time_point deadline, CoWaiter *waiter)
+    {
+        std::lock_guard lock(mTimerMutex);
+        const bool earliest = mTimers.empty() || deadline < mTimers.begin()->first;
+        const TimerEntry entry = mTimers.emplace(deadline, waiter);
+        if (earliest)
+        {
+            mTimerCv.notify_one();
+        }
+        return entry;
+    }
+
+    /// @brief  Removes a sleeping waiter, if it has not already been woken
+    void cancelTimer(Clock::time_point deadline, CoWaiter *waiter)
+    {
+        std::lock_guard lock(mTimerMutex);
+        auto [first, last] = mTimers.equal_range(deadline);
+        for (; first != last; ++first)
+        {
+            if (first->second == waiter)
+            {
+                mTimers.erase(first);
+                return;
+            }
+        }
+    }
+
+    /// @brief  The timer thread, waking each sleeping waiter when it is due.
+    ///         Waiters are woken under mTimerMutex, so that one cannot be
+    ///         freed by cancelTimer() whilst being woken.
+    void timer(std::stop_token token)
+    {
+        std::unique_lock lock(mTimerMutex);
+        while (!token.stop_requested())
+        {
+            if (mTimers.empty())
+            {
+                mTimerCv.wait(lock, token, [this]() { return !mTimers.empty(); });
+                continue;
+            }
+            const Clock::time_point next = mTimers.begin()->first;
+            if (Clock::now() < next)
+            {
+                mTimerCv.wait_until(lock, token, next, [this, next]() {
+                    return mTimers.empty() || mTimers.begin()->first < next;
+                });
+                continue;
+            }
+            const Clock::time_point now = Clock::now();
+            while (!mTimers.empty() && mTimers.begin()->first <= now)
+            {
+                CoWaiter *waiter = mTimers.begin()->second;
+                mTimers.erase(mTimers.begin());
+                waiter->wake(true);
+            }
+        }
+    }
+
+    /// @brief  The threads resuming coroutines, declared first so that it is
+    ///         the last thing destroyed
+    ThreadPool mPool;
+    /// @brief  Stops every task spawned without a token of its own
+    std::stop_source mStop;
+    /// @brief  Mutex protecting mActive
+    mutable std::mutex mActiveMutex;
+    /// @brief  Signalled when the last task finishes
+    std::condition_variable mActiveCv;
+    /// @brief  The number of tasks not yet finished
+    std::size_t mActive = 0;
+    /// @brief  Mutex protecting the sleeping waiters
+    std::mutex mTimerMutex;
+    /// @brief  Signalled when an earlier deadline is added
+    std::condition_variable_any mTimerCv;
+    /// @brief  The sleeping waiters, by deadline
+    std::multimap<Clock::time_point, CoWaiter *> mTimers;
+    /// @brief  The timer thread, declared last so that it starts last
+    std::jthread mTimer;
+};
+
+inline CoTask::promise_type::~promise_type()
+{
+    if (executor != nullptr)
+    {
+        executor->finished();
+    }
+}
+
+inline void CoWaiter::wake(bool result)
+{
+    if (mClaimed.exchange(true, std::memory_order_acq_rel))
+    {
+        return;
+    }
+    mResult = result;
+    // Copied first, as the coroutine may be resumed, and this freed, as soon
+    // as the state is changed
+    const std::coroutine_handle<> handle = mHandle;
+    CoExecutor *executor = mExecutor;
+    if (mState.exchange(FIRED, std::memory_order_acq_rel) == ARMED)
+    {
+        executor->resume(handle);
+    }
+}
+
+/// @brief  Awaitable suspending until a stop is requested on the task's token
+class StopAwaiter : public CoWaiter
+{
+public:
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(CoTask::Handle handle)
+    {
+        prepare(handle);
+        mToken = handle.promise().token;
+        if (mToken.stop_requested())
+        {
+            complete(true);
+            return false;
+        }
+        return arm(mToken);
+    }
+
+    /// @returns    True, once a stop has been requested
+    bool await_resume()
+    {
+        disarm();
+        return true;
+    }
+
+private:
+    /// @brief  The token waited on
+    std::stop_token mToken;
+};
+
+/// @brief  Awaitable suspending for a time, or until a stop is requested
+class SleepAwaiter : public CoWaiter
+{
+public:
+    explicit SleepAwaiter(CoExecutor::Clock::duration duration)
+        : mDuration(duration)
+    {
+    }
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool await_suspend(CoTask::Handle handle)
+    {
+        prepare(handle);
+        const std::stop_token &token = handle.promise().token;
+        if (token.stop_requested())
+        {
+            complete(false);
+            return false;
+        }
+        mOwner = handle.promise().executor;
+        mDeadline = CoExecutor::Clock::now() + mDuration;
+        mOwner->addTimer(mDeadline, this);
+        return arm(token);
+    }
+
+    /// @returns    True if the whole time passed, false if a stop was
+    ///             requested first
+    bool await_resume()
+    {
+        const bool slept = disarm();
+        if (mOwner != nullptr)
+        {
+            mOwner->cancelTimer(mDeadline, this);
+        }
+        return slept;
+    }
+
+private:
+    /// @brief  The time to sleep for
+    CoExecutor::Clock::duration mDuration;
+    /// @brief  When the sleep ends
+    CoExecutor::Clock::time_point mDeadline;
+    /// @brief  The executor holding the timer, once added
+    CoExecutor *mOwner = nullptr;
+};
+
+/// @brief  Suspends the calling CoTask until a stop is requested on its token
+inline StopAwaiter stopRequested()
+{
+    return StopAwaiter();
+}
+
+/// @brief  Suspends the calling CoTask for the given time, without holding a
+///         thread, ending early if a stop is requested
+/// @param  duration    The time to sleep for
+/// @returns    An awaitable yielding true if the whole time passed
+template<typename Rep, typename Period>
+SleepAwaiter sleepFor(std::chrono::duration<Rep, Period> duration)
+{
+    return SleepAwaiter(std::chrono::duration_cast<CoExecutor::Clock::duration>(duration));
+}
+
+/// @brief  Data that CoTasks can wait on, in the manner of DataSignal, but by
+///         suspending rather than blocking a thread. Setting the data resumes
+///         any waiters whose predicate it then satisfies.
+template<typename T>
+class CoSignal
+{
+    /// @brief  An entry in the intrusive list of waiters, so that waiting
+    ///         never allocates beyond the coroutine frame
+    struct Link
+    {
+        virtual ~Link() = default;
+
+        /// @brief  Whether the data completes the waiter
+        virtual bool check(const T &)
+        {
+            return false;
+        }
+
+        /// @brief  Wakes the waiter
+        virtual void fire()
+        {
+        }
+
+        /// @brief  Adds another link after this one
+        void insert(Link &link)
+        {
+            link.prev = this;
+            link.next = next;
+            next->prev = &link;
+            next = &link;
+        }
+
+        /// @brief  Removes this link from its list, if it is in one
+        void unlink()
+        {
+            prev->next = next;
+            next->prev = prev;
+            prev = next = this;
+        }
+
+        Link *prev = this;
+        Link *next = this;
+    };
+
+public:
+    /// @brief  Constructor
+    /// @param  initial The data before it is first set
+    explicit CoSignal(T initial = T())
+        : mData(std::move(initial))
+    {
+    }
+
+    CoSignal(const CoSignal &) = delete;
+    CoSignal &operator=(const CoSignal &) = delete;
+
+    /// @brief  Sets the data, resuming every waiter it completes
+    /// @param  data    The new data
+    void set(T data)
+    {
+        std::lock_guard lock(mMutex);
+        mData = std::move(data);
+        for (Link *link = mHead.next; link != &mHead;)
+        {
+            Link *next = link->next;
+            if (link->check(mData))
+            {
+                link->unlink();
+                link->fire();
+            }
+            link = next;
+        }
+    }
+
+    /// @brief  A copy of the current data
+    T value() const
+    {
+        std::lock_guard lock(mMutex);
+        return mData;
+    }
+
+    /// @brief  Awaitable suspending until the data satisfies a predicate
+    template<typename Complete>
+    class Awaiter : public CoWaiter
+    {
+    public:
+        Awaiter(CoSignal &signal, Complete complete)
+            : mSignal(signal)
+            , mLink(*this)
+            , mComplete(std::move(complete))
+        {
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(CoTask::Handle handle)
+        {
+            prepare(handle);
+            const std::stop_token &token = handle.promise().token;
+            {
+                std::lock_guard lock(mSignal.mMutex);
+                if (mComplete(mSignal.mData))
+                {
+                    complete(true);
+                    return false;
+                }
+                if (token.stop_requested())
+                {
+                    complete(false);
+                    return false;
+                }
+                mSignal.mHead.insert(mLink);
+            }
+            return arm(token);
+        }
+
+        /// @returns    True if the data satisfied the predicate, false if a
+        ///             stop was requested first
+        bool await_resume()
+        {
+            const bool ready = disarm();
+            std::lock_guard lock(mSignal.mMutex);
+            mLink.unlink();
+            return ready;
+        }
+
+    private:
+        /// @brief  The entry in the signal's list of waiters
+        struct WaiterLink : Link
+        {
+            explicit WaiterLink(Awaiter &awaiter)
+                : awaiter(awaiter)
+            {
+            }
+
+            bool check(const T &data) override
+            {
+                return awaiter.mComplete(data);
+            }
+
+            void fire() override
+            {
+                awaiter.wake(true);
+            }
+
+            Awaiter &awaiter;
+        };
+
+        /// @brief  The signal waited on
+        CoSignal &mSignal;
+        /// @brief  The entry in its list of waiters
+        WaiterLink mLink;
+        /// @brief  The predicate the data must satisfy
+        Complete mComplete;
+    };
+
+private:
+    /// @brief  Mutex protecting the data and the waiters
+    mutable std::mutex mMutex;
+    /// @brief  The data
+    T mData;
+    /// @brief  The head of the list of waiters
+    Link mHead;
+};
+
+/// @brief  Suspends the calling CoTask until a signal's data satisfies a
+///         predicate, ending early if a stop is requested
+/// @param  signal      The signal
+/// @param  complete    The predicate, called with the data under the
+///                     signal's lock
+/// @returns    An awaitable yielding true if the data satisfied the predicate
+template<typename T, typename Complete>
+typename CoSignal<T>::template Awaiter<Complete> dataReady(CoSignal<T> &signal,
+    Complete complete)
+{
+    return typename CoSignal<T>::template Awaiter<Complete>(signal, std::move(complete));
+}
@@ -0,0 +1,49 @@
+/**
+ * @file    cpu.h
+ *
+ * @brief   Small processor specific helpers shared by the lock-free pieces,
+ *          such as the cache line size used for padding and a busy-wait hint.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_X86 1
+#include <immintrin.h>
+#endif
+
+/// @brief  The cache line size assumed when padding shared data, to prevent
+///         values written by different threads from sharing a line. This is
+///         the standard library's figure for the target where it gives one.
+///         GCC warns that the figure may change with -mtune, which matters
+///         across a library's ABI, but these headers are compiled into each
+///         program, so the warning is silenced here.
+#if defined(__cpp_lib_hardware_interference_size)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winterference-size"
+#endif
+static constexpr std::size_t CACHE_LINE_SIZE = std::hardware_destructive_interference_size;
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#else
+static constexpr std::size_t CACHE_LINE_SIZE = 64;
+#endif
+
+/// @brief  Tells the processor that the caller is spinning, reducing power
+///         and freeing resources for a sibling hyper-thread
+inline void cpuRelax()
+{
+#if defined(CPU_X86)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
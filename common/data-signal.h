@@ -0,0 +1,223 @@
+/**
+ * @file    data-signal.h
+ *
+ * @brief   A value shared between a thread setting it and a worker waiting for
+ *          it to reach a condition, as used by the example 6 worker threads.
+ *
+ *          The general version is the pattern from example 6: every update
+ *          takes the mutex and wakes the worker, which then checks the
+ *          condition itself under the lock. For values that fit in a lock-free
+ *          std::atomic, the specialisation stores the value atomically and has
+ *          the setting thread check the condition instead. Updates that do not
+ *          meet the condition then never take a lock or wake the worker, which
+ *          sleeps in std::atomic::wait() until one does, or a stop is
+ *          requested.
+ *
+ *          Either may also wait until a deadline, giving up once it passes.
+ *          std::atomic::wait() cannot time out, so a timed waiter on the
+ *          atomic version parks on a condition variable instead, which an
+ *          update meeting the condition only notifies whilst one is waiting.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stop_token>
+#include <type_traits>
+
+/// @brief  Whether a DataSignal for the type can use the atomic version. The
+///         std::atomic is only named for trivially copyable types, as naming
+///         it for any other fails to compile.
+template<typename T>
+inline constexpr bool ATOMIC_SIGNAL = []() {
+    if constexpr (std::is_trivially_copyable_v<T>)
+    {
+        return std::atomic<T>::is_always_lock_free;
+    }
+    else
+    {
+        return false;
+    }
+}();
+
+/// @brief  A value protected by a mutex, waking the waiter on every update
+template<typename T, bool ATOMIC = ATOMIC_SIGNAL<T>>
+class DataSignal
+{
+public:
+    /// @brief  Constructor
+    /// @param  initial The initial value
+    explicit DataSignal(T initial)
+        : mData(initial)
+    {
+    }
+
+    DataSignal(const DataSignal &) = delete;
+    DataSignal &operator=(const DataSignal &) = delete;
+
+    /// @brief  Sets the value, waking the waiter to check its condition
+    /// @param  data    The new value
+    template<typename Pred>
+    void set(const T &data, Pred &&)
+    {
+        std::lock_guard lock(mMutex);
+        mData = data;
+        mCv.notify_all();
+    }
+
+    /// @brief  Waits until the value meets the condition, or a stop is
+    ///         requested. Only one thread may wait at a time.
+    /// @param  token       The stop token of the waiting thread
+    /// @param  complete    The condition, called with the value
+    /// @returns    True if the condition was met, false if stopped
+    template<typename Pred>
+    bool wait(const std::stop_token &token, Pred &&complete)
+    {
+        std::unique_lock lock(mMutex);
+        return mCv.wait(lock, token, [&]() { return complete(mData); });
+    }
+
+    /// @brief  Waits until the value meets the condition, a stop is requested
+    ///         or the deadline passes. Only one thread may wait at a time.
+    /// @param  token       The stop token of the waiting thread
+    /// @param  deadline    When to give up, never if the clock's maximum
+    /// @param  complete    The condition, called with the value
+    /// @returns    True if the condition was met, false if stopped or timed out
+    template<typename Clock, typename Duration, typename Pred>
+    bool waitUntil(const std::stop_token &token,
+        const std::chrono::time_point<Clock, Duration> &deadline, Pred &&complete)
+    {
+        if (deadline == std::chrono::time_point<Clock, Duration>::max())
+        {
+            return wait(token, complete);
+        }
+        std::unique_lock lock(mMutex);
+        return mCv.wait_until(lock, token, deadline, [&]() { return complete(mData); });
+    }
+
+private:
+    /// @brief  Mutex used to protect the data value
+    std::mutex mMutex;
+    /// @brief  Condition variable used to signal when the data changes
+    std::condition_variable_any mCv;
+    /// @brief  The data
+    T mData;
+};
+
+/// @brief  A lock-free value, only waking the waiter once the condition is met
+template<typename T>
+class DataSignal<T, true>
+{
+public:
+    /// @brief  Constructor
+    /// @param  initial The initial value
+    explicit DataSignal(T initial)
+        : mData(initial)
+    {
+    }
+
+    DataSignal(const DataSignal &) = delete;
+    DataSignal &operator=(const DataSignal &) = delete;
+
+    /// @brief  Sets the value, waking the waiter only if the condition is met
+    /// @param  data        The new value
+    /// @param  complete    The condition, checked here rather than by the
+    ///                     waiter, and so called from the setting thread
+    template<typename Pred>
+    void set(const T &data, Pred &&complete)
+    {
+        mData.store(data, std::memory_order_seq_cst);
+        if (complete(data))
+        {
+            wake();
+        }
+    }
+
+    /// @brief  Waits until the value meets the condition, or a stop is
+    ///         requested. Only one thread may wait at a time.
+    /// @param  token       The stop token of the waiting thread
+    /// @param  complete    The condition, called with the value
+    /// @returns    True if the condition was met, false if stopped
+    template<typename Pred>
+    bool wait(const std::stop_token &token, Pred &&complete)
+    {
+        std::stop_callback stop(token, [this]() { wake(); });
+        while (true)
+        {
+            // Read the count before checking, so that a wake between the check
+            // and the wait changes it, and the wait returns at once
+            const std::uint32_t seen = mWakes.load(std::memory_order_acquire);
+            if (complete(mData.load(std::memory_order_acquire)))
+            {
+                return true;
+            }
+            if (token.stop_requested())
+            {
+                return false;
+            }
+            mWakes.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    /// @brief  Waits until the value meets the condition, a stop is requested
+    ///         or the deadline passes. Only one thread may wait at a time.
+    /// @param  token       The stop token of the waiting thread
+    /// @param  deadline    When to give up, never if the clock's maximum
+    /// @param  complete    The condition, called with the value
+    /// @returns    True if the condition was met, false if stopped or timed out
+    template<typename Clock, typename Duration, typename Pred>
+    bool waitUntil(const std::stop_token &token,
+        const std::chrono::time_point<Clock, Duration> &deadline, Pred &&complete)
+    {
+        if (deadline == std::chrono::time_point<Clock, Duration>::max())
+        {
+            return wait(token, complete);
+        }
+        // Registered before the value is checked, so that an update either
+        // sees the waiter and notifies it, or is seen by the check
+        mTimedWaiter.store(true, std::memory_order_seq_cst);
+        bool met = false;
+        {
+            std::unique_lock lock(mMutex);
+            mCv.wait_until(lock, token, deadline, [&]() {
+                return met = complete(mData.load(std::memory_order_seq_cst));
+            });
+        }
+        mTimedWaiter.store(false, std::memory_order_relaxed);
+        return met;
+    }
+
+private:
+    /// @brief  Wakes the waiter to check the value and its stop token
+    void wake()
+    {
+        mWakes.fetch_add(1, std::memory_order_release);
+        mWakes.notify_one();
+        if (mTimedWaiter.load(std::memory_order_seq_cst))
+        {
+            // Taking the mutex means the waiter is either yet to check the
+            // value, or already waiting for this notification
+            std::lock_guard lock(mMutex);
+            mCv.notify_all();
+        }
+    }
+
+    /// @brief  The data
+    std::atomic<T> mData;
+    /// @brief  Changed each time the waiter is woken, the value it waits on
+    std::atomic<std::uint32_t> mWakes{ 0 };
+    /// @brief  Whether a waiter is parked on the condition variable, having
+    ///         given a deadline
+    std::atomic<bool> mTimedWaiter{ false };
+    /// @brief  Mutex for a timed waiter's condition variable
+    std::mutex mMutex;
+    /// @brief  The condition variable a timed waiter parks on
+    std::condition_variable_any mCv;
+};
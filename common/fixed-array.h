@@ -0,0 +1,141 @@
+/**
+ * @file    fixed-array.h
+ *
+ * @brief   A contiguous array whose capacity is fixed on construction, with
+ *          elements constructed in place, one at a time, and never moved.
+ *          This suits objects that may not move once created, such as those a
+ *          running thread refers to, which would otherwise each need a heap
+ *          allocation of their own behind a std::unique_ptr. Keeping them in
+ *          one block, each aligned as its type asks, lets a type aligned to
+ *          the cache line keep its neighbours off its lines.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+/// @brief  A fixed capacity array of elements constructed in place
+/// @tparam T   The element type, which need not be movable
+template<typename T>
+class FixedArray
+{
+public:
+    /// @brief  Constructor, allocating the storage for every element
+    /// @param  capacity    The most elements the array will hold
+    explicit FixedArray(std::size_t capacity)
+        : mCapacity(capacity)
+    {
+        if (mCapacity > 0)
+        {
+            mItems = static_cast<T *>(::operator new(mCapacity * sizeof(T),
+                std::align_val_t(alignof(T))));
+        }
+    }
+
+    /// @brief  Destructor, destroying every element, last first
+    ~FixedArray()
+    {
+        clear();
+        if (mItems != nullptr)
+        {
+            ::operator delete(mItems, std::align_val_t(alignof(T)));
+        }
+    }
+
+    FixedArray(const FixedArray &) = delete;
+    FixedArray &operator=(const FixedArray &) = delete;
+
+    /// @brief  Constructs a new element at the end
+    /// @param  args    The arguments to its constructor
+    /// @returns    The new element
+    /// @throws std::length_error if the array is full
+    template<typename... Args>
+    T &emplace_back(Args &&...args)
+    {
+        if (mSize == mCapacity)
+        {
+            throw std::length_error("FixedArray: capacity exceeded");
+        }
+        T *item = std::construct_at(mItems + mSize, std::forward<Args>(args)...);
+        ++mSize;
+        return *item;
+    }
+
+    /// @brief  Destroys every element, last first, keeping the storage
+    void clear() noexcept
+    {
+        while (mSize > 0)
+        {
+            std::destroy_at(mItems + --mSize);
+        }
+    }
+
+    /// @brief  The number of elements
+    std::size_t size() const noexcept
+    {
+        return mSize;
+    }
+
+    /// @brief  The most elements the array will hold
+    std::size_t capacity() const noexcept
+    {
+        return mCapacity;
+    }
+
+    /// @brief  Whether there are no elements
+    bool empty() const noexcept
+    {
+        return mSize == 0;
+    }
+
+    /// @brief  The element at the given index, which is not checked
+    T &operator[](std::size_t index) noexcept
+    {
+        return mItems[index];
+    }
+
+    /// @brief  The element at the given index, which is not checked
+    const T &operator[](std::size_t index) const noexcept
+    {
+        return mItems[index];
+    }
+
+    /// @brief  The last element, of which there must be one
+    T &back() noexcept
+    {
+        return mItems[mSize - 1];
+    }
+
+    /// @brief  Iteration over the elements, in the order constructed
+    T *begin() noexcept
+    {
+        return mItems;
+    }
+    T *end() noexcept
+    {
+        return mItems + mSize;
+    }
+    const T *begin() const noexcept
+    {
+        return mItems;
+    }
+    const T *end() const noexcept
+    {
+        return mItems + mSize;
+    }
+
+private:
+    /// @brief  The storage, uninitialised beyond mSize
+    T *mItems = nullptr;
+    /// @brief  The number of elements constructed
+    std::size_t mSize = 0;
+    /// @brief  The most elements the array will hold
+    const std::size_t mCapacity;
+};
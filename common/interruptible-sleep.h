@@ -0,0 +1,101 @@
+/**
+ * @file    interruptible-sleep.h
+ *
+ * @brief   A sleep that ends as soon as a stop is requested, so that a thread
+ *          polling its stop token between sleeps stops straight away rather
+ *          than at the end of its current delay. Also provides a way to
+ *          measure how long a thread took to stop once asked.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stop_token>
+
+/// @brief  Sleeps for the given delay, waking immediately if a stop is
+///         requested on the token.
+///
+///         This uses the same stop_token aware wait() as the thread pool
+///         examples, with a predicate that is only satisfied by the stop. The
+///         mutex and condition variable are only ever used by the calling
+///         thread, so each thread keeps one pair, rather than creating them,
+///         and allocating, on every call.
+/// @param  token   The stop token for the calling thread
+/// @param  delay   The time to sleep for
+/// @returns    True if the full delay passed, false if a stop was requested
+template<typename Rep, typename Period>
+bool interruptibleSleep(const std::stop_token &token,
+    const std::chrono::duration<Rep, Period> &delay)
+{
+    struct Waiter
+    {
+        std::mutex mutex;
+        std::condition_variable_any cv;
+    };
+    thread_local Waiter waiter;
+
+    // The predicate is never satisfied, so wait_for() returns false whether
+    // the delay passed or a stop was requested, leaving the token to tell
+    std::unique_lock lock(waiter.mutex);
+    waiter.cv.wait_for(lock, token, delay, []() { return false; });
+    return !token.stop_requested();
+}
+
+/// @brief  Records when a stop was requested on a token, so that the thread
+///         can report how long it took to notice and finish
+class StopLatency
+{
+public:
+    /// @brief  The clock used for the measurements
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief  Constructor
+    /// @param  token   The stop token to be watched
+    explicit StopLatency(const std::stop_token &token)
+        : mCallback(token, Record{ this })
+    {
+    }
+
+    StopLatency(const StopLatency &) = delete;
+    StopLatency &operator=(const StopLatency &) = delete;
+
+    /// @brief  Whether a stop has been requested yet
+    bool requested() const
+    {
+        return mRequested.load() != Clock::time_point();
+    }
+
+    /// @brief  The time since the stop was requested, or zero if it has not
+    std::chrono::microseconds elapsed() const
+    {
+        const Clock::time_point requested = mRequested.load();
+        if (requested == Clock::time_point())
+        {
+            return std::chrono::microseconds(0);
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            Clock::now() - requested);
+    }
+
+private:
+    /// @brief  The callback, run by the thread that requests the stop
+    struct Record
+    {
+        void operator()() const
+        {
+            owner->mRequested.store(Clock::now());
+        }
+        StopLatency *owner;
+    };
+
+    /// @brief  When the stop was requested, or the epoch if it has not been
+    std::atomic<Clock::time_point> mRequested{ Clock::time_point() };
+    /// @brief  Registered last, so that mRequested exists if it runs at once
+    std::stop_callback<Record> mCallback;
+};
@@ -0,0 +1,420 @@
+/**
+ * @file    mpmc-queue.h
+ *
+ * @brief   A bounded, lock-free, multi-producer multi-consumer queue. Each slot
+ *          of the ring buffer carries a sequence number, which tells producers
+ *          and consumers whether the slot is ready for them, so neither side
+ *          takes a lock on the normal path.
+ *
+ *          Consumers spin briefly when the queue is empty, then park on a
+ *          std::atomic::wait(). A stop request wakes parked consumers in the
+ *          same way that std::condition_variable_any::wait() does when given a
+ *          std::stop_token.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <new>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <utility>
+
+#include "cpu.h"
+
+/// @brief  Bounded lock-free queue, based on sequence numbered slots
+template<typename T>
+class BoundedMpmcQueue
+{
+public:
+    /// @brief  The number of attempts made before a waiter parks
+    static constexpr int SPIN_COUNT = 128;
+
+    /// @brief  Constructor
+    /// @param  capacity    The minimum number of items the queue can hold,
+    ///                     rounded up to the next power of two
+    /// @throws std::invalid_argument if the capacity is zero or too large
+    explicit BoundedMpmcQueue(std::size_t capacity)
+        : mMask(roundUp(capacity) - 1)
+        , mSlots(std::make_unique<Slot[]>(mMask + 1))
+    {
+        for (std::size_t i = 0; i <= mMask; ++i)
+        {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedMpmcQueue(const BoundedMpmcQueue &) = delete;
+    BoundedMpmcQueue &operator=(const BoundedMpmcQueue &) = delete;
+
+    /// @brief  Destructor, destroying any items remaining in the queue
+    ~BoundedMpmcQueue()
+    {
+        T item;
+        while (tryPopQuiet(item))
+        {
+        }
+    }
+
+    /// @brief  Adds an item to the queue if there is room, without blocking
+    /// @param  item    The item to be added, only moved from on success
+    /// @returns    True if the item was added, false if the queue was full
+    template<typename U>
+    bool tryPush(U &&item)
+    {
+        if (!tryPushQuiet(std::forward<U>(item)))
+        {
+            return false;
+        }
+        wake(mNotEmpty, mPopWaiters);
+        return true;
+    }
+
+    /// @brief  Takes an item from the queue if there is one, without blocking
+    /// @param  item    Set to the item taken
+    /// @returns    True if an item was taken, false if the queue was empty
+    bool tryPop(T &item)
+    {
+        if (!tryPopQuiet(item))
+        {
+            return false;
+        }
+        wake(mNotFull, mPushWaiters);
+        return true;
+    }
+
+    /// @brief  Adds an item, waiting for room if the queue is full
+    /// @param  item    The item to be added
+    /// @param  token   Stop token allowing a blocked producer to give up
+    /// @returns    True if the item was added, false if stopped while full
+    template<typename U>
+    bool push(U &&item, const std::stop_token &token = {})
+    {
+        return waitFor(mNotFull, mPushWaiters, token, [&]() {
+            return tryPush(std::forward<U>(item));
+        });
+    }
+
+    /// @brief  Adds a batch of items, waking consumers once for the whole
+    ///         batch rather than once per item. If the queue fills, this
+    ///         waits for room as push() does.
+    /// @param  items   The items to be added, which are moved from
+    /// @param  token   Stop token allowing a blocked producer to give up
+    /// @returns    The number of items added, less than items.size() only if
+    ///             stopped whilst the queue was full
+    std::size_t pushBulk(std::span<T> items, const std::stop_token &token = {})
+    {
+        std::size_t count = 0;
+        std::size_t unsignalled = 0;
+        for (T &item : items)
+        {
+            if (tryPushQuiet(std::move(item)))
+            {
+                ++unsignalled;
+            }
+            else
+            {
+                // Full, so let the consumers at what is there before waiting
+                wake(mNotEmpty, mPopWaiters, unsignalled);
+                unsignalled = 0;
+                if (!push(std::move(item), token))
+                {
+                    return count;
+                }
+            }
+            ++count;
+        }
+        wake(mNotEmpty, mPopWaiters, unsignalled);
+        return count;
+    }
+
+    /// @brief  Takes the next item, waiting whilst the queue is empty.
+    ///         This mirrors cv.wait(lock, token, pred): once a stop has been
+    ///         requested, the call only returns items if the caller is not
+    ///         permitted to finish early, and returns false once empty.
+    /// @param  item        Set to the item taken
+    /// @param  token       The stop token of the calling worker
+    /// @param  finishEarly Whether the caller may leave work behind once a
+    ///                     stop has been requested
+    /// @returns    True if an item was taken, false if the caller should stop
+    bool pop(T &item, const std::stop_token &token, bool finishEarly)
+    {
+        if (finishEarly && token.stop_requested())
+        {
+            return false;
+        }
+        return waitFor(mNotEmpty, mPopWaiters, token, [&]() {
+            return tryPop(item);
+        });
+    }
+
+    /// @brief  Takes up to out.size() items, waiting as pop() does for the
+    ///         first, and then taking whatever else is immediately available
+    ///         before waking producers once for the whole batch.
+    /// @param  out         Storage for the items taken
+    /// @param  token       The stop token of the calling worker
+    /// @param  finishEarly Whether the caller may leave work behind once a
+    ///                     stop has been requested
+    /// @returns    The number of items taken, zero if the caller should stop
+    std::size_t popUpTo(std::span<T> out, const std::stop_token &token,
+        bool finishEarly)
+    {
+        if (out.empty() || !pop(out[0], token, finishEarly))
+        {
+            return 0;
+        }
+        std::size_t count = 1;
+        while (count < out.size() && tryPopQuiet(out[count]))
+        {
+            ++count;
+        }
+        wake(mNotFull, mPushWaiters, count - 1);
+        return count;
+    }
+
+    /// @brief  The approximate number of items in the queue
+    std::size_t size() const
+    {
+        const std::size_t head = mHead.value.load(std::memory_order_relaxed);
+        const std::size_t tail = mTail.value.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    /// @brief  The number of items the queue can hold
+    std::size_t capacity() const
+    {
+        return mMask + 1;
+    }
+
+private:
+
+    /// @brief  Adds an item if there is room, without waking any consumer
+    template<typename U>
+    bool tryPushQuiet(U &&item)
+    {
+        std::size_t pos = mTail.value.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = mSlots[pos & mMask];
+            const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+            const std::intptr_t diff =
+                static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0)
+            {
+                // The slot is free for this position, so try to claim it
+                if (mTail.value.compare_exchange_weak(pos, pos + 1,
+                    std::memory_order_relaxed))
+                {
+                    new (slot.storage) T(std::forward<U>(item));
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                // The slot still holds an item from the previous lap
+                return false;
+            }
+            else
+            {
+                pos = mTail.value.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief  Takes an item if there is one, without waking any producer
+    bool tryPopQuiet(T &item)
+    {
+        std::size_t pos = mHead.value.load(std::memory_order_relaxed);
+        while (true)
+        {
+            Slot &slot = mSlots[pos & mMask];
+            const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+            const std::intptr_t diff =
+                static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (mHead.value.compare_exchange_weak(pos, pos + 1,
+                    std::memory_order_relaxed))
+                {
+                    T *stored = std::launder(reinterpret_cast<T *>(slot.storage));
+                    item = std::move(*stored);
+                    stored->~T();
+                    // Mark the slot free for the producer one lap ahead
+                    slot.sequence.store(pos + mMask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = mHead.value.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// @brief  A single entry in the ring buffer
+    struct Slot
+    {
+        /// @brief  Sequence number indicating which lap the slot is ready for
+        std::atomic<std::size_t> sequence{ 0 };
+        /// @brief  Storage for the item itself
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    /// @brief  A counter given a cache line of its own
+    struct alignas(CACHE_LINE_SIZE) PaddedCounter
+    {
+        std::atomic<std::size_t> value{ 0 };
+    };
+
+    /// @brief  Rounds up to the next power of two, of at least two
+    /// @throws std::invalid_argument if the capacity is zero, or too large
+    ///         to round up
+    static std::size_t roundUp(std::size_t value)
+    {
+        if (value == 0)
+        {
+            throw std::invalid_argument("BoundedMpmcQueue: the capacity must be at least one");
+        }
+        if (value > (std::numeric_limits<std::size_t>::max() >> 1) + 1)
+        {
+            throw std::invalid_argument("BoundedMpmcQueue: the capacity is too large");
+        }
+        return std::bit_ceil(std::max<std::size_t>(value, 2));
+    }
+
+    /// @brief  Wakes threads parked on the given event, if there are any
+    /// @param  event   The event counter the waiters are parked on
+    /// @param  waiters The number of waiters on that event
+    /// @param  count   The most waiters worth waking
+    static void wake(std::atomic<std::uint32_t> &event,
+        std::atomic<int> &waiters, std::size_t count = 1)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        // A read-modify-write rather than a load, so that it is ordered
+        // against the increment of the waiter count in waitFor(): either the
+        // waiter sees the new item or this call sees the waiter.
+        if (waiters.fetch_add(0, std::memory_order_acq_rel) == 0)
+        {
+            return;
+        }
+        // Each wake claims one waiter, so a waiter that has been woken but not
+        // yet run does not cause every following call to make a system call.
+        std::size_t claimed = 0;
+        while (claimed < count && claim(waiters))
+        {
+            ++claimed;
+        }
+        if (claimed > 0)
+        {
+            event.fetch_add(1, std::memory_order_release);
+            if (claimed == 1)
+            {
+                event.notify_one();
+            }
+            else
+            {
+                event.notify_all();
+            }
+        }
+    }
+
+    /// @brief  Claims one registration from the waiter count, if there is one
+    /// @param  waiters The number of waiters
+    /// @returns    True if a registration was claimed
+    static bool claim(std::atomic<int> &waiters)
+    {
+        int count = waiters.load(std::memory_order_relaxed);
+        while (count > 0 && !waiters.compare_exchange_weak(count, count - 1,
+            std::memory_order_relaxed))
+        {
+        }
+        return count > 0;
+    }
+
+    /// @brief  Retries an operation, spinning and then parking on the event,
+    ///         until it succeeds or a stop is requested.
+    /// @param  event   The event signalled when the operation may succeed
+    /// @param  waiters The number of waiters on that event
+    /// @param  token   Stop token, which wakes the caller when stopped
+    /// @param  attempt The operation, returning true on success
+    /// @returns    True on success, false if stopped before success
+    template<typename Attempt>
+    static bool waitFor(std::atomic<std::uint32_t> &event,
+        std::atomic<int> &waiters, const std::stop_token &token,
+        Attempt &&attempt)
+    {
+        // Spinning only helps if another core can make progress meanwhile
+        static const int spins =
+            std::thread::hardware_concurrency() > 1 ? SPIN_COUNT : 1;
+        for (int i = 0; i < spins; ++i)
+        {
+            if (attempt())
+            {
+                return true;
+            }
+            cpuRelax();
+        }
+
+        // The callback is only registered once the caller is about to park,
+        // keeping the fast path free of any stop state bookkeeping.
+        std::stop_callback wakeOnStop(token, [&]() {
+            event.fetch_add(1, std::memory_order_release);
+            event.notify_all();
+        });
+        while (true)
+        {
+            waiters.fetch_add(1, std::memory_order_acq_rel);
+            const std::uint32_t seen = event.load(std::memory_order_acquire);
+            // The registration is deliberately left in place when leaving
+            // early. Removing it could remove one belonging to another waiter
+            // whose wake has already been claimed, losing that wake, whereas
+            // a stale registration costs no more than one spare notification.
+            if (attempt())
+            {
+                return true;
+            }
+            if (token.stop_requested())
+            {
+                return false;
+            }
+            // A wake removes this registration, so it is made again each time
+            event.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+    /// @brief  Index mask, the capacity being a power of two
+    const std::size_t mMask;
+    /// @brief  The ring buffer
+    std::unique_ptr<Slot[]> mSlots;
+    /// @brief  Position of the next item to be taken
+    PaddedCounter mHead;
+    /// @brief  Position of the next item to be added
+    PaddedCounter mTail;
+    /// @brief  Event signalled when an item is added
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint32_t> mNotEmpty{ 0 };
+    /// @brief  The number of consumers parked waiting for an item
+    std::atomic<int> mPopWaiters{ 0 };
+    /// @brief  Event signalled when an item is taken
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint32_t> mNotFull{ 0 };
+    /// @brief  The number of producers parked waiting for room
+    std::atomic<int> mPushWaiters{ 0 };
+};
@@ -0,0 +1,266 @@
+/**
+ * @file    node-queue.h
+ *
+ * @brief   A task queue split into one shard per NUMA node. The workers on a
+ *          node share its shard, whose storage is allocated on that node, so
+ *          the lock and items they contend on stay within the node's caches
+ *          and memory. Only when a node's own shard is empty do its workers
+ *          steal from the shards of other nodes.
+ *
+ *          Idle workers park on a std::condition_variable_any, as with the
+ *          other queues, so a stop request still wakes them immediately.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <utility>
+#include <vector>
+
+#include "affinity.h"
+#include "cpu.h"
+
+/// @brief  A queue with a shard per node, stealing between nodes when idle
+template<typename T>
+class NodeQueue
+{
+public:
+    /// @brief  Constructor
+    /// @param  nodes   The OS node number of each shard, where -1 places the
+    ///                 shard's storage wherever the OS chooses
+    explicit NodeQueue(const std::vector<int> &nodes)
+        : mShardCount(std::max<std::size_t>(nodes.size(), 1))
+        , mShards(std::make_unique<Shard[]>(mShardCount))
+    {
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+        {
+            mShards[i].items = Ring(MIN_CAPACITY, T(), NodeAllocator<T>(nodes[i]));
+        }
+        if (nodes.empty())
+        {
+            mShards[0].items = Ring(MIN_CAPACITY, T(), NodeAllocator<T>(-1));
+        }
+    }
+
+    NodeQueue(const NodeQueue &) = delete;
+    NodeQueue &operator=(const NodeQueue &) = delete;
+
+    /// @brief  The number of shards
+    std::size_t shards() const
+    {
+        return mShardCount;
+    }
+
+    /// @brief  Adds an item to the given shard, typically that of the node
+    ///         the producer is running on
+    /// @param  shard   The shard index
+    /// @param  item    The item to be added
+    void push(std::size_t shard, T item)
+    {
+        append(mShards[shard % mShardCount], std::span<T>(&item, 1));
+        wake(1);
+    }
+
+    /// @brief  Adds a batch of items, giving each shard a contiguous share so
+    ///         that each is only locked once
+    /// @param  items   The items to be added, which are moved from
+    void pushBulk(std::span<T> items)
+    {
+        if (items.empty())
+        {
+            return;
+        }
+        const std::size_t share = (items.size() + mShardCount - 1) / mShardCount;
+        std::size_t shard = mNext.fetch_add(1, std::memory_order_relaxed);
+        for (std::size_t first = 0; first < items.size(); first += share, ++shard)
+        {
+            const std::size_t last = std::min(items.size(), first + share);
+            append(mShards[shard % mShardCount], items.subspan(first, last - first));
+        }
+        wake(items.size());
+    }
+
+    /// @brief  Takes up to out.size() items from the given shard under a single
+    ///         lock. If it is empty, up to half of the first busy shard of
+    ///         another node is stolen instead, and if there is no work
+    ///         anywhere, the worker parks.
+    /// @param  shard       The shard of the calling worker's node
+    /// @param  out         Storage for the items taken
+    /// @param  token       The stop token of the calling worker
+    /// @param  finishEarly Whether the worker may leave work behind once a
+    ///                     stop has been requested
+    /// @returns    The number of items taken, zero if the worker should stop
+    std::size_t popUpTo(std::size_t shard, std::span<T> out,
+        const std::stop_token &token, bool finishEarly)
+    {
+        if (out.empty())
+        {
+            return 0;
+        }
+        shard %= mShardCount;
+        while (true)
+        {
+            if (finishEarly && token.stop_requested())
+            {
+                return 0;
+            }
+            std::size_t count = takeFrom(mShards[shard], out, false);
+            for (std::size_t i = 1; count == 0 && i < mShardCount &&
+                mPending.load() > 0; ++i)
+            {
+                count = takeFrom(mShards[(shard + i) % mShardCount], out, true);
+            }
+            if (count > 0)
+            {
+                return count;
+            }
+
+            // Nothing to do anywhere, so park until work arrives. wait()
+            // returns the predicate result, so a false value means that a stop
+            // was requested with no work remaining.
+            std::unique_lock lock(mParkMutex);
+            mSleepers.fetch_add(1);
+            const bool hasWork = mParkCv.wait(lock, token, [&]() {
+                return mPending.load() > 0;
+            });
+            mSleepers.fetch_sub(1);
+            if (!hasWork)
+            {
+                return 0;
+            }
+        }
+    }
+
+    /// @brief  The number of items waiting across all of the shards
+    std::size_t size() const
+    {
+        return mPending.load(std::memory_order_relaxed);
+    }
+
+private:
+    /// @brief  The storage of a shard, allocated on its node
+    using Ring = std::vector<T, NodeAllocator<T>>;
+
+    /// @brief  The initial ring capacity of each shard, a power of two
+    static constexpr std::size_t MIN_CAPACITY = 256;
+
+    /// @brief  A single node's queue, on cache lines of its own so that the
+    ///         lock of one node is never written alongside another's
+    struct alignas(CACHE_LINE_SIZE) Shard
+    {
+        /// @brief  Mutex protecting this shard only
+        std::mutex mutex;
+        /// @brief  Ring of items, of a power of two size
+        Ring items;
+        /// @brief  The index of the oldest item
+        std::size_t head = 0;
+        /// @brief  The number of items held
+        std::size_t held = 0;
+        /// @brief  Copy of held, readable without the lock
+        std::atomic<std::size_t> count{ 0 };
+    };
+
+    /// @brief  Appends items to a shard, growing its ring on the same node
+    /// @param  shard   The shard
+    /// @param  items   The items, which are moved from
+    void append(Shard &shard, std::span<T> items)
+    {
+        std::lock_guard lock(shard.mutex);
+        if (shard.held + items.size() > shard.items.size())
+        {
+            std::size_t capacity = shard.items.size();
+            while (capacity < shard.held + items.size())
+            {
+                capacity *= 2;
+            }
+            Ring grown(capacity, T(), shard.items.get_allocator());
+            const std::size_t mask = shard.items.size() - 1;
+            for (std::size_t i = 0; i < shard.held; ++i)
+            {
+                grown[i] = std::move(shard.items[(shard.head + i) & mask]);
+            }
+            shard.items = std::move(grown);
+            shard.head = 0;
+        }
+        const std::size_t mask = shard.items.size() - 1;
+        for (T &item : items)
+        {
+            shard.items[(shard.head + shard.held++) & mask] = std::move(item);
+        }
+        shard.count.store(shard.held, std::memory_order_relaxed);
+        // Must be counted before the items can be taken by anyone else
+        mPending.fetch_add(items.size());
+    }
+
+    /// @brief  Takes up to out.size() of the oldest items from a shard
+    /// @param  shard   The shard to take from
+    /// @param  out     Storage for the items taken
+    /// @param  steal   Whether the shard belongs to another node, in which
+    ///                 case only half of its items are taken
+    /// @returns    The number of items taken
+    std::size_t takeFrom(Shard &shard, std::span<T> out, bool steal)
+    {
+        // Shards with nothing in them are skipped without taking their lock
+        if (shard.count.load(std::memory_order_relaxed) == 0)
+        {
+            return 0;
+        }
+        std::lock_guard lock(shard.mutex);
+        const std::size_t available = steal ? (shard.held + 1) / 2 : shard.held;
+        const std::size_t count = std::min(out.size(), available);
+        const std::size_t mask = shard.items.size() - 1;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            out[i] = std::exchange(shard.items[shard.head], T());
+            shard.head = (shard.head + 1) & mask;
+        }
+        shard.held -= count;
+        shard.count.store(shard.held, std::memory_order_relaxed);
+        mPending.fetch_sub(count);
+        return count;
+    }
+
+    /// @brief  Wakes parked workers, if there are any, but no more than
+    ///         there are new items for
+    /// @param  count   The number of new items, and so workers worth waking
+    void wake(std::size_t count)
+    {
+        // Sleepers register under mParkMutex before checking mPending, so if
+        // none are seen here, any worker about to park will see the new item.
+        const int sleepers = mSleepers.load();
+        if (sleepers > 0)
+        {
+            std::lock_guard lock(mParkMutex);
+            const std::size_t wakes = std::min(count, static_cast<std::size_t>(sleepers));
+            for (std::size_t i = 0; i < wakes; ++i)
+            {
+                mParkCv.notify_one();
+            }
+        }
+    }
+
+    /// @brief  The number of shards
+    const std::size_t mShardCount;
+    /// @brief  One queue per node
+    std::unique_ptr<Shard[]> mShards;
+    /// @brief  Round-robin counter used to distribute new batches
+    std::atomic<std::size_t> mNext{ 0 };
+    /// @brief  The number of items across all shards
+    std::atomic<std::size_t> mPending{ 0 };
+    /// @brief  The number of workers currently parked
+    std::atomic<int> mSleepers{ 0 };
+    /// @brief  Mutex used only for parking idle workers
+    std::mutex mParkMutex;
+    /// @brief  Condition variable that idle workers park on
+    std::condition_variable_any mParkCv;
+};
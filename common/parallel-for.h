@@ -0,0 +1,294 @@
+/**
+ * @file    parallel-for.h
+ *
+ * @brief   Data-parallel loops over a ThreadPool. parallelFor() runs a body
+ *          over every index of a range, and parallelReduce() combines a value
+ *          from each.
+ *
+ *          The range is split in half recursively, with each upper half
+ *          queued on the pool to be split again by whichever thread takes it,
+ *          until the pieces reach the chunk size. The chunk size adapts to the
+ *          range and the pool: it is the given grain, or larger if that would
+ *          make many more chunks than there are threads to run them, so that a
+ *          small grain does not flood the queue. Within a chunk, the body is
+ *          still called a grain at a time.
+ *
+ *          The calling thread runs the first chunk itself, then, rather than
+ *          blocking until the rest are done, runs queued tasks alongside the
+ *          workers. So a loop started from within a task on the same pool
+ *          cannot deadlock it.
+ *
+ *          A stop requested on the given token abandons every chunk not yet
+ *          started, and the rest of any chunk between grains. The loop then
+ *          returns once the chunks already running reach the end of their
+ *          grain. An exception thrown by the body cancels the loop in the
+ *          same way, and is rethrown to the caller.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+
+#include "thread-arena.h"
+#include "thread-pool.h"
+
+/// @brief  The state of one parallelFor(), shared by every chunk of it
+/// @tparam Index   The integral index type
+/// @tparam Body    The body, called with the first and one past the last
+///                 index of each grain
+template<std::integral Index, typename Body>
+class ParallelLoop : public std::enable_shared_from_this<ParallelLoop<Index, Body>>
+{
+public:
+    /// @brief  The most chunks made for each thread able to run them
+    static constexpr std::size_t CHUNKS_PER_THREAD = 8;
+
+    /// @brief  Constructor
+    /// @param  pool    The pool to run the chunks on
+    /// @param  body    The body, which must outlive the loop
+    /// @param  length  The number of indices in the whole range
+    /// @param  grain   The most indices passed to the body at once, or zero
+    ///                 to choose one from the length and the size of the pool
+    /// @param  token   Cancels the loop once stopped
+    ParallelLoop(ThreadPool &pool, Body &body, std::size_t length, std::size_t grain,
+        std::stop_token token)
+        : mPool(pool)
+        , mBody(body)
+        , mToken(std::move(token))
+    {
+        // The caller helps, so counts as a thread as well
+        const std::size_t chunks = (pool.size() + 1) * CHUNKS_PER_THREAD;
+        const std::size_t even = std::max<std::size_t>((length + chunks - 1) / chunks, 1);
+        mGrain = (grain > 0) ? grain : even;
+        mChunk = std::max(mGrain, even);
+    }
+
+    /// @brief  Runs the loop over the range, returning once every chunk has
+    ///         finished or been abandoned
+    /// @param  begin   The first index
+    /// @param  end     One past the last index
+    /// @returns    True unless the loop was cancelled
+    /// @throws Whatever the body threw first, if it threw
+    bool run(Index begin, Index end)
+    {
+        mPending.store(1, std::memory_order_relaxed);
+        runChunk(begin, end);
+        mPool.helpUntil(mDone.get_token());
+        // Should the pool have been shut down, helping ends early, whilst the
+        // last chunks may still be finishing on the workers
+        std::size_t pending = 0;
+        while ((pending = mPending.load()) != 0)
+        {
+            mPending.wait(pending);
+        }
+        if (mError)
+        {
+            std::rethrow_exception(mError);
+        }
+        return !mCancelled.load(std::memory_order_relaxed);
+    }
+
+private:
+    /// @brief  Whether the remaining work should be abandoned
+    bool cancelled()
+    {
+        if (mCancelled.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+        if (mToken.stop_requested())
+        {
+            mCancelled.store(true, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief  Splits off and queues upper halves until the range is no
+    ///         larger than a chunk, then runs it a grain at a time
+    /// @param  first   The first index
+    /// @param  last    One past the last index
+    void runChunk(Index first, Index last)
+    {
+        while (!cancelled() && length(first, last) > mChunk)
+        {
+            const Index middle = static_cast<Index>(first + length(first, last) / 2);
+            spawn(middle, last);
+            last = middle;
+        }
+        while (first != last && !cancelled())
+        {
+            const Index next = static_cast<Index>(first + std::min(length(first, last), mGrain));
+            try
+            {
+                mBody(first, next);
+            }
+            catch (...)
+            {
+                std::lock_guard lock(mErrorMutex);
+                if (!mError)
+                {
+                    mError = std::current_exception();
+                }
+                mCancelled.store(true, std::memory_order_relaxed);
+            }
+            first = next;
+        }
+        if (mPending.fetch_sub(1) == 1)
+        {
+            mDone.request_stop();
+            mPending.notify_all();
+        }
+    }
+
+    /// @brief  Queues a range to be run as a chunk of its own
+    /// @param  first   The first index
+    /// @param  last    One past the last index
+    void spawn(Index first, Index last)
+    {
+        mPending.fetch_add(1, std::memory_order_relaxed);
+        try
+        {
+            mPool.push(Task([self = this->shared_from_this(), first, last]() {
+                self->runChunk(first, last);
+            }));
+        }
+        catch (const std::runtime_error &)
+        {
+            // The pool has been shut down, so the range is run here instead
+            runChunk(first, last);
+        }
+    }
+
+    /// @brief  The number of indices in a range
+    static std::size_t length(Index first, Index last)
+    {
+        return static_cast<std::size_t>(last - first);
+    }
+
+    /// @brief  The pool running the chunks
+    ThreadPool &mPool;
+    /// @brief  The loop body
+    Body &mBody;
+    /// @brief  Cancels the loop once stopped
+    const std::stop_token mToken;
+    /// @brief  The most indices passed to the body at once
+    std::size_t mGrain = 1;
+    /// @brief  The size that ranges are split down to
+    std::size_t mChunk = 1;
+    /// @brief  The number of chunks queued or running
+    std::atomic<std::size_t> mPending{ 0 };
+    /// @brief  Set once the loop is cancelled, by the token or an exception
+    std::atomic<bool> mCancelled{ false };
+    /// @brief  Stopped once the last chunk finishes, ending the caller's help
+    std::stop_source mDone;
+    /// @brief  Mutex protecting mError
+    std::mutex mErrorMutex;
+    /// @brief  The first exception thrown by the body
+    std::exception_ptr mError;
+};
+
+/// @brief  Runs a body over every index of a range, in parallel on the pool
+///         and the calling thread
+/// @param  pool    The pool
+/// @param  begin   The first index
+/// @param  end     One past the last index
+/// @param  grain   The most indices passed to the body at once, or zero to
+///                 choose one from the length of the range and the pool
+/// @param  body    Called either with each index, or, if it accepts them,
+///                 with the first and one past the last index of each grain,
+///                 from any thread, and concurrently
+/// @param  token   Cancels the loop once stopped
+/// @returns    True if the body ran over every index, or false if the loop
+///             was cancelled
+/// @throws Whatever the body threw first, once the running chunks finish
+template<std::integral Index, typename F>
+bool parallelFor(ThreadPool &pool, Index begin, Index end, std::size_t grain, F &&body,
+    std::stop_token token = std::stop_token())
+{
+    if (end <= begin)
+    {
+        return true;
+    }
+    auto grainBody = [&body](Index first, Index last) {
+        if constexpr (std::is_invocable_v<F &, Index, Index>)
+        {
+            body(first, last);
+        }
+        else
+        {
+            for (Index i = first; i != last; ++i)
+            {
+                body(i);
+            }
+        }
+    };
+    using Loop = ParallelLoop<Index, decltype(grainBody)>;
+    // The loop's state is shared with the grains queued on the pool, and
+    // comes from the calling thread's arena rather than the global heap
+    const auto loop = std::allocate_shared<Loop>(
+        std::pmr::polymorphic_allocator<Loop>(&ThreadArena::local()), pool, grainBody,
+        static_cast<std::size_t>(end - begin), grain, std::move(token));
+    return loop->run(begin, end);
+}
+
+/// @brief  Combines a value from every index of a range, in parallel on the
+///         pool and the calling thread. The values of each grain are combined
+///         in order, but the grains are combined as they finish, so the
+///         combination must not depend on order, as with a sum.
+/// @param  pool        The pool
+/// @param  begin       The first index
+/// @param  end         One past the last index
+/// @param  grain       The most indices mapped at once, or zero to choose
+/// @param  identity    The value that combines to no effect, such as zero for
+///                     a sum, which starts the value of every grain
+/// @param  map         Called either with each index, giving its value, or,
+///                     if it accepts them, with the first and one past the
+///                     last index of each grain, giving the grain's value
+/// @param  combine     Combines two values into one
+/// @param  token       Cancels the reduction once stopped
+/// @returns    The combined value, or nothing if cancelled
+/// @throws Whatever map or combine threw first
+template<std::integral Index, typename T, typename Map, typename Combine>
+std::optional<T> parallelReduce(ThreadPool &pool, Index begin, Index end, std::size_t grain,
+    T identity, Map &&map, Combine &&combine, std::stop_token token = std::stop_token())
+{
+    std::mutex mutex;
+    T result = identity;
+    const bool finished = parallelFor(pool, begin, end, grain, [&](Index first, Index last) {
+        T value = identity;
+        if constexpr (std::is_invocable_v<Map &, Index, Index>)
+        {
+            value = map(first, last);
+        }
+        else
+        {
+            for (Index i = first; i != last; ++i)
+            {
+                value = combine(std::move(value), map(i));
+            }
+        }
+        std::lock_guard lock(mutex);
+        result = combine(std::move(result), std::move(value));
+    }, std::move(token));
+    if (!finished)
+    {
+        return std::nullopt;
+    }
+    return result;
+}
@@ -0,0 +1,430 @@
+/**
+ * @file    pipeline.h
+ *
+ * @brief   A pipeline of stages, each overlapping with the others, rather than
+ *          worker threads chained together by hand, one waiting on another's
+ *          data or starting from its stop_callback. Each stage is a function
+ *          applied to every item, run by its own group of worker threads, and
+ *          connected to the stage before and after it by bounded channels.
+ *          Every worker takes a batch of items from the channel before it,
+ *          applies the function to each, and sends the whole batch of results
+ *          on at once, so that each item costs a share of a channel operation
+ *          rather than one of its own. A stage that falls behind holds back
+ *          the stages before it once its channel is full, rather than letting
+ *          the items pile up.
+ *
+ *          Draining the pipeline closes its first channel. Each stage then
+ *          finishes the items already sent to it, and the last of its workers
+ *          to run out closes the channel after it, so that everything sent in
+ *          is processed, in stage order, before the stages end. Cancelling it
+ *          instead stops every worker as soon as it finishes its batch.
+ *
+ *          Each stage counts the items and batches it has processed, and the
+ *          time its workers spent processing, waiting for input and waiting
+ *          for room downstream, which along with the number of items waiting
+ *          in its channel shows where the pipeline's bottleneck lies.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "channel.h"
+#include "cpu.h"
+#include "fixed-array.h"
+
+/// @brief  A chain of stages, each with its own worker threads
+class Pipeline
+{
+public:
+    /// @brief  The clock used for all timings
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief  The channel into a stage, which any number of the stage before's
+    ///         workers send to, and any number of its own receive from
+    template<typename T>
+    using Link = Channel<T, ChannelKind::MPMC>;
+
+    /// @brief  A copy of a stage's counters at one moment
+    struct StageStats
+    {
+        /// @brief  The stage's name
+        std::string name;
+        /// @brief  The number of workers
+        std::size_t workers = 0;
+        /// @brief  The number of items processed
+        std::uint64_t items = 0;
+        /// @brief  The number of batches they were taken in
+        std::uint64_t batches = 0;
+        /// @brief  The total time spent processing items
+        std::chrono::nanoseconds busy{ 0 };
+        /// @brief  The total time spent waiting for items
+        std::chrono::nanoseconds idle{ 0 };
+        /// @brief  The total time spent waiting for room in the next stage
+        std::chrono::nanoseconds blocked{ 0 };
+        /// @brief  The number of items waiting in the stage's channel
+        std::size_t depth = 0;
+        /// @brief  The most items the stage's channel holds
+        std::size_t capacity = 0;
+        /// @brief  The items processed per second, since the stage started
+        ///         and until it ended
+        double itemsPerSecond = 0.0;
+
+        /// @brief  A one line summary, suitable for logging
+        std::string summary() const
+        {
+            const auto millis = [](std::chrono::nanoseconds total) {
+                return std::to_string(total.count() / 1000000) + "ms";
+            };
+            return name + " x" + std::to_string(workers) +
+                " | items " + std::to_string(items) +
+                " (" + std::to_string(static_cast<long long>(itemsPerSecond)) + "/s)" +
+                " in " + std::to_string(batches) + " batches" +
+                " | busy " + millis(busy) +
+                " idle " + millis(idle) +
+                " blocked " + millis(blocked) +
+                " | depth " + std::to_string(depth) + "/" + std::to_string(capacity);
+        }
+    };
+
+    /// @brief  Constructor
+    /// @param  capacity    The most items each channel holds
+    /// @param  batch       The most items each worker takes at once
+    explicit Pipeline(std::size_t capacity = 256, std::size_t batch = 32)
+        : mCapacity(capacity)
+        , mBatch(batch > 0 ? batch : 1)
+    {
+    }
+
+    /// @brief  Destructor, draining the pipeline if that has not yet been done
+    ~Pipeline()
+    {
+        drain();
+    }
+
+    Pipeline(const Pipeline &) = delete;
+    Pipeline &operator=(const Pipeline &) = delete;
+
+    /// @brief  Creates the pipeline's first channel, into which every item is
+    ///         sent, by any number of threads
+    /// @throws std::logic_error if called more than once
+    template<typename T>
+    Link<T> &source()
+    {
+        if (mCloseHead)
+        {
+            throw std::logic_error("Pipeline: the source has already been created");
+        }
+        Link<T> &head = addLink<T>();
+        mCloseHead = [&head]() { head.close(); };
+        return head;
+    }
+
+    /// @brief  Adds a stage, starting its workers, which pass the result of
+    ///         the function for each item on to a new channel
+    /// @param  name    The stage's name, for its counters
+    /// @param  input   The channel the stage takes items from, which no other
+    ///                 stage may take from
+    /// @param  workers The number of worker threads, at least one
+    /// @param  fn      Called with each item, moved, returning the item to pass
+    ///                 on. It is called from every worker at once, and must not
+    ///                 throw.
+    /// @returns    The channel the stage sends its results to
+    template<typename In, typename F>
+    auto &stage(std::string name, Link<In> &input, std::size_t workers, F fn)
+    {
+        using Out = std::invoke_result_t<F &, In &&>;
+        static_assert(!std::is_void_v<Out>, "A stage must return an item; use sink() to end");
+        Link<Out> &output = addLink<Out>();
+        mStages.push_back(std::make_unique<Stage<In, Out, F>>(std::move(name), input, &output,
+            workers, mBatch, std::move(fn)));
+        return output;
+    }
+
+    /// @brief  Adds the final stage, starting its workers, which consume each
+    ///         item passed to them
+    /// @param  name    The stage's name, for its counters
+    /// @param  input   The channel the stage takes items from
+    /// @param  workers The number of worker threads, at least one
+    /// @param  fn      Called with each item, moved, from every worker at once,
+    ///                 and must not throw
+    template<typename In, typename F>
+    void sink(std::string name, Link<In> &input, std::size_t workers, F fn)
+    {
+        mStages.push_back(std::make_unique<Stage<In, void, F>>(std::move(name), input, nullptr,
+            workers, mBatch, std::move(fn)));
+    }
+
+    /// @brief  Closes the first channel, then waits for every stage to finish
+    ///         the items sent to it
+    void drain()
+    {
+        if (mCloseHead)
+        {
+            mCloseHead();
+        }
+        for (const std::unique_ptr<StageBase> &stage : mStages)
+        {
+            stage->join();
+        }
+    }
+
+    /// @brief  Stops every worker once it finishes its batch, leaving any
+    ///         items still queued unprocessed, then waits for them
+    void cancel()
+    {
+        for (const std::unique_ptr<StageBase> &stage : mStages)
+        {
+            stage->cancel();
+        }
+        drain();
+    }
+
+    /// @brief  Copies the counters of every stage, in order. Any thread may
+    ///         call this, once every stage has been added.
+    std::vector<StageStats> stats() const
+    {
+        std::vector<StageStats> all;
+        for (const std::unique_ptr<StageBase> &stage : mStages)
+        {
+            all.push_back(stage->stats());
+        }
+        return all;
+    }
+
+private:
+    /// @brief  The parts of a stage that do not depend on its types
+    class StageBase
+    {
+    public:
+        virtual ~StageBase() = default;
+
+        /// @brief  Copies the stage's counters
+        virtual StageStats stats() const = 0;
+
+        /// @brief  Asks every worker to stop
+        virtual void cancel() = 0;
+
+        /// @brief  Waits for every worker to end
+        virtual void join() = 0;
+    };
+
+    /// @brief  A stage's counters for a single worker, which is the only
+    ///         thread writing them
+    struct alignas(CACHE_LINE_SIZE) Counters
+    {
+        std::atomic<std::uint64_t> items{ 0 };
+        std::atomic<std::uint64_t> batches{ 0 };
+        /// @brief  The times in StageStats, as totals in nanoseconds
+        std::atomic<std::uint64_t> busy{ 0 };
+        std::atomic<std::uint64_t> idle{ 0 };
+        std::atomic<std::uint64_t> blocked{ 0 };
+
+        /// @brief  Adds to a counter. There is only ever one writer, so this
+        ///         need not be a locked read-modify-write.
+        static void add(std::atomic<std::uint64_t> &counter, std::uint64_t value)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+        }
+
+        /// @brief  Adds a duration to a counter
+        static void add(std::atomic<std::uint64_t> &counter, Clock::duration duration)
+        {
+            add(counter, static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+        }
+    };
+
+    /// @brief  A stage taking In items, passing Out items on, or void for a sink
+    template<typename In, typename Out, typename F>
+    class Stage : public StageBase
+    {
+    public:
+        /// @brief  The channel the stage sends to, with a placeholder for sinks
+        using Output = std::conditional_t<std::is_void_v<Out>, std::nullptr_t, Link<Out>>;
+
+        /// @brief  Constructor, starting the workers
+        Stage(std::string name, Link<In> &input, Output *output, std::size_t workers,
+            std::size_t batch, F fn)
+            : mName(std::move(name))
+            , mInput(input)
+            , mOutput(output)
+            , mFn(std::move(fn))
+            , mStart(Clock::now())
+            , mCounters(workers > 0 ? workers : 1)
+            , mRunning(static_cast<int>(mCounters.capacity()))
+            , mWorkers(mCounters.capacity())
+        {
+            for (std::size_t w = 0; w < mCounters.capacity(); ++w)
+            {
+                Counters &counters = mCounters.emplace_back();
+                mWorkers.emplace_back([this, &counters, batch](std::stop_token token) {
+                    run(token, counters, batch);
+                });
+            }
+        }
+
+        StageStats stats() const override
+        {
+            StageStats stats;
+            stats.name = mName;
+            stats.workers = mCounters.size();
+            std::uint64_t busy = 0;
+            std::uint64_t idle = 0;
+            std::uint64_t blocked = 0;
+            for (std::size_t w = 0; w < mCounters.size(); ++w)
+            {
+                stats.items += mCounters[w].items.load(std::memory_order_relaxed);
+                stats.batches += mCounters[w].batches.load(std::memory_order_relaxed);
+                busy += mCounters[w].busy.load(std::memory_order_relaxed);
+                idle += mCounters[w].idle.load(std::memory_order_relaxed);
+                blocked += mCounters[w].blocked.load(std::memory_order_relaxed);
+            }
+            stats.busy = std::chrono::nanoseconds(busy);
+            stats.idle = std::chrono::nanoseconds(idle);
+            stats.blocked = std::chrono::nanoseconds(blocked);
+            stats.depth = mInput.size();
+            stats.capacity = mInput.capacity();
+            const Clock::rep finished = mFinished.load(std::memory_order_acquire);
+            const Clock::time_point end = finished != 0 ?
+                Clock::time_point(Clock::duration(finished)) : Clock::now();
+            const double seconds = std::chrono::duration<double>(end - mStart).count();
+            stats.itemsPerSecond = seconds > 0.0 ?
+                static_cast<double>(stats.items) / seconds : 0.0;
+            return stats;
+        }
+
+        void cancel() override
+        {
+            for (std::size_t w = 0; w < mWorkers.size(); ++w)
+            {
+                mWorkers[w].request_stop();
+            }
+        }
+
+        void join() override
+        {
+            for (std::size_t w = 0; w < mWorkers.size(); ++w)
+            {
+                if (mWorkers[w].joinable())
+                {
+                    mWorkers[w].join();
+                }
+            }
+        }
+
+    private:
+        /// @brief  A worker, taking batches until the input is closed and
+        ///         empty, or it is stopped
+        void run(const std::stop_token &token, Counters &counters, std::size_t batch)
+        {
+            std::vector<In> items(batch);
+            std::vector<std::conditional_t<std::is_void_v<Out>, char, Out>> results;
+            results.reserve(std::is_void_v<Out> ? 0 : batch);
+            Clock::time_point waited = Clock::now();
+            while (!token.stop_requested())
+            {
+                const std::size_t count = mInput.recvUpTo(std::span<In>(items), token);
+                const Clock::time_point started = Clock::now();
+                Counters::add(counters.idle, started - waited);
+                if (count == 0)
+                {
+                    break;
+                }
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    if constexpr (std::is_void_v<Out>)
+                    {
+                        std::invoke(mFn, std::move(items[i]));
+                    }
+                    else
+                    {
+                        results.push_back(std::invoke(mFn, std::move(items[i])));
+                    }
+                }
+                const Clock::time_point finished = Clock::now();
+                Counters::add(counters.busy, finished - started);
+                if constexpr (!std::is_void_v<Out>)
+                {
+                    mOutput->sendBulk(std::span<Out>(results), token);
+                    results.clear();
+                }
+                waited = Clock::now();
+                Counters::add(counters.blocked, waited - finished);
+                Counters::add(counters.items, count);
+                Counters::add(counters.batches, 1);
+            }
+
+            // The last worker to finish tells the next stage that nothing
+            // more is coming
+            if (mRunning.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                mFinished.store(Clock::now().time_since_epoch().count(),
+                    std::memory_order_release);
+                if constexpr (!std::is_void_v<Out>)
+                {
+                    mOutput->close();
+                }
+            }
+        }
+
+        /// @brief  The stage's name
+        const std::string mName;
+        /// @brief  The channel items are taken from
+        Link<In> &mInput;
+        /// @brief  The channel results are sent to, null for a sink
+        Output *const mOutput;
+        /// @brief  The function applied to every item
+        F mFn;
+        /// @brief  When the stage started
+        const Clock::time_point mStart;
+        /// @brief  When the last worker ended, as a count of clock ticks, or
+        ///         zero whilst any are running
+        std::atomic<Clock::rep> mFinished{ 0 };
+        /// @brief  The counters for each worker
+        FixedArray<Counters> mCounters;
+        /// @brief  The number of workers still running
+        std::atomic<int> mRunning;
+        /// @brief  The workers, last so that they end before anything they use
+        FixedArray<std::jthread> mWorkers;
+    };
+
+    /// @brief  Creates a new channel, owned by the pipeline
+    template<typename T>
+    Link<T> &addLink()
+    {
+        auto link = std::make_shared<Link<T>>(mCapacity);
+        Link<T> &ref = *link;
+        mLinks.push_back(std::move(link));
+        return ref;
+    }
+
+    /// @brief  The most items each channel holds
+    const std::size_t mCapacity;
+    /// @brief  The most items each worker takes at once
+    const std::size_t mBatch;
+    /// @brief  Closes the first channel, once created
+    std::function<void()> mCloseHead;
+    /// @brief  Every channel, of whichever type
+    std::vector<std::shared_ptr<void>> mLinks;
+    /// @brief  Every stage, in order, after the channels they use, so that
+    ///         they are destroyed first
+    std::vector<std::unique_ptr<StageBase>> mStages;
+};
@@ -0,0 +1,223 @@
+/**
+ * @file    stop-tree.h
+ *
+ * @brief   A tree of stop sources, where a stop requested on any node is
+ *          passed down to every node below it. A whole group of workers or
+ *          tasks can then be stopped with one call on their parent, rather
+ *          than by stopping each in turn, whilst each keeps a std::stop_token
+ *          of its own that can also be stopped alone.
+ *
+ *          The stop is passed down by walking each node's children, stopping
+ *          each child's std::stop_source directly. The parent's list is
+ *          taken with a single lock, leaving it free for children to come
+ *          and go whilst the walk runs, and a child that has no children of
+ *          its own is stopped without taking any lock at all, so stopping a
+ *          group of leaves costs one atomic operation for each.
+ *
+ *          A node added below one that has already been stopped is stopped
+ *          as it is added. Nodes share ownership of their state, so a child
+ *          may outlive its parent, and either may be destroyed whilst a stop
+ *          is being passed through them.
+ *
+ *          The member names follow std::stop_source, which a node stands in
+ *          for.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <utility>
+
+/// @brief  A std::stop_source that may have a parent and children
+class StopNode
+{
+public:
+    /// @brief  Constructor, as a root with a stop source of its own
+    StopNode()
+        : mState(std::make_shared<State>(std::stop_source()))
+    {
+    }
+
+    /// @brief  Constructor, as a child with a stop source of its own
+    /// @param  parent  The node whose stop is passed down to this one
+    explicit StopNode(StopNode &parent)
+        : StopNode(parent, std::stop_source())
+    {
+    }
+
+    /// @brief  Constructor, as a child stopping an existing stop source, such
+    ///         as that of a std::jthread
+    /// @param  parent  The node whose stop is passed down to this one
+    /// @param  source  The stop source stopped along with this node
+    StopNode(StopNode &parent, std::stop_source source)
+        : mState(std::make_shared<State>(std::move(source)))
+        , mParent(parent.mState)
+    {
+        attach();
+    }
+
+    /// @brief  Destructor, leaving the parent's children. This does not
+    ///         request a stop, and any children are left in place.
+    ~StopNode()
+    {
+        detach();
+    }
+
+    StopNode(const StopNode &) = delete;
+    StopNode &operator=(const StopNode &) = delete;
+
+    StopNode(StopNode &&other) noexcept = default;
+
+    /// @brief  Move assignment, first leaving the current parent
+    StopNode &operator=(StopNode &&other) noexcept
+    {
+        if (this != &other)
+        {
+            detach();
+            mState = std::move(other.mState);
+            mParent = std::move(other.mParent);
+            mEntry = other.mEntry;
+        }
+        return *this;
+    }
+
+    /// @brief  Requests a stop on this node and everything below it
+    /// @returns    True if this call made the request
+    bool request_stop() noexcept
+    {
+        return mState && stop(*mState);
+    }
+
+    /// @brief  Whether a stop has been requested on this node, or directly on
+    ///         its stop source. Only a stop through the node is passed down.
+    bool stop_requested() const noexcept
+    {
+        return mState && mState->source.stop_requested();
+    }
+
+    /// @brief  The token of this node's own stop source
+    std::stop_token get_token() const noexcept
+    {
+        return mState ? mState->source.get_token() : std::stop_token();
+    }
+
+    /// @brief  The number of children currently attached
+    std::size_t children() const
+    {
+        if (!mState)
+        {
+            return 0;
+        }
+        std::lock_guard lock(mState->mutex);
+        return mState->children.size();
+    }
+
+private:
+    /// @brief  The bits of State::flags
+    static constexpr unsigned STOPPED = 1;
+    static constexpr unsigned HAS_CHILDREN = 2;
+
+    /// @brief  The state of a node, shared with the parent's list
+    struct State
+    {
+        /// @brief  Constructor
+        explicit State(std::stop_source stopSource)
+            : source(std::move(stopSource))
+        {
+        }
+
+        /// @brief  The node's stop source
+        std::stop_source source;
+        /// @brief  STOPPED once stopped through the tree, and HAS_CHILDREN
+        ///         once a child has ever been attached. Both sides set their
+        ///         bit with one atomic operation, so that a stop and a child
+        ///         attaching always see one another, and a node that has
+        ///         never had children is stopped without taking the mutex.
+        std::atomic<unsigned> flags{ 0 };
+        /// @brief  Mutex protecting everything below
+        std::mutex mutex;
+        /// @brief  The attached children
+        std::list<std::shared_ptr<State>> children;
+        /// @brief  Set once a stop has taken the children, after which they
+        ///         are no longer removed from the list as they leave
+        bool taken = false;
+    };
+
+    /// @brief  Stops a node's source, then every child below it
+    /// @param  state   The node
+    /// @returns    True if the node was not already stopped
+    static bool stop(State &state) noexcept
+    {
+        const unsigned previous = state.flags.fetch_or(STOPPED);
+        if ((previous & STOPPED) != 0)
+        {
+            return false;
+        }
+        state.source.request_stop();
+        // Any child attaching from here on sees STOPPED, and stops itself
+        if ((previous & HAS_CHILDREN) == 0)
+        {
+            return true;
+        }
+        std::list<std::shared_ptr<State>> children;
+        {
+            std::lock_guard lock(state.mutex);
+            children.swap(state.children);
+            state.taken = true;
+        }
+        for (const std::shared_ptr<State> &child : children)
+        {
+            stop(*child);
+        }
+        return true;
+    }
+
+    /// @brief  Joins the parent's children, or stops straight away if the
+    ///         parent has already stopped
+    void attach()
+    {
+        State &parent = *mParent;
+        {
+            std::lock_guard lock(parent.mutex);
+            if ((parent.flags.fetch_or(HAS_CHILDREN) & STOPPED) == 0)
+            {
+                mEntry = parent.children.insert(parent.children.end(), mState);
+                return;
+            }
+        }
+        mParent.reset();
+        stop(*mState);
+    }
+
+    /// @brief  Leaves the parent's children, unless a stop has taken them
+    void detach() noexcept
+    {
+        if (!mParent)
+        {
+            return;
+        }
+        {
+            std::lock_guard lock(mParent->mutex);
+            if (!mParent->taken)
+            {
+                mParent->children.erase(mEntry);
+            }
+        }
+        mParent.reset();
+    }
+
+    /// @brief  This node's state
+    std::shared_ptr<State> mState;
+    /// @brief  The parent's state, whilst attached to it
+    std::shared_ptr<State> mParent;
+    /// @brief  This node's entry in the parent's children
+    std::list<std::shared_ptr<State>>::iterator mEntry;
+};
@@ -0,0 +1,424 @@
+/**
+ * @file    task-graph.h
+ *
+ * @brief   A graph of tasks with dependencies between them, run on a
+ *          ThreadPool. Where examples 5 to 7 chain one thread onto another
+ *          through a stop_callback, one edge at a time, here every node and
+ *          edge is declared up front, and each node is run as soon as all of
+ *          its predecessors have finished.
+ *
+ *          Each node keeps an atomic count of the predecessors it is still
+ *          waiting on. The worker finishing a node counts down each of its
+ *          successors, runs the first that becomes ready itself, straight
+ *          away, and queues any others on the pool, so that a chain of nodes
+ *          runs on one thread without going through the queue at all.
+ *
+ *          Every node has a std::stop_source of its own, passed to the node as
+ *          a token. For every edge, a std::stop_callback on the earlier node's
+ *          token requests a stop on the later node's source, so cancelling a
+ *          node cancels everything downstream of it before cancel() returns,
+ *          whichever thread calls it, and whether or not those nodes have been
+ *          reached. A node that is cancelled before it starts is not run, but
+ *          still counts as finished, so that the graph always completes, and
+ *          one that returns once a stop has been requested counts as
+ *          cancelled. A node that throws cancels its successors in the same
+ *          way.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <stop_token>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "fixed-array.h"
+#include "thread-arena.h"
+#include "thread-pool.h"
+
+/// @brief  A graph of dependent tasks
+class TaskGraph
+{
+public:
+    /// @brief  Identifies a node within its graph
+    using NodeId = std::size_t;
+
+    /// @brief  What became of a node in the last run
+    enum class NodeState
+    {
+        /// @brief  Not yet run, or not run since the graph was built
+        PENDING,
+        /// @brief  Ran to completion
+        COMPLETED,
+        /// @brief  Cancelled, by itself or upstream, either before it started
+        ///         or whilst it ran
+        CANCELLED,
+        /// @brief  Threw an exception
+        FAILED,
+    };
+
+    /// @brief  Constructor, with an empty graph
+    TaskGraph() = default;
+
+    TaskGraph(const TaskGraph &) = delete;
+    TaskGraph &operator=(const TaskGraph &) = delete;
+
+    /// @brief  Adds a node
+    /// @param  work    The node's work, given the node's stop token if it
+    ///                 accepts one
+    /// @returns    The node's ID
+    /// @throws std::logic_error whilst the graph is running
+    template<typename F>
+    NodeId add(F &&work)
+    {
+        checkIdle();
+        Node &node = mNodes.emplace_back();
+        if constexpr (std::is_invocable_v<std::decay_t<F> &, const std::stop_token &>)
+        {
+            node.work = std::forward<F>(work);
+        }
+        else
+        {
+            node.work = [work = std::forward<F>(work)](const std::stop_token &) mutable {
+                work();
+            };
+        }
+        return mNodes.size() - 1;
+    }
+
+    /// @brief  Adds an edge, so that one node only runs once another finishes
+    /// @param  before  The node to finish first
+    /// @param  after   The node to run once it has
+    /// @throws std::out_of_range if either node does not exist
+    /// @throws std::logic_error whilst the graph is running
+    void addEdge(NodeId before, NodeId after)
+    {
+        checkIdle();
+        if (before >= mNodes.size() || after >= mNodes.size())
+        {
+            throw std::out_of_range("TaskGraph: no such node");
+        }
+        mNodes[before].successors.push_back(after);
+        ++mNodes[after].predecessors;
+        ++mEdges;
+    }
+
+    /// @brief  Cancels a node and everything downstream of it, in the current
+    ///         run, or the next if the graph is not running. Nodes already
+    ///         running see a stop requested on their token. May be called from
+    ///         any thread, including from within a node.
+    /// @param  node    The node
+    /// @throws std::out_of_range if the node does not exist
+    void cancel(NodeId node)
+    {
+        if (node >= mNodes.size())
+        {
+            throw std::out_of_range("TaskGraph: no such node");
+        }
+        std::lock_guard lock(mSourceMutex);
+        mNodes[node].source.request_stop();
+    }
+
+    /// @brief  Runs the graph, returning once every node has finished or been
+    ///         cancelled. The calling thread runs nodes as well, rather than
+    ///         blocking. Each node runs at most once per run, and the graph
+    ///         may be run again once this returns.
+    /// @param  pool    The pool to run the nodes on
+    /// @param  token   Cancels every node not yet started once stopped
+    /// @returns    True if every node completed
+    /// @throws std::invalid_argument if the edges form a cycle
+    /// @throws std::logic_error if the graph is already running
+    /// @throws Whatever the first node to fail threw
+    bool run(ThreadPool &pool, std::stop_token token = std::stop_token())
+    {
+        if (mRunning.exchange(true))
+        {
+            throw std::logic_error("TaskGraph: the graph is already running");
+        }
+        if (hasCycle())
+        {
+            mRunning.store(false);
+            throw std::invalid_argument("TaskGraph: the edges form a cycle");
+        }
+
+        auto state = std::allocate_shared<RunState>(
+            std::pmr::polymorphic_allocator<RunState>(&ThreadArena::local()));
+        state->remaining.store(mNodes.size(), std::memory_order_relaxed);
+        std::vector<NodeId> roots;
+        for (NodeId id = 0; id < mNodes.size(); ++id)
+        {
+            Node &node = mNodes[id];
+            node.waiting.store(node.predecessors, std::memory_order_relaxed);
+            node.state.store(NodeState::PENDING, std::memory_order_relaxed);
+            if (node.predecessors == 0)
+            {
+                roots.push_back(id);
+            }
+        }
+
+        // Chain the stop sources along every edge. A node cancelled before
+        // the run has its callbacks called here, straight away.
+        mChains.emplace(mEdges);
+        for (Node &node : mNodes)
+        {
+            for (const NodeId successor : node.successors)
+            {
+                mChains->emplace_back(node.source.get_token(), StopChain{ &mNodes[successor].source });
+            }
+        }
+        {
+            std::stop_callback cancelAll(token, [this]() {
+                for (NodeId id = 0; id < mNodes.size(); ++id)
+                {
+                    cancel(id);
+                }
+            });
+
+            // Queue all but the first root, which is run here
+            for (std::size_t i = 1; i < roots.size(); ++i)
+            {
+                spawn(pool, state, roots[i]);
+            }
+            if (!roots.empty())
+            {
+                execute(pool, state, roots.front());
+                pool.helpUntil(state->done.get_token());
+            }
+            // Should the pool have been shut down, helping ends early, whilst
+            // the last nodes may still be finishing on the workers
+            std::size_t remaining = 0;
+            while ((remaining = state->remaining.load()) != 0)
+            {
+                state->remaining.wait(remaining);
+            }
+        }
+
+        // Every run starts with fresh stop sources, replaced under the lock
+        // so that a cancel() from another thread never sees one half replaced
+        mChains.reset();
+        bool completed = true;
+        {
+            std::lock_guard lock(mSourceMutex);
+            for (Node &node : mNodes)
+            {
+                node.source = std::stop_source();
+                completed = completed && (node.state.load() == NodeState::COMPLETED);
+            }
+        }
+        mRunning.store(false);
+        if (state->error)
+        {
+            std::rethrow_exception(state->error);
+        }
+        return completed;
+    }
+
+    /// @brief  What became of a node in the last run
+    /// @param  node    The node
+    /// @throws std::out_of_range if the node does not exist
+    NodeState state(NodeId node) const
+    {
+        if (node >= mNodes.size())
+        {
+            throw std::out_of_range("TaskGraph: no such node");
+        }
+        return mNodes[node].state.load();
+    }
+
+    /// @brief  The number of nodes
+    std::size_t size() const
+    {
+        return mNodes.size();
+    }
+
+private:
+    /// @brief  A node of the graph
+    struct Node
+    {
+        /// @brief  The node's work
+        std::function<void(const std::stop_token &)> work;
+        /// @brief  The nodes that wait on this one
+        std::vector<NodeId> successors;
+        /// @brief  The number of nodes this one waits on
+        std::size_t predecessors = 0;
+        /// @brief  The predecessors not yet finished in this run
+        std::atomic<std::size_t> waiting{ 0 };
+        /// @brief  What became of the node
+        std::atomic<NodeState> state{ NodeState::PENDING };
+        /// @brief  Cancels this node, and through the chains, its successors
+        std::stop_source source;
+    };
+
+    /// @brief  Passes a stop request along an edge
+    struct StopChain
+    {
+        /// @brief  Requests a stop on the later node
+        void operator()() const
+        {
+            target->request_stop();
+        }
+
+        /// @brief  The later node's stop source
+        std::stop_source *target;
+    };
+
+    /// @brief  The state of a single run, kept alive by every queued node
+    ///         until the last has finished with it
+    struct RunState
+    {
+        /// @brief  The nodes not yet finished
+        std::atomic<std::size_t> remaining{ 0 };
+        /// @brief  Stopped once every node has finished, ending the caller's
+        ///         help
+        std::stop_source done;
+        /// @brief  Mutex protecting error
+        std::mutex errorMutex;
+        /// @brief  The first exception thrown by a node
+        std::exception_ptr error;
+    };
+
+    /// @brief  Throws if the graph is running
+    void checkIdle() const
+    {
+        if (mRunning.load())
+        {
+            throw std::logic_error("TaskGraph: the graph is running");
+        }
+    }
+
+    /// @brief  Whether the edges form a cycle, found by removing the nodes
+    ///         with no unremoved predecessors until none are left
+    bool hasCycle() const
+    {
+        std::vector<std::size_t> waiting(mNodes.size());
+        std::vector<NodeId> ready;
+        for (NodeId id = 0; id < mNodes.size(); ++id)
+        {
+            waiting[id] = mNodes[id].predecessors;
+            if (waiting[id] == 0)
+            {
+                ready.push_back(id);
+            }
+        }
+        std::size_t removed = 0;
+        while (!ready.empty())
+        {
+            const NodeId id = ready.back();
+            ready.pop_back();
+            ++removed;
+            for (const NodeId successor : mNodes[id].successors)
+            {
+                if (--waiting[successor] == 0)
+                {
+                    ready.push_back(successor);
+                }
+            }
+        }
+        return removed != mNodes.size();
+    }
+
+    /// @brief  Queues a ready node on the pool
+    void spawn(ThreadPool &pool, const std::shared_ptr<RunState> &state, NodeId id)
+    {
+        try
+        {
+            pool.push(Task([this, &pool, state, id]() {
+                execute(pool, state, id);
+            }));
+        }
+        catch (const std::runtime_error &)
+        {
+            // The pool has been shut down, so the node is run here instead
+            execute(pool, state, id);
+        }
+    }
+
+    /// @brief  Runs a ready node, then each successor it leaves ready,
+    ///         continuing with the first itself and queueing the rest
+    void execute(ThreadPool &pool, const std::shared_ptr<RunState> &state, NodeId id)
+    {
+        while (true)
+        {
+            Node &node = mNodes[id];
+            const std::stop_token token = node.source.get_token();
+            if (token.stop_requested())
+            {
+                node.state.store(NodeState::CANCELLED);
+            }
+            else
+            {
+                try
+                {
+                    node.work(token);
+                    node.state.store(token.stop_requested() ?
+                        NodeState::CANCELLED : NodeState::COMPLETED);
+                }
+                catch (...)
+                {
+                    {
+                        std::lock_guard lock(state->errorMutex);
+                        if (!state->error)
+                        {
+                            state->error = std::current_exception();
+                        }
+                    }
+                    node.state.store(NodeState::FAILED);
+                    node.source.request_stop();
+                }
+            }
+
+            std::optional<NodeId> next;
+            for (const NodeId successor : node.successors)
+            {
+                if (mNodes[successor].waiting.fetch_sub(1) == 1)
+                {
+                    if (!next)
+                    {
+                        next = successor;
+                    }
+                    else
+                    {
+                        spawn(pool, state, successor);
+                    }
+                }
+            }
+            // Once the last node is counted, nothing but the run state may be
+            // touched, as the caller is then free to return
+            if (state->remaining.fetch_sub(1) == 1)
+            {
+                state->done.request_stop();
+                state->remaining.notify_all();
+            }
+            if (!next)
+            {
+                return;
+            }
+            id = *next;
+        }
+    }
+
+    /// @brief  The nodes, which never move once added
+    std::deque<Node> mNodes;
+    /// @brief  The number of edges
+    std::size_t mEdges = 0;
+    /// @brief  The stop callbacks chaining each edge, whilst running
+    std::optional<FixedArray<std::stop_callback<StopChain>>> mChains;
+    /// @brief  Set whilst running
+    std::atomic<bool> mRunning{ false };
+    /// @brief  Mutex held by cancel() and whilst the stop sources are
+    ///         replaced at the end of a run
+    std::mutex mSourceMutex;
+};
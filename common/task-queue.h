@@ -0,0 +1,462 @@
+/**
+ * @file    task-queue.h
+ *
+ * @brief   The shared task queue used by the example 7 thread pool, combining
+ *          the std::mutex, std::queue and std::condition_variable_any into one
+ *          object. Items can be added and taken in batches, so that a single
+ *          lock, and no more than one wake-up per waiting worker, can cover
+ *          many items.
+ *
+ *          The items are held by value in contiguous rings, which only grow
+ *          when full, so once they have reached their working size queueing an
+ *          item never allocates.
+ *
+ *          A queue may have a fixed number of priority lanes, lane 0 being the
+ *          most urgent, so that short latency-sensitive items need not wait
+ *          behind long batch items. Workers either always take from the most
+ *          urgent lane with work (strict), or share turns between the lanes in
+ *          proportion to their weights (weighted), so that the least urgent
+ *          lanes are never starved. A mask of the non-empty lanes and a total
+ *          count are kept alongside the rings, so neither the wait predicate
+ *          nor choosing a lane needs to scan them.
+ *
+ *          A worker may pass an AdaptiveWait, so that it spins briefly on
+ *          the item count before parking, rather than waiting under the lock.
+ *          A worker that is spinning is not counted as waiting, so items
+ *          queued meanwhile are not followed by a notification either.
+ *
+ *          Closing the queue refuses any further items, and lets workers leave
+ *          once it is empty without a stop being requested, so that a group of
+ *          workers can drain it together.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <utility>
+#include <vector>
+
+#include "adaptive-wait.h"
+#include "worker-stats.h"
+
+/// @brief  How a worker chooses between the lanes of a TaskQueue
+enum class LanePolicy
+{
+    /// @brief  Always the most urgent lane holding items
+    STRICT,
+    /// @brief  Each lane holding items in turn, taking up to its weight in
+    ///         items before the less urgent lanes get their turn
+    WEIGHTED,
+};
+
+/// @brief  A queue shared between all workers, protected by a single mutex
+/// @tparam T       The item type
+/// @tparam LANES   The number of priority lanes, lane 0 being the most urgent
+template<typename T, std::size_t LANES = 1>
+class TaskQueue
+{
+    static_assert(LANES > 0 && LANES <= 32, "TaskQueue: 1 to 32 lanes are supported");
+
+public:
+    /// @brief  The depth counters of a single lane
+    struct LaneMetrics
+    {
+        /// @brief  The number of items waiting now
+        std::size_t depth = 0;
+        /// @brief  The most items that have been waiting at once
+        std::size_t peak = 0;
+        /// @brief  The number of items ever added
+        std::uint64_t pushed = 0;
+        /// @brief  The number of items ever taken by workers
+        std::uint64_t taken = 0;
+    };
+
+    /// @brief  The weight of each lane for LanePolicy::WEIGHTED
+    using Weights = std::array<unsigned, LANES>;
+
+    /// @brief  Constructor
+    /// @param  policy  How workers choose between the lanes
+    /// @param  weights The items each lane may give up per turn when weighted,
+    ///                 by default halving with each lane, from lane 0
+    explicit TaskQueue(LanePolicy policy = LanePolicy::STRICT,
+        const Weights &weights = defaultWeights())
+        : mPolicy(policy)
+    {
+        for (std::size_t lane = 0; lane < LANES; ++lane)
+        {
+            mLanes[lane].weight = std::max(weights[lane], 1u);
+            mLanes[lane].credit = mLanes[lane].weight;
+        }
+    }
+
+    TaskQueue(const TaskQueue &) = delete;
+    TaskQueue &operator=(const TaskQueue &) = delete;
+
+    /// @brief  Adds a single item, waking one waiting worker
+    /// @param  item    The item to be added
+    /// @param  lane    The lane to add it to
+    /// @returns    False, without adding the item, if the queue is closed
+    bool push(T item, std::size_t lane = 0)
+    {
+        checkLane(lane);
+        bool wake = false;
+        {
+            std::lock_guard lock(mMutex);
+            if (mClosed)
+            {
+                return false;
+            }
+            pushBack(lane, std::move(item));
+            wake = mWaiting > 0;
+        }
+        if (wake)
+        {
+            mCv.notify_one();
+        }
+        return true;
+    }
+
+    /// @brief  Adds a batch of items under a single lock, waking only as many
+    ///         waiting workers as there are new items
+    /// @param  items   The items to be added, which are moved from
+    /// @param  lane    The lane to add them to
+    /// @returns    False, without adding any items, if the queue is closed
+    bool pushBulk(std::span<T> items, std::size_t lane = 0)
+    {
+        checkLane(lane);
+        if (items.empty())
+        {
+            return true;
+        }
+        std::size_t wake = 0;
+        {
+            std::lock_guard lock(mMutex);
+            if (mClosed)
+            {
+                return false;
+            }
+            mLanes[lane].reserve(mLanes[lane].count + items.size());
+            for (T &item : items)
+            {
+                pushBack(lane, std::move(item));
+            }
+            wake = std::min(items.size(), mWaiting);
+        }
+        for (std::size_t i = 0; i < wake; ++i)
+        {
+            mCv.notify_one();
+        }
+        return true;
+    }
+
+    /// @brief  Takes up to out.size() items under a single lock, waiting for
+    ///         at least one item to be available. Each item is taken from the
+    ///         lane chosen by the queue's LanePolicy.
+    /// @param  out         Storage for the items taken
+    /// @param  token       The stop token of the calling worker
+    /// @param  finishEarly Whether the worker may leave work behind once a
+    ///                     stop has been requested
+    /// @param  stats       If given, records the time spent waiting for and
+    ///                     holding the lock, and idle waiting for items
+    /// @param  spin        If given, the calling worker's wait, which is made
+    ///                     before parking
+    /// @returns    The number of items taken, zero if the worker should stop,
+    ///             which is also the case once the queue is closed and empty
+    std::size_t popUpTo(std::span<T> out, const std::stop_token &token,
+        bool finishEarly, WorkerStats *stats = nullptr, AdaptiveWait *spin = nullptr)
+    {
+        using Clock = WorkerStats::Clock;
+        const Clock::time_point spinning = stats ? Clock::now() : Clock::time_point();
+        const bool spun = spin && spin->wait(token, [this]() {
+            return mAvailable.load(std::memory_order_relaxed) > 0;
+        });
+        const Clock::time_point requested = stats ? Clock::now() : Clock::time_point();
+        std::unique_lock lock(mMutex);
+        const Clock::time_point locked = stats ? Clock::now() : Clock::time_point();
+        // The wait() method accepts a std::stop_token, and returns the result
+        // from the predicate, and so, if the result is false, we know that
+        // stop was requested. Otherwise, there are items on the queue, and
+        // therefore, work to be done.
+        //
+        // If work remains but a stop request has been made, we cannot tell
+        // without checking the token manually, and so finishEarly lets the
+        // worker decide whether it should continue working or exit
+        // immediately if a stop was requested.
+        ++mWaiting;
+        const bool hasWork = mCv.wait(lock, token, [&]() {
+            return mCount > 0 || mClosed;
+        });
+        --mWaiting;
+        const Clock::time_point woken = stats ? Clock::now() : Clock::time_point();
+        if (spin && !spun && hasWork)
+        {
+            spin->parked();
+        }
+        std::size_t count = 0;
+        if (hasWork && mCount > 0 && !(finishEarly && token.stop_requested()))
+        {
+            count = std::min(out.size(), mCount);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const std::size_t index = nextLane();
+                Lane &lane = mLanes[index];
+                out[i] = lane.popFront();
+                ++lane.taken;
+                if (lane.count == 0)
+                {
+                    mNonEmpty &= ~laneBit(index);
+                }
+            }
+            mCount -= count;
+            mAvailable.store(mCount, std::memory_order_relaxed);
+        }
+        if (stats)
+        {
+            stats->recordIdle((woken - locked) + (requested - spinning));
+            stats->recordLock(locked - requested, Clock::now() - woken);
+        }
+        return count;
+    }
+
+    /// @brief  Refuses any further items, and wakes every waiting worker so
+    ///         that each leaves once the queue is empty
+    void close()
+    {
+        {
+            std::lock_guard lock(mMutex);
+            mClosed = true;
+        }
+        mCv.notify_all();
+    }
+
+    /// @brief  Whether the queue has been closed
+    bool closed() const
+    {
+        std::lock_guard lock(mMutex);
+        return mClosed;
+    }
+
+    /// @brief  Removes every item still waiting
+    /// @returns    The items, most urgent lane first, and oldest first within
+    ///             each lane
+    std::vector<T> takeAll()
+    {
+        std::lock_guard lock(mMutex);
+        std::vector<T> items;
+        items.reserve(mCount);
+        for (Lane &lane : mLanes)
+        {
+            while (lane.count > 0)
+            {
+                items.push_back(lane.popFront());
+            }
+        }
+        mCount = 0;
+        mAvailable.store(0, std::memory_order_relaxed);
+        mNonEmpty = 0;
+        return items;
+    }
+
+    /// @brief  The number of items waiting across every lane
+    std::size_t size() const
+    {
+        std::lock_guard lock(mMutex);
+        return mCount;
+    }
+
+    /// @brief  The depth counters of a lane
+    /// @param  lane    The lane
+    LaneMetrics metrics(std::size_t lane) const
+    {
+        checkLane(lane);
+        std::lock_guard lock(mMutex);
+        const Lane &entry = mLanes[lane];
+        return LaneMetrics{ entry.count, entry.peak, entry.pushed, entry.taken };
+    }
+
+    /// @brief  The number of lanes
+    static constexpr std::size_t lanes()
+    {
+        return LANES;
+    }
+
+private:
+    /// @brief  The size of a lane's ring when first used
+    static constexpr std::size_t MIN_CAPACITY = 16;
+
+    /// @brief  A single priority lane. Protected by mMutex.
+    struct Lane
+    {
+        /// @brief  The ring of queued items, always a power of two in size
+        std::vector<T> items;
+        /// @brief  The index of the oldest item
+        std::size_t head = 0;
+        /// @brief  The number of items queued
+        std::size_t count = 0;
+        /// @brief  The items taken per turn when weighted
+        unsigned weight = 1;
+        /// @brief  The items that may still be taken this turn when weighted
+        unsigned credit = 1;
+        /// @brief  The metrics reported by metrics()
+        std::size_t peak = 0;
+        std::uint64_t pushed = 0;
+        std::uint64_t taken = 0;
+
+        /// @brief  Grows the ring, if needed, to hold at least the given
+        ///         number of items
+        /// @param  wanted  The number of items to make room for
+        void reserve(std::size_t wanted)
+        {
+            if (wanted <= items.size())
+            {
+                return;
+            }
+            std::size_t capacity = std::max(items.size(), MIN_CAPACITY);
+            while (capacity < wanted)
+            {
+                capacity *= 2;
+            }
+            // Move the items across in order, so they start at the front again
+            std::vector<T> grown(capacity);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                grown[i] = std::move(items[(head + i) & (items.size() - 1)]);
+            }
+            items = std::move(grown);
+            head = 0;
+        }
+
+        /// @brief  Takes the oldest item, which must exist
+        T popFront()
+        {
+            // Leave an empty item behind, so that whatever the item owned is
+            // released now rather than when the slot is next reused
+            T item = std::exchange(items[head], T());
+            head = (head + 1) & (items.size() - 1);
+            --count;
+            return item;
+        }
+    };
+
+    /// @brief  The default weights, halving from lane 0 down to 1
+    static Weights defaultWeights()
+    {
+        Weights weights{};
+        for (std::size_t lane = 0; lane < LANES; ++lane)
+        {
+            weights[lane] = 1u << std::min<std::size_t>(LANES - 1 - lane, 8);
+        }
+        return weights;
+    }
+
+    /// @brief  The bit of a lane within mNonEmpty
+    static std::uint32_t laneBit(std::size_t lane)
+    {
+        return std::uint32_t{ 1 } << lane;
+    }
+
+    /// @brief  Throws if a lane does not exist
+    static void checkLane(std::size_t lane)
+    {
+        if (lane >= LANES)
+        {
+            throw std::out_of_range("TaskQueue: no such lane");
+        }
+    }
+
+    /// @brief  Adds an item to the back of a lane. Must be called with mMutex
+    ///         held.
+    /// @param  lane    The lane
+    /// @param  item    The item to be added
+    void pushBack(std::size_t lane, T &&item)
+    {
+        Lane &entry = mLanes[lane];
+        entry.reserve(entry.count + 1);
+        entry.items[(entry.head + entry.count) & (entry.items.size() - 1)] = std::move(item);
+        ++entry.count;
+        ++entry.pushed;
+        entry.peak = std::max(entry.peak, entry.count);
+        mNonEmpty |= laneBit(lane);
+        ++mCount;
+        mAvailable.store(mCount, std::memory_order_relaxed);
+    }
+
+    /// @brief  Chooses the lane for the next item taken. Must be called with
+    ///         mMutex held, and with at least one item queued.
+    std::size_t nextLane()
+    {
+        if constexpr (LANES == 1)
+        {
+            return 0;
+        }
+        if (mPolicy == LanePolicy::STRICT)
+        {
+            return static_cast<std::size_t>(std::countr_zero(mNonEmpty));
+        }
+        // The most urgent lane with items that still has credit this turn.
+        // Once every lane with items has used its credit, a new turn starts,
+        // and lanes that were empty do not carry their credit over.
+        std::uint32_t ready = mNonEmpty & mHasCredit;
+        if (ready == 0)
+        {
+            for (Lane &lane : mLanes)
+            {
+                lane.credit = lane.weight;
+            }
+            mHasCredit = ALL_LANES;
+            ready = mNonEmpty;
+        }
+        const std::size_t lane = static_cast<std::size_t>(std::countr_zero(ready));
+        if (--mLanes[lane].credit == 0)
+        {
+            mHasCredit &= ~laneBit(lane);
+        }
+        return lane;
+    }
+
+    /// @brief  A mask of every lane
+    static constexpr std::uint32_t ALL_LANES =
+        static_cast<std::uint32_t>((std::uint64_t{ 1 } << LANES) - 1);
+
+    // The read-mostly policy, the mutex, the copy of the count read by
+    // spinning workers, and the condition variable, which is notified
+    // outside of the lock, each start a cache line of their own. The state
+    // guarded by the mutex follows straight after it, starting on the
+    // mutex's line and running on through the lanes for as many lines as
+    // they need. None of it is padded apart, as it is only ever touched by
+    // whoever has just taken the lock.
+
+    /// @brief  How workers choose between the lanes
+    const LanePolicy mPolicy;
+    /// @brief  Mutex protecting everything up to mCv
+    alignas(CACHE_LINE_SIZE) mutable std::mutex mMutex;
+    /// @brief  A bit for each lane holding items
+    std::uint32_t mNonEmpty = 0;
+    /// @brief  A bit for each lane with credit this turn
+    std::uint32_t mHasCredit = ALL_LANES;
+    /// @brief  The number of items queued across every lane
+    std::size_t mCount = 0;
+    /// @brief  The number of workers waiting for items
+    std::size_t mWaiting = 0;
+    /// @brief  Set once the queue refuses new items
+    bool mClosed = false;
+    /// @brief  The lanes, most urgent first
+    std::array<Lane, LANES> mLanes;
+    /// @brief  Copy of mCount, readable without the lock
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mAvailable{ 0 };
+    /// @brief  Condition variable used to signal new items
+    alignas(CACHE_LINE_SIZE) std::condition_variable_any mCv;
+};
@@ -0,0 +1,378 @@
+/**
+ * @file    task.h
+ *
+ * @brief   A move-only task type for the thread pool, and a future used to
+ *          collect a task's result.
+ *
+ *          Task holds any callable taking no arguments. Callables of up to
+ *          Task::INLINE_SIZE bytes, which covers lambdas capturing around six
+ *          pointers, are stored inside the Task itself, so they can be queued
+ *          by value without any allocation. Only larger callables are moved
+ *          out, into the ThreadArena of the thread creating the Task, rather
+ *          than onto the global heap. Unlike std::function, the callable need
+ *          not be copyable.
+ *
+ *          TaskFuture holds the result inside itself rather than in a shared,
+ *          heap allocated state as std::future does. In exchange it cannot be
+ *          moved, and so is only ever returned from submit() by value, which
+ *          C++17 guarantees is constructed in place, or constructed directly
+ *          inside a container. As with the future from
+ *          std::async, destroying it waits for the task to finish.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "thread-arena.h"
+
+/// @brief  A move-only callable, stored inline when small enough
+class Task
+{
+public:
+    /// @brief  The largest callable stored without allocating, chosen so that
+    ///         a Task fills exactly one 64 byte cache line
+    static constexpr std::size_t INLINE_SIZE = 56;
+
+    /// @brief  Whether a callable of the given type is stored inline
+    template<typename F>
+    static constexpr bool STORED_INLINE = sizeof(F) <= INLINE_SIZE &&
+        alignof(F) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible_v<F>;
+
+    /// @brief  Constructs an empty task
+    Task() noexcept = default;
+
+    /// @brief  Constructs a task from any callable taking no arguments
+    /// @param  callable    The callable, which is moved or copied in
+    template<typename F>
+        requires (!std::same_as<std::remove_cvref_t<F>, Task> &&
+            std::invocable<std::decay_t<F> &>)
+    Task(F &&callable)
+    {
+        using Callable = std::decay_t<F>;
+        if constexpr (STORED_INLINE<Callable>)
+        {
+            new (mStorage) Callable(std::forward<F>(callable));
+            mOps = &INLINE_OPS<Callable>;
+        }
+        else
+        {
+            ThreadArena &arena = ThreadArena::local();
+            void *memory = arena.allocate(sizeof(Callable), alignof(Callable));
+            try
+            {
+                new (mStorage) Outside{ new (memory) Callable(std::forward<F>(callable)), &arena };
+            }
+            catch (...)
+            {
+                arena.deallocate(memory, sizeof(Callable), alignof(Callable));
+                throw;
+            }
+            mOps = &OUTSIDE_OPS<Callable>;
+        }
+    }
+
+    /// @brief  Destructor, destroying the callable
+    ~Task()
+    {
+        reset();
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    /// @brief  Move constructor
+    Task(Task &&other) noexcept
+    {
+        take(other);
+    }
+
+    /// @brief  Move assignment
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    /// @brief  Runs the callable
+    void operator()()
+    {
+        mOps->invoke(mStorage);
+    }
+
+    /// @brief  Whether the task holds a callable
+    explicit operator bool() const noexcept
+    {
+        return mOps != nullptr;
+    }
+
+    /// @brief  Destroys the callable, leaving the task empty
+    void reset() noexcept
+    {
+        if (mOps != nullptr)
+        {
+            mOps->destroy(mStorage);
+            mOps = nullptr;
+        }
+    }
+
+private:
+    /// @brief  The operations for a single type of callable
+    struct Ops
+    {
+        void (*invoke)(void *storage);
+        void (*move)(void *to, void *from) noexcept;
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    /// @brief  Operations for a callable held in mStorage
+    template<typename F>
+    static constexpr Ops INLINE_OPS{
+        [](void *storage) {
+            (*std::launder(static_cast<F *>(storage)))();
+        },
+        [](void *to, void *from) noexcept {
+            F *source = std::launder(static_cast<F *>(from));
+            new (to) F(std::move(*source));
+            source->~F();
+        },
+        [](void *storage) noexcept {
+            std::launder(static_cast<F *>(storage))->~F();
+        }
+    };
+
+    /// @brief  A callable held outside the task, as held in mStorage
+    struct Outside
+    {
+        /// @brief  The callable
+        void *callable;
+        /// @brief  The arena it was allocated from, which may be another
+        ///         thread's by the time it is freed
+        std::pmr::memory_resource *arena;
+    };
+
+    /// @brief  Operations for a callable held outside the task
+    template<typename F>
+    static constexpr Ops OUTSIDE_OPS{
+        [](void *storage) {
+            (*static_cast<F *>(std::launder(static_cast<Outside *>(storage))->callable))();
+        },
+        [](void *to, void *from) noexcept {
+            new (to) Outside(*std::launder(static_cast<Outside *>(from)));
+        },
+        [](void *storage) noexcept {
+            const Outside outside = *std::launder(static_cast<Outside *>(storage));
+            static_cast<F *>(outside.callable)->~F();
+            outside.arena->deallocate(outside.callable, sizeof(F), alignof(F));
+        }
+    };
+
+    /// @brief  Takes the callable from another task, leaving it empty
+    void take(Task &other) noexcept
+    {
+        if (other.mOps != nullptr)
+        {
+            other.mOps->move(mStorage, other.mStorage);
+            mOps = std::exchange(other.mOps, nullptr);
+        }
+    }
+
+    /// @brief  The callable, or a pointer to it
+    alignas(std::max_align_t) std::byte mStorage[INLINE_SIZE];
+    /// @brief  The operations for the callable held, or null when empty
+    const Ops *mOps = nullptr;
+};
+
+/// @brief  The parts of TaskFuture that do not depend on the result type
+class TaskFutureBase
+{
+public:
+    /// @brief  Whether the result is available, without waiting
+    bool ready() const noexcept
+    {
+        return mReady.load(std::memory_order_acquire);
+    }
+
+    /// @brief  Blocks until the result is available
+    void wait() const
+    {
+        if (ready())
+        {
+            return;
+        }
+        Stripe &stripe = stripeFor(this);
+        std::unique_lock lock(stripe.mutex);
+        stripe.cv.wait(lock, [&]() { return ready(); });
+    }
+
+protected:
+    TaskFutureBase() = default;
+    TaskFutureBase(const TaskFutureBase &) = delete;
+    TaskFutureBase &operator=(const TaskFutureBase &) = delete;
+
+    /// @brief  Marks the result as available, waking any waiters. After this
+    ///         the future may be destroyed at any moment, so it must be the
+    ///         last use of the future.
+    void setReady()
+    {
+        // The notifying thread must not touch the future once a waiter can
+        // see it is ready, in case the waiter destroys it. So the waiters are
+        // woken through a mutex and condition variable shared between all
+        // futures, rather than held by each one.
+        Stripe &stripe = stripeFor(this);
+        {
+            std::lock_guard lock(stripe.mutex);
+            mReady.store(true, std::memory_order_release);
+        }
+        stripe.cv.notify_all();
+    }
+
+    /// @brief  The exception thrown by the task, if any
+    std::exception_ptr mError;
+
+private:
+    /// @brief  A mutex and condition variable, shared by many futures
+    struct Stripe
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+
+    /// @brief  Gets the stripe used by a future
+    static Stripe &stripeFor(const void *future)
+    {
+        static constexpr std::size_t STRIPES = 16;
+        static Stripe stripes[STRIPES];
+        return stripes[(reinterpret_cast<std::uintptr_t>(future) / 64) % STRIPES];
+    }
+
+    /// @brief  Set once the result, or error, has been stored
+    std::atomic<bool> mReady{ false };
+};
+
+/// @brief  The result of a submitted task, held in place. Not copyable or
+///         movable, it is constructed directly where submit() returns it.
+template<typename R>
+class TaskFuture : public TaskFutureBase
+{
+public:
+    /// @brief  Constructor, wrapping the callable in a Task that fills in
+    ///         this future, then pushing the Task to the executor to be run.
+    ///         Being constructed in place, futures can be created directly
+    ///         within a container that never moves its elements, such as
+    ///         with std::deque::emplace_back(executor, callable).
+    /// @param  executor    Anything with a push(Task) method, such as a
+    ///                     ThreadPool
+    /// @param  callable    The callable returning the result
+    template<typename Executor, typename F>
+    TaskFuture(Executor &executor, F &&callable)
+    {
+        executor.push(Task(
+            [promise = Promise(this), fn = std::forward<F>(callable)]() mutable {
+                promise.run(fn);
+            }));
+    }
+
+    /// @brief  Destructor, waiting for the task so that it never writes to a
+    ///         future that no longer exists
+    ~TaskFuture()
+    {
+        wait();
+    }
+
+    /// @brief  Waits for the task, then returns its result, or rethrows the
+    ///         exception it threw. Should only be called once.
+    R get()
+    {
+        wait();
+        if (mError)
+        {
+            std::rethrow_exception(mError);
+        }
+        if constexpr (!std::is_void_v<R>)
+        {
+            return std::move(*mValue);
+        }
+    }
+
+private:
+    /// @brief  Value storage, with void replaced by an empty type
+    using Value = std::conditional_t<std::is_void_v<R>, std::monostate, R>;
+
+    /// @brief  Carried by the task, filling in the future when the task runs.
+    ///         If the task is destroyed without being run, the future is
+    ///         given a std::future_error of broken_promise instead, so that
+    ///         nothing waits on it forever.
+    class Promise
+    {
+    public:
+        explicit Promise(TaskFuture *future) noexcept : mFuture(future) {}
+
+        Promise(Promise &&other) noexcept
+            : mFuture(std::exchange(other.mFuture, nullptr))
+        {
+        }
+
+        Promise &operator=(Promise &&) = delete;
+
+        ~Promise()
+        {
+            if (mFuture != nullptr)
+            {
+                mFuture->mError = std::make_exception_ptr(
+                    std::future_error(std::future_errc::broken_promise));
+                std::exchange(mFuture, nullptr)->setReady();
+            }
+        }
+
+        /// @brief  Runs the callable, storing its result or exception
+        template<typename F>
+        void run(F &fn)
+        {
+            try
+            {
+                if constexpr (std::is_void_v<R>)
+                {
+                    std::invoke(fn);
+                }
+                else
+                {
+                    mFuture->mValue.emplace(std::invoke(fn));
+                }
+            }
+            catch (...)
+            {
+                mFuture->mError = std::current_exception();
+            }
+            std::exchange(mFuture, nullptr)->setReady();
+        }
+
+    private:
+        /// @brief  The future to fill in, or null once done
+        TaskFuture *mFuture;
+    };
+
+    /// @brief  The result, once available
+    std::optional<Value> mValue;
+};
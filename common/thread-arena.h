@@ -0,0 +1,331 @@
+/**
+ * @file    thread-arena.h
+ *
+ * @brief   A memory arena for each thread, exposed as a
+ *          std::pmr::memory_resource, so that the small, short-lived
+ *          allocations made for each task, such as large task closures and
+ *          the state shared by a single run, come from the thread making them
+ *          rather than from the global allocator, which every thread would
+ *          otherwise contend on.
+ *
+ *          Blocks are rounded up to one of a few size classes and carved from
+ *          large chunks, with a free list for each class, so that once the
+ *          arena has reached its working size, allocating and freeing costs a
+ *          few pointer moves and never leaves the thread. Each arena is only
+ *          ever allocated from by its own thread, but blocks are often freed
+ *          elsewhere, such as a task's closure, which is freed by the worker
+ *          that ran it. Those are pushed onto a lock-free list of their own,
+ *          which the owner takes back in one go once it runs out of blocks.
+ *
+ *          Every block holds a reference to its arena, so an arena whose
+ *          thread has exited lives on until its last block is freed. A thread
+ *          that has finished a job can reset its arena, returning every chunk
+ *          but the first in bulk, provided nothing allocated from it is still
+ *          in use.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+#include "cpu.h"
+
+/// @brief  The calling thread's memory arena
+class ThreadArena : public std::pmr::memory_resource
+{
+public:
+    /// @brief  The smallest block, which must hold a free list entry
+    static constexpr std::size_t MIN_BLOCK = 16;
+    /// @brief  The largest block kept by the arena, anything larger, or more
+    ///         strictly aligned than std::max_align_t, coming from upstream
+    static constexpr std::size_t MAX_BLOCK = 2048;
+    /// @brief  The size of each chunk blocks are carved from
+    static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+    /// @brief  The arena's counters
+    struct Stats
+    {
+        /// @brief  The number of blocks allocated
+        std::uint64_t allocations = 0;
+        /// @brief  The number of those freed by another thread
+        std::uint64_t remoteFrees = 0;
+        /// @brief  The number of allocations made upstream, for chunks or for
+        ///         blocks too large to keep
+        std::uint64_t upstream = 0;
+        /// @brief  The number of successful resets
+        std::uint64_t resets = 0;
+        /// @brief  The number of blocks not yet freed
+        std::size_t live = 0;
+    };
+
+    /// @brief  Gets the calling thread's arena, creating it on first use
+    static ThreadArena &local()
+    {
+        thread_local const Owner owner;
+        return *owner.arena;
+    }
+
+    ThreadArena(const ThreadArena &) = delete;
+    ThreadArena &operator=(const ThreadArena &) = delete;
+
+    /// @brief  Returns every chunk but the first to upstream, and forgets every
+    ///         free block, if no block is still in use. Owning thread only.
+    /// @returns    True if the arena was reset
+    bool reset()
+    {
+        if (mRefs.load(std::memory_order_acquire) != 1)
+        {
+            return false;
+        }
+        // Nothing is live, so nor is anything left on the remote list
+        std::fill(std::begin(mFree), std::end(mFree), nullptr);
+        mRemote.store(nullptr, std::memory_order_relaxed);
+        if (mChunks != nullptr)
+        {
+            while (mChunks->next != nullptr)
+            {
+                Chunk *next = mChunks->next;
+                freeChunk(mChunks);
+                mChunks = next;
+            }
+            mPosition = mChunks->data();
+        }
+        add(mResets, 1);
+        return true;
+    }
+
+    /// @brief  Copies the counters. Any thread may call this whilst the owner
+    ///         is running.
+    Stats stats() const
+    {
+        Stats stats;
+        stats.allocations = mAllocations.load(std::memory_order_relaxed);
+        stats.remoteFrees = mRemoteFrees.load(std::memory_order_relaxed);
+        stats.upstream = mUpstream.load(std::memory_order_relaxed);
+        stats.resets = mResets.load(std::memory_order_relaxed);
+        stats.live = mRefs.load(std::memory_order_relaxed) - 1;
+        return stats;
+    }
+
+protected:
+    /// @brief  Allocates a block. Owning thread only.
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void *block = nullptr;
+        if (bytes > MAX_BLOCK || alignment > alignof(std::max_align_t))
+        {
+            block = upstream()->allocate(bytes, alignment);
+            add(mUpstream, 1);
+        }
+        else
+        {
+            const std::size_t index = sizeClass(bytes);
+            if (mFree[index] == nullptr)
+            {
+                reclaim();
+            }
+            if (mFree[index] != nullptr)
+            {
+                block = std::exchange(mFree[index], mFree[index]->next);
+            }
+            else
+            {
+                block = carve(MIN_BLOCK << index);
+            }
+        }
+        add(mAllocations, 1);
+        mRefs.fetch_add(1, std::memory_order_relaxed);
+        return block;
+    }
+
+    /// @brief  Frees a block, from any thread
+    void do_deallocate(void *block, std::size_t bytes, std::size_t alignment) override
+    {
+        if (bytes > MAX_BLOCK || alignment > alignof(std::max_align_t))
+        {
+            upstream()->deallocate(block, bytes, alignment);
+        }
+        else if (tOwned == this)
+        {
+            Free *entry = new (block) Free{ mFree[sizeClass(bytes)], 0 };
+            mFree[sizeClass(bytes)] = entry;
+        }
+        else
+        {
+            // Hand the block back to the owner, keeping its class with it
+            Free *entry = new (block) Free{ mRemote.load(std::memory_order_relaxed),
+                sizeClass(bytes) };
+            while (!mRemote.compare_exchange_weak(entry->next, entry,
+                std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+            mRemoteFrees.fetch_add(1, std::memory_order_relaxed);
+        }
+        release();
+    }
+
+    /// @brief  Arenas are only equal to themselves, as each frees only its
+    ///         own blocks
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    /// @brief  The number of size classes, doubling from MIN_BLOCK
+    static constexpr std::size_t CLASSES =
+        static_cast<std::size_t>(std::countr_zero(MAX_BLOCK / MIN_BLOCK)) + 1;
+
+    /// @brief  A free block, on a free list or the remote list
+    struct Free
+    {
+        /// @brief  The next free block
+        Free *next;
+        /// @brief  The block's size class, for blocks on the remote list
+        std::size_t sizeClass;
+    };
+
+    /// @brief  A chunk of blocks
+    struct alignas(std::max_align_t) Chunk
+    {
+        /// @brief  The chunk allocated before this one
+        Chunk *next;
+
+        /// @brief  The first byte after the header
+        std::byte *data()
+        {
+            return reinterpret_cast<std::byte *>(this + 1);
+        }
+    };
+
+    /// @brief  Creates the calling thread's arena, and releases it as the
+    ///         thread exits
+    struct Owner
+    {
+        Owner()
+            : arena(new ThreadArena())
+        {
+            tOwned = arena;
+        }
+
+        ~Owner()
+        {
+            // Any block freed from here on, even by this thread, is freed as
+            // though from another
+            tOwned = nullptr;
+            arena->release();
+        }
+
+        ThreadArena *arena;
+    };
+
+    /// @brief  Constructor, for Owner only
+    ThreadArena() = default;
+
+    /// @brief  Destructor, once the owner has exited and the last block has
+    ///         been freed
+    ~ThreadArena() override
+    {
+        while (mChunks != nullptr)
+        {
+            freeChunk(std::exchange(mChunks, mChunks->next));
+        }
+    }
+
+    /// @brief  The resource chunks and large blocks come from
+    static std::pmr::memory_resource *upstream()
+    {
+        return std::pmr::new_delete_resource();
+    }
+
+    /// @brief  The size class of a block
+    static std::size_t sizeClass(std::size_t bytes)
+    {
+        return static_cast<std::size_t>(
+            std::bit_width((std::max(bytes, MIN_BLOCK) - 1) / MIN_BLOCK));
+    }
+
+    /// @brief  Moves every block freed by other threads onto the free lists
+    void reclaim()
+    {
+        Free *entry = mRemote.exchange(nullptr, std::memory_order_acquire);
+        while (entry != nullptr)
+        {
+            Free *next = entry->next;
+            entry->next = mFree[entry->sizeClass];
+            mFree[entry->sizeClass] = entry;
+            entry = next;
+        }
+    }
+
+    /// @brief  Carves a new block from the current chunk, starting another
+    ///         once it is full
+    /// @param  size    The block size, a multiple of std::max_align_t
+    void *carve(std::size_t size)
+    {
+        if (mChunks == nullptr || mPosition + size > mChunks->data() + CHUNK_SIZE)
+        {
+            void *memory = upstream()->allocate(sizeof(Chunk) + CHUNK_SIZE,
+                alignof(Chunk));
+            add(mUpstream, 1);
+            mChunks = new (memory) Chunk{ mChunks };
+            mPosition = mChunks->data();
+        }
+        return std::exchange(mPosition, mPosition + size);
+    }
+
+    /// @brief  Returns a chunk to upstream
+    static void freeChunk(Chunk *chunk)
+    {
+        upstream()->deallocate(chunk, sizeof(Chunk) + CHUNK_SIZE, alignof(Chunk));
+    }
+
+    /// @brief  Drops a reference, destroying the arena with the last
+    void release()
+    {
+        if (mRefs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete this;
+        }
+    }
+
+    /// @brief  Adds to a counter written only by the owning thread
+    static void add(std::atomic<std::uint64_t> &counter, std::uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value,
+            std::memory_order_relaxed);
+    }
+
+    /// @brief  The arena owned by the calling thread, if any
+    static inline thread_local ThreadArena *tOwned = nullptr;
+
+    // The state used only by the owner comes first, then, on a line of its
+    // own, what other threads write as they free blocks.
+
+    /// @brief  The free blocks of each size class
+    Free *mFree[CLASSES] = {};
+    /// @brief  The chunks, newest first
+    Chunk *mChunks = nullptr;
+    /// @brief  The next free byte of the newest chunk
+    std::byte *mPosition = nullptr;
+    /// @brief  The counters written by the owner
+    std::atomic<std::uint64_t> mAllocations{ 0 };
+    std::atomic<std::uint64_t> mUpstream{ 0 };
+    std::atomic<std::uint64_t> mResets{ 0 };
+    /// @brief  Blocks freed by other threads, waiting for the owner
+    alignas(CACHE_LINE_SIZE) std::atomic<Free *> mRemote{ nullptr };
+    /// @brief  The number of blocks freed by other threads
+    std::atomic<std::uint64_t> mRemoteFrees{ 0 };
+    /// @brief  One reference for every live block, and one for the owner
+    std::atomic<std::size_t> mRefs{ 1 };
+};
@@ -0,0 +1,367 @@
+/**
+ * @file    thread-cache.h
+ *
+ * @brief   A cache of parked OS threads, and RecycledThread, a stand-in for
+ *          std::jthread that runs its function on one of them. Starting a
+ *          RecycledThread hands the function to a parked thread if there is
+ *          one, rather than creating and tearing down a thread for every run,
+ *          which dominates the cost of short jobs that are started and stopped
+ *          often.
+ *
+ *          Each run gets a fresh std::stop_source, so stopping one run never
+ *          affects the next, and stop callbacks registered on a run's token
+ *          behave exactly as with a std::jthread. A thread only returns to the
+ *          cache once its function has returned, and the cache keeps no more
+ *          than a set number parked, letting any others end.
+ *
+ *          Note that thread_local variables are not reset between runs on the
+ *          same thread, other than the thread's ThreadArena, which is reset
+ *          after each run if nothing allocated from it is still in use.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <stop_token>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "task.h"
+#include "thread-arena.h"
+
+/// @brief  Threads kept parked between runs
+class ThreadCache
+{
+public:
+    /// @brief  The default number of threads kept parked
+    static constexpr std::size_t DEFAULT_MAX_PARKED = 16;
+
+    /// @brief  Constructor
+    /// @param  maxParked   The most threads kept parked once idle
+    explicit ThreadCache(std::size_t maxParked = DEFAULT_MAX_PARKED)
+        : mMaxParked(maxParked)
+    {
+    }
+
+    /// @brief  Destructor, ending every parked thread. Any thread still
+    ///         running a job is joined once the job returns.
+    ~ThreadCache()
+    {
+        std::vector<std::unique_ptr<Slot>> slots;
+        std::vector<std::unique_ptr<Slot>> retired;
+        {
+            std::lock_guard lock(mMutex);
+            slots = std::move(mSlots);
+            retired = std::move(mRetired);
+        }
+        for (auto &slot : slots)
+        {
+            slot->thread.request_stop();
+        }
+        slots.clear();
+        retired.clear();
+    }
+
+    ThreadCache(const ThreadCache &) = delete;
+    ThreadCache &operator=(const ThreadCache &) = delete;
+
+    /// @brief  The cache shared by every RecycledThread
+    static ThreadCache &instance()
+    {
+        static ThreadCache cache;
+        return cache;
+    }
+
+    /// @brief  Runs a job on a parked thread, or on a new thread if none are
+    ///         parked
+    /// @param  job     The job
+    /// @param  done    Called once the job has returned and its thread has
+    ///                 parked again, so that a caller waiting on it and then
+    ///                 starting another job finds the same thread free
+    void run(Task job, Task done = Task())
+    {
+        std::vector<std::unique_ptr<Slot>> retired;
+        {
+            std::lock_guard lock(mMutex);
+            retired = std::move(mRetired);
+            if (!mIdle.empty())
+            {
+                Slot *slot = mIdle.back();
+                mIdle.pop_back();
+                slot->job = std::move(job);
+                slot->done = std::move(done);
+                slot->cv.notify_one();
+            }
+            else
+            {
+                auto slot = std::make_unique<Slot>();
+                slot->job = std::move(job);
+                slot->done = std::move(done);
+                Slot &entry = *slot;
+                mSlots.push_back(std::move(slot));
+                entry.thread = std::jthread(std::bind_front(&ThreadCache::loop, this),
+                    std::ref(entry));
+                ++mCreated;
+            }
+        }
+        // Threads that have left the cache are joined outside of the lock
+        retired.clear();
+    }
+
+    /// @brief  The number of threads parked
+    std::size_t parked() const
+    {
+        std::lock_guard lock(mMutex);
+        return mIdle.size();
+    }
+
+    /// @brief  The number of threads ever created
+    std::size_t created() const
+    {
+        std::lock_guard lock(mMutex);
+        return mCreated;
+    }
+
+private:
+    /// @brief  A cached thread
+    struct Slot
+    {
+        /// @brief  Signals a new job, or the cache ending
+        std::condition_variable_any cv;
+        /// @brief  The job to run next, protected by mMutex
+        Task job;
+        /// @brief  Called after the job, protected by mMutex
+        Task done;
+        /// @brief  The thread itself
+        std::jthread thread;
+    };
+
+    /// @brief  The loop of each cached thread
+    /// @param  token   Stopped as the cache is destroyed
+    /// @param  slot    The thread's slot
+    void loop(std::stop_token token, Slot &slot)
+    {
+        std::unique_lock lock(mMutex);
+        while (slot.cv.wait(lock, token, [&slot]() { return static_cast<bool>(slot.job); }))
+        {
+            Task job = std::move(slot.job);
+            Task done = std::move(slot.done);
+            lock.unlock();
+            job();
+            // Whatever the job owned is released before the thread is reused,
+            // and with it, if nothing else is still using it, everything the
+            // job allocated from the thread's arena, in bulk
+            job.reset();
+            ThreadArena::local().reset();
+            lock.lock();
+            if (token.stop_requested() || mIdle.size() >= mMaxParked)
+            {
+                // Leave the cache, to be joined by the next run()
+                for (auto it = mSlots.begin(); it != mSlots.end(); ++it)
+                {
+                    if (it->get() == &slot)
+                    {
+                        mRetired.push_back(std::move(*it));
+                        mSlots.erase(it);
+                        break;
+                    }
+                }
+                lock.unlock();
+                finish(done);
+                return;
+            }
+            mIdle.push_back(&slot);
+            lock.unlock();
+            finish(done);
+            lock.lock();
+        }
+    }
+
+    /// @brief  Calls a job's completion, if it has one
+    static void finish(Task &done)
+    {
+        if (done)
+        {
+            done();
+            done.reset();
+        }
+    }
+
+    /// @brief  The most threads kept parked
+    const std::size_t mMaxParked;
+    /// @brief  Mutex protecting everything below
+    mutable std::mutex mMutex;
+    /// @brief  Every thread in the cache, parked or running
+    std::vector<std::unique_ptr<Slot>> mSlots;
+    /// @brief  The parked threads, most recently used last
+    std::vector<Slot *> mIdle;
+    /// @brief  Threads that have left the cache, waiting to be joined
+    std::vector<std::unique_ptr<Slot>> mRetired;
+    /// @brief  The number of threads ever created
+    std::size_t mCreated = 0;
+};
+
+/// @brief  A std::jthread look-alike whose function runs on a thread from the
+///         ThreadCache. As with std::jthread, the function may take a
+///         std::stop_token first, and the destructor requests a stop and
+///         joins.
+class RecycledThread
+{
+public:
+    /// @brief  Constructor, with no run
+    RecycledThread() noexcept = default;
+
+    /// @brief  Constructor, starting a run
+    /// @param  function    The function, given the run's stop token first if
+    ///                     it accepts one
+    /// @param  args        Any further arguments, copied as std::jthread does
+    template<typename F, typename... Args>
+        requires (!std::is_same_v<std::remove_cvref_t<F>, RecycledThread>)
+    explicit RecycledThread(F &&function, Args &&...args)
+        : mRun(std::allocate_shared<Run>(
+            std::pmr::polymorphic_allocator<Run>(&ThreadArena::local())))
+    {
+        ThreadCache::instance().run(Task([run = mRun,
+            function = std::decay_t<F>(std::forward<F>(function)),
+            args = std::make_tuple(std::decay_t<Args>(std::forward<Args>(args))...)]() mutable {
+            std::apply([&](auto &...unpacked) {
+                if constexpr (std::is_invocable_v<std::decay_t<F> &, std::stop_token,
+                    std::decay_t<Args> &...>)
+                {
+                    std::invoke(function, run->source.get_token(), unpacked...);
+                }
+                else
+                {
+                    std::invoke(function, unpacked...);
+                }
+            }, args);
+        }), Task([run = mRun]() {
+            run->finish();
+        }));
+    }
+
+    /// @brief  Destructor, requesting a stop and joining, as std::jthread
+    ~RecycledThread()
+    {
+        release();
+    }
+
+    RecycledThread(RecycledThread &&other) noexcept = default;
+
+    /// @brief  Move assignment, first requesting a stop of any current run
+    ///         and joining it, as std::jthread
+    RecycledThread &operator=(RecycledThread &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            mRun = std::move(other.mRun);
+            mJoinable = std::exchange(other.mJoinable, false);
+        }
+        return *this;
+    }
+
+    /// @brief  Whether there is a run that has not been joined
+    bool joinable() const noexcept
+    {
+        return mRun && mJoinable;
+    }
+
+    /// @brief  Waits for the run's function to return. The thread itself is
+    ///         returned to the cache rather than ended.
+    /// @throws std::system_error if not joinable, as std::thread::join()
+    void join()
+    {
+        if (!joinable())
+        {
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+        }
+        std::unique_lock lock(mRun->mutex);
+        mRun->cv.wait(lock, [this]() { return mRun->finished; });
+        mJoinable = false;
+    }
+
+    /// @brief  Waits for the run's function to return, giving up at the
+    ///         deadline, which std::jthread has no means of doing
+    /// @returns    True if the run finished, and so has been joined, in time
+    /// @throws std::system_error if not joinable, as join()
+    template<typename Clock, typename Duration>
+    bool try_join_until(const std::chrono::time_point<Clock, Duration> &deadline)
+    {
+        if (!joinable())
+        {
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+        }
+        std::unique_lock lock(mRun->mutex);
+        if (!mRun->cv.wait_until(lock, deadline, [this]() { return mRun->finished; }))
+        {
+            return false;
+        }
+        mJoinable = false;
+        return true;
+    }
+
+    /// @brief  The stop token of the current or last run, which, as with
+    ///         std::jthread, remains available after joining
+    std::stop_token get_stop_token() const noexcept
+    {
+        return mRun ? mRun->source.get_token() : std::stop_token();
+    }
+
+    /// @brief  Requests a stop of the current run
+    /// @returns    True if this call made the request
+    bool request_stop() noexcept
+    {
+        return mRun ? mRun->source.request_stop() : false;
+    }
+
+private:
+    /// @brief  The state of a single run, shared with the job
+    struct Run
+    {
+        /// @brief  Marks the function as having returned
+        void finish()
+        {
+            std::lock_guard lock(mutex);
+            finished = true;
+            cv.notify_all();
+        }
+
+        /// @brief  The run's own stop source
+        std::stop_source source;
+        /// @brief  Mutex protecting finished
+        std::mutex mutex;
+        /// @brief  Signalled once the function has returned
+        std::condition_variable cv;
+        /// @brief  Whether the function has returned
+        bool finished = false;
+    };
+
+    /// @brief  Requests a stop of any current run and joins it
+    void release()
+    {
+        if (joinable())
+        {
+            request_stop();
+            join();
+        }
+    }
+
+    /// @brief  The current or last run
+    std::shared_ptr<Run> mRun;
+    /// @brief  Whether the run has yet to be joined
+    bool mJoinable = true;
+};
@@ -0,0 +1,498 @@
+/**
+ * @file    thread-pool.h
+ *
+ * @brief   A general purpose thread pool, running closures rather than the
+ *          integer IDs of example 7. Work is queued as Task objects, by value,
+ *          on a TaskQueue shared by every worker, and submit() hands back a
+ *          TaskFuture for the result. Closures small enough to be held inline
+ *          by a Task are queued and run without any allocation.
+ *
+ *          shutdown() stops the pool accepting work and has every worker help
+ *          to drain the queue, giving up at a deadline and handing back
+ *          whatever did not run.
+ *
+ *          The pool may also be elastic, given a minimum and maximum number of
+ *          workers. A controller thread then adds workers when the queue backs
+ *          up, and retires workers that have been idle for a while through a
+ *          stop token of their own. A retired worker's thread is not ended,
+ *          but parked, and is the first to be reused when the pool grows
+ *          again, so that bursts of work do not pay for creating threads.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cpu.h"
+#include "fixed-array.h"
+#include "interruptible-sleep.h"
+#include "task.h"
+#include "task-queue.h"
+
+/// @brief  A pool of std::jthreads running submitted tasks
+class ThreadPool
+{
+public:
+    /// @brief  The clock used for deadlines and the elastic limits
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief  The largest number of tasks a worker takes from the queue at
+    ///         once
+    static constexpr std::size_t BATCH = 16;
+
+    /// @brief  The limits of an elastic pool. The gap between adding a
+    ///         worker as soon as the queue backs up, and only retiring one
+    ///         after a long idle spell, gives the hysteresis that stops the
+    ///         pool from growing and shrinking on every small burst.
+    struct Limits
+    {
+        /// @brief  The number of workers always kept running
+        std::size_t minThreads = 1;
+        /// @brief  The most workers ever running at once
+        std::size_t maxThreads = 1;
+        /// @brief  Grow once there are more queued tasks than this for each
+        ///         running worker
+        std::size_t growDepth = 4;
+        /// @brief  Or once the queue has not been empty for this long
+        std::chrono::milliseconds growWait{ 20 };
+        /// @brief  Retire a worker once it has been idle for this long, and
+        ///         the pool has not grown within this time
+        std::chrono::milliseconds idleTimeout{ 1000 };
+        /// @brief  How often the controller checks the queue
+        std::chrono::milliseconds period{ 5 };
+    };
+
+    /// @brief  Constructor, starting a fixed number of workers
+    /// @param  threads The number of workers, by default one per core
+    explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency())
+        : ThreadPool(Limits{ threads, threads })
+    {
+    }
+
+    /// @brief  Constructor, starting an elastic pool with the minimum number
+    ///         of workers, or a fixed pool if the minimum and maximum match
+    /// @param  limits  The limits of the pool
+    explicit ThreadPool(const Limits &limits)
+        : mLimits(sanitise(limits))
+        , mWorkers(mLimits.maxThreads)
+    {
+        {
+            std::lock_guard lock(mParkMutex);
+            for (std::size_t i = 0; i < mLimits.minThreads; ++i)
+            {
+                activate();
+            }
+        }
+        if (mLimits.maxThreads > mLimits.minThreads)
+        {
+            mController = std::jthread(std::bind_front(&ThreadPool::controller, this));
+        }
+    }
+
+    /// @brief  Destructor. Unless shutdown() has already been called, every
+    ///         task already queued is still run, then the workers are joined.
+    ~ThreadPool()
+    {
+        shutdown(Clock::time_point::max());
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// @brief  Queues a task to be run. The task must not throw.
+    /// @param  task    The task
+    /// @throws std::runtime_error if the pool has been shut down
+    void push(Task task)
+    {
+        if (!mQueue.push(std::move(task)))
+        {
+            throw std::runtime_error("ThreadPool: the pool has been shut down");
+        }
+    }
+
+    /// @brief  Queues a callable to be run, with no way to collect a result.
+    ///         Anything it throws is discarded.
+    /// @param  callable    The callable, taking no arguments
+    template<typename F>
+    void post(F &&callable)
+    {
+        push(Task([fn = std::forward<F>(callable)]() mutable {
+            try
+            {
+                std::invoke(fn);
+            }
+            catch (...)
+            {
+            }
+        }));
+    }
+
+    /// @brief  Queues a callable to be run, returning a future for its result.
+    ///         An exception thrown by the callable is rethrown by get().
+    /// @param  callable    The callable, taking no arguments
+    /// @returns    The future, which waits for the task if destroyed first
+    template<typename F>
+    [[nodiscard]] TaskFuture<std::invoke_result_t<std::decay_t<F> &>> submit(F &&callable)
+    {
+        return TaskFuture<std::invoke_result_t<std::decay_t<F> &>>(
+            *this, std::forward<F>(callable));
+    }
+
+    /// @brief  Shuts the pool down, refusing any further work and having
+    ///         every worker drain the queue in parallel. If the queue is not
+    ///         empty by the deadline, the workers are stopped once their
+    ///         current task is done, and anything not yet run is returned.
+    ///         Returns once every worker has been joined. Calling this again
+    ///         does nothing.
+    /// @param  deadline    When to give up on the tasks not yet run
+    /// @returns    The abandoned tasks, in the order they were queued, which
+    ///             may be run elsewhere. Destroying the Task of a submit()
+    ///             gives its future a broken_promise error.
+    std::vector<Task> shutdown(Clock::time_point deadline)
+    {
+        std::lock_guard shutdownLock(mShutdownMutex);
+        // The pool must not change size from here on, so the controller is
+        // stopped and joined before anything reads mWorkers without the lock
+        mController = std::jthread();
+        if (mWorkers.empty())
+        {
+            return {};
+        }
+
+        // Workers leave once they see the closed queue is empty, and any
+        // parked workers leave straight away
+        mQueue.close();
+        {
+            std::lock_guard lock(mParkMutex);
+            mClosing = true;
+        }
+        mParkCv.notify_all();
+        bool drained = false;
+        {
+            std::unique_lock lock(mLiveMutex);
+            const auto allLeft = [&]() { return mLive == 0; };
+            if (deadline == Clock::time_point::max())
+            {
+                mLiveCv.wait(lock, allLeft);
+                drained = true;
+            }
+            else
+            {
+                drained = mLiveCv.wait_until(lock, deadline, allLeft);
+            }
+        }
+        if (!drained)
+        {
+            for (auto &worker : mWorkers)
+            {
+                worker.shift.request_stop();
+                worker.thread.request_stop();
+            }
+        }
+        mWorkers.clear();
+
+        // Tasks already taken from the queue are handed back by the workers
+        // first, as they were queued before anything still in the queue
+        std::vector<Task> abandoned = std::move(mAbandoned);
+        std::vector<Task> remaining = mQueue.takeAll();
+        abandoned.insert(abandoned.end(), std::make_move_iterator(remaining.begin()),
+            std::make_move_iterator(remaining.end()));
+        return abandoned;
+    }
+
+    /// @brief  Shuts the pool down, as above, with a deadline relative to now
+    /// @param  timeout     The time allowed for draining the queue
+    /// @returns    The abandoned tasks
+    template<typename Rep, typename Period>
+    std::vector<Task> shutdown(std::chrono::duration<Rep, Period> timeout)
+    {
+        return shutdown(Clock::now() + timeout);
+    }
+
+    /// @brief  The number of workers currently running tasks
+    std::size_t size() const
+    {
+        std::lock_guard lock(mParkMutex);
+        return static_cast<std::size_t>(std::count_if(mWorkers.begin(),
+            mWorkers.end(), [](const Worker &worker) { return worker.active; }));
+    }
+
+    /// @brief  The number of threads created, including those parked
+    std::size_t threads() const
+    {
+        std::lock_guard lock(mParkMutex);
+        return mWorkers.size();
+    }
+
+    /// @brief  The number of tasks waiting for a worker
+    std::size_t pending() const
+    {
+        return mQueue.size();
+    }
+
+    /// @brief  Runs queued tasks on the calling thread until the given token
+    ///         is stopped, waiting whilst the queue is empty. A thread that
+    ///         would otherwise block on work it has queued, including one of
+    ///         the pool's own workers, helps to run it instead. Tasks are
+    ///         taken one at a time, so that the caller can return promptly.
+    /// @param  until   Stopped once the caller no longer needs to wait
+    /// @returns    The number of tasks run, returning early once the pool is
+    ///             shut down and the queue empty
+    std::size_t helpUntil(const std::stop_token &until)
+    {
+        std::size_t run = 0;
+        Task task;
+        while (mQueue.popUpTo(std::span<Task>(&task, 1), until, true) > 0)
+        {
+            task();
+            task.reset();
+            ++run;
+        }
+        return run;
+    }
+
+private:
+    /// @brief  A worker thread, and what the pool knows of it. Each is on
+    ///         cache lines of its own, as idleSince is written by its worker
+    ///         around every take from the queue.
+    struct alignas(CACHE_LINE_SIZE) Worker
+    {
+        /// @brief  Whether the worker is running tasks rather than parked,
+        ///         protected by mParkMutex
+        bool active = false;
+        /// @brief  Retires the worker, replaced each time it is activated,
+        ///         protected by mParkMutex
+        std::stop_source shift;
+        /// @brief  When the worker last started waiting for work, in clock
+        ///         ticks, or zero whilst it is running tasks
+        std::atomic<Clock::rep> idleSince{ 0 };
+        /// @brief  The thread, declared last so that it is joined before the
+        ///         rest is destroyed
+        std::jthread thread;
+    };
+
+    /// @brief  Corrects any inconsistent limits
+    static Limits sanitise(Limits limits)
+    {
+        limits.minThreads = std::max<std::size_t>(limits.minThreads, 1);
+        limits.maxThreads = std::max(limits.maxThreads, limits.minThreads);
+        limits.growDepth = std::max<std::size_t>(limits.growDepth, 1);
+        limits.period = std::max(limits.period, std::chrono::milliseconds(1));
+        return limits;
+    }
+
+    /// @brief  Puts another worker to work, reusing a parked one if there is
+    ///         one, or else creating a new thread. Must be called with
+    ///         mParkMutex held.
+    void activate()
+    {
+        for (auto &worker : mWorkers)
+        {
+            if (!worker.active)
+            {
+                worker.active = true;
+                worker.shift = std::stop_source();
+                mParkCv.notify_all();
+                return;
+            }
+        }
+        Worker &worker = mWorkers.emplace_back();
+        worker.active = true;
+        {
+            std::lock_guard lock(mLiveMutex);
+            ++mLive;
+        }
+        worker.thread = std::jthread(std::bind_front(&ThreadPool::worker, this),
+            std::ref(worker));
+    }
+
+    /// @brief  The controller thread, resizing an elastic pool
+    /// @param  token   The stop token for this thread
+    void controller(std::stop_token token)
+    {
+        // When the queue was last seen to become non-empty
+        Clock::time_point backlogSince;
+        // When the pool last grew, so that it does not shrink straight after
+        Clock::time_point lastGrown = Clock::now();
+        while (interruptibleSleep(token, mLimits.period))
+        {
+            const Clock::time_point now = Clock::now();
+            const std::size_t depth = mQueue.size();
+            if (depth == 0)
+            {
+                backlogSince = Clock::time_point();
+            }
+            else if (backlogSince == Clock::time_point())
+            {
+                backlogSince = now;
+            }
+
+            std::lock_guard lock(mParkMutex);
+            const std::size_t active = static_cast<std::size_t>(std::count_if(
+                mWorkers.begin(), mWorkers.end(),
+                [](const Worker &worker) { return worker.active; }));
+
+            // Grow enough to bring the depth back under the threshold, or by
+            // one if the backlog has simply been waiting too long
+            std::size_t wanted = active;
+            if (depth > active * mLimits.growDepth)
+            {
+                wanted = (depth + mLimits.growDepth - 1) / mLimits.growDepth;
+            }
+            else if (depth > 0 && now - backlogSince >= mLimits.growWait)
+            {
+                wanted = active + 1;
+            }
+            wanted = std::min(wanted, mLimits.maxThreads);
+            if (wanted > active)
+            {
+                for (std::size_t i = active; i < wanted; ++i)
+                {
+                    activate();
+                }
+                lastGrown = now;
+                backlogSince = now;
+                continue;
+            }
+
+            // Retire one long idle worker at a time, and only with no backlog
+            if (depth > 0 || active <= mLimits.minThreads ||
+                now - lastGrown < mLimits.idleTimeout)
+            {
+                continue;
+            }
+            const Clock::rep idleBefore = (now - mLimits.idleTimeout).time_since_epoch().count();
+            for (std::size_t i = mWorkers.size(); i-- > 0;)
+            {
+                Worker &worker = mWorkers[i];
+                const Clock::rep idleSince = worker.idleSince.load(std::memory_order_relaxed);
+                if (worker.active && idleSince != 0 && idleSince <= idleBefore)
+                {
+                    worker.active = false;
+                    worker.shift.request_stop();
+                    break;
+                }
+            }
+        }
+    }
+
+    /// @brief  A worker thread, running tasks whilst active and parking when
+    ///         retired, until the pool is shut down and the queue is empty. A
+    ///         stop is only requested on the thread once a shutdown deadline
+    ///         has passed, and abandons any work left.
+    /// @param  token   The stop token for this thread
+    /// @param  self    The pool's record of this worker
+    void worker(std::stop_token token, Worker &self)
+    {
+        std::vector<Task> batch(BATCH);
+        while (true)
+        {
+            std::stop_token shift;
+            {
+                std::unique_lock lock(mParkMutex);
+                if (!mParkCv.wait(lock, token, [&]() { return self.active || mClosing; }) ||
+                    !self.active)
+                {
+                    break;
+                }
+                shift = self.shift.get_token();
+            }
+
+            runTasks(token, shift, self, batch);
+            if (token.stop_requested() || mQueue.closed())
+            {
+                break;
+            }
+        }
+
+        std::lock_guard lock(mLiveMutex);
+        if (--mLive == 0)
+        {
+            mLiveCv.notify_all();
+        }
+    }
+
+    /// @brief  Runs tasks until the worker is retired, or the queue closed
+    ///         and empty
+    /// @param  token   The stop token for the thread, abandoning work
+    /// @param  shift   The stop token for this activation, retiring it
+    /// @param  self    The pool's record of this worker
+    /// @param  batch   Storage for the tasks taken
+    void runTasks(const std::stop_token &token, const std::stop_token &shift,
+        Worker &self, std::vector<Task> &batch)
+    {
+        std::size_t count = 0;
+        while (true)
+        {
+            self.idleSince.store(Clock::now().time_since_epoch().count(),
+                std::memory_order_relaxed);
+            count = mQueue.popUpTo(batch, shift, true);
+            self.idleSince.store(0, std::memory_order_relaxed);
+            if (count == 0)
+            {
+                return;
+            }
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (token.stop_requested())
+                {
+                    // Hand back the rest of the batch rather than overrunning
+                    // the deadline by up to a whole batch of tasks
+                    std::lock_guard lock(mAbandonedMutex);
+                    std::move(batch.begin() + i, batch.begin() + count,
+                        std::back_inserter(mAbandoned));
+                    return;
+                }
+                batch[i]();
+                batch[i].reset();
+            }
+        }
+    }
+
+    /// @brief  The limits of the pool
+    const Limits mLimits;
+    /// @brief  The queued tasks
+    TaskQueue<Task> mQueue;
+    /// @brief  Serialises calls to shutdown()
+    std::mutex mShutdownMutex;
+    /// @brief  Mutex protecting the workers' activity and mClosing
+    mutable std::mutex mParkMutex;
+    /// @brief  Wakes parked workers when activated or shutting down
+    std::condition_variable_any mParkCv;
+    /// @brief  Set once shutting down, so parked workers leave
+    bool mClosing = false;
+    /// @brief  Mutex protecting mLive
+    std::mutex mLiveMutex;
+    /// @brief  Signalled when the last worker leaves
+    std::condition_variable mLiveCv;
+    /// @brief  The number of worker threads still running
+    std::size_t mLive = 0;
+    /// @brief  Mutex protecting mAbandoned
+    std::mutex mAbandonedMutex;
+    /// @brief  Tasks taken from the queue but not run, once stopped
+    std::vector<Task> mAbandoned;
+    /// @brief  Every worker created, running or parked, side by side in one
+    ///         block sized for the most workers, as a running worker may not
+    ///         move. Declared after everything the workers use, so that they
+    ///         are joined first.
+    FixedArray<Worker> mWorkers;
+    /// @brief  Resizes an elastic pool, stopped before anything else
+    std::jthread mController;
+};
@@ -0,0 +1,334 @@
+/**
+ * @file    timer-wheel.h
+ *
+ * @brief   A hierarchical timer wheel, running many periodic jobs on a small
+ *          pool of std::jthreads rather than giving each job a thread of its
+ *          own that spends almost all of its time asleep.
+ *
+ *          One ticker thread advances the wheel, and hands each job that is
+ *          due to a pool of workers through a TaskQueue. Jobs are cancelled
+ *          with their own std::stop_token, exactly as a dedicated thread would
+ *          be, and a cancelled job is never run again.
+ *
+ *          Cancelling is lazy: the stop request itself does no work on the
+ *          wheel, and the job stays in its slot, callback and all, until it
+ *          next falls due, up to one period later. Only then is it dropped and
+ *          freed, and until then it is still counted by size(). A job with a
+ *          long period, or many jobs cancelled at once, hold their memory for
+ *          that long.
+ *
+ *          The wheel has LEVELS levels of SLOTS slots. Level 0 holds the jobs
+ *          due within SLOTS ticks, one slot per tick, and each level above it
+ *          covers SLOTS times the span of the one below. When the lower level
+ *          wraps around, the next slot of the level above is cascaded down,
+ *          so adding and running a job are constant time however many jobs
+ *          there are.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "task-queue.h"
+
+/// @brief  Runs periodic jobs from a hierarchical timer wheel
+class TimerWheel
+{
+public:
+    /// @brief  The clock the wheel is driven by
+    using Clock = std::chrono::steady_clock;
+    /// @brief  A job to be run each period
+    using Callback = std::function<void(void)>;
+
+    /// @brief  The number of slots in each level, a power of two
+    static constexpr std::size_t SLOTS = 64;
+    /// @brief  The number of levels. With 1ms ticks, four levels cover
+    ///         periods of up to 64^4 ms, a little over four and a half hours,
+    ///         and longer periods are cascaded more than once.
+    static constexpr std::size_t LEVELS = 4;
+
+    /// @brief  Constructor, starting the ticker and the workers
+    /// @param  workers The number of threads that run the jobs
+    /// @param  tick    The resolution of the wheel
+    explicit TimerWheel(std::size_t workers = 1,
+        std::chrono::milliseconds tick = std::chrono::milliseconds(1))
+        : mTick(tick.count() > 0 ? tick : std::chrono::milliseconds(1))
+        , mStart(Clock::now())
+    {
+        for (std::size_t i = 0; i < (workers > 0 ? workers : 1); ++i)
+        {
+            mWorkers.emplace_back(std::bind_front(&TimerWheel::worker, this));
+        }
+        mTicker = std::jthread(std::bind_front(&TimerWheel::ticker, this));
+    }
+
+    /// @brief  Destructor. The ticker and workers are stopped and joined, and
+    ///         any jobs still waiting are discarded without being run.
+    ~TimerWheel()
+    {
+        mTicker.request_stop();
+        mTicker.join();
+        for (auto &worker : mWorkers)
+        {
+            worker.request_stop();
+        }
+        mWorkers.clear();
+    }
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    /// @brief  Adds a job, first run one period from now and then every
+    ///         period after that, until a stop is requested on its token.
+    ///         If a run overruns by a whole period, the missed runs are
+    ///         skipped rather than run back to back. A cancelled job is
+    ///         removed from the wheel when it next falls due.
+    /// @param  period      The time between runs, rounded up to whole ticks
+    /// @param  callback    The job itself
+    /// @param  token       Cancels the job when a stop is requested
+    void schedule(std::chrono::milliseconds period, Callback callback,
+        std::stop_token token)
+    {
+        auto timer = std::make_unique<Timer>();
+        timer->period = std::max<std::uint64_t>(1,
+            (period.count() + mTick.count() - 1) / mTick.count());
+        timer->callback = std::move(callback);
+        timer->token = std::move(token);
+        {
+            std::lock_guard lock(mMutex);
+            // The ticker stops advancing while the wheel is empty, so the
+            // wheel is first brought up to the clock, which is safe as there
+            // is nothing on it to skip past. Otherwise the ticker may lag
+            // the clock slightly, and the period runs from the clock.
+            const std::uint64_t now = currentTick();
+            if (mCount == 0)
+            {
+                mCurrent = std::max(mCurrent, now);
+            }
+            timer->expiry = std::max(mCurrent, now) + timer->period;
+            insert(std::move(timer), mCurrent + 1);
+            ++mCount;
+        }
+        mCv.notify_one();
+    }
+
+    /// @brief  The number of jobs that have been scheduled and not yet been
+    ///         seen to be cancelled, which happens when each next falls due
+    std::size_t size() const
+    {
+        std::lock_guard lock(mMutex);
+        return mCount;
+    }
+
+private:
+    /// @brief  A single scheduled job
+    struct Timer
+    {
+        /// @brief  The tick at which the job is next due
+        std::uint64_t expiry = 0;
+        /// @brief  The number of ticks between runs
+        std::uint64_t period = 1;
+        /// @brief  The job itself
+        Callback callback;
+        /// @brief  Cancels the job
+        std::stop_token token;
+    };
+
+    /// @brief  The jobs within a single slot
+    using Slot = std::vector<std::unique_ptr<Timer>>;
+
+    /// @brief  The number of bits of the tick used by each level
+    static constexpr unsigned SLOT_BITS = std::countr_zero(SLOTS);
+    static_assert((SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of two");
+
+    /// @brief  The tick the clock has reached, which mCurrent trails behind
+    std::uint64_t currentTick() const
+    {
+        return static_cast<std::uint64_t>((Clock::now() - mStart) / mTick);
+    }
+
+    /// @brief  Places a job in the slot for its expiry. Must be called with
+    ///         mMutex held.
+    /// @param  timer       The job
+    /// @param  earliest    The first tick still to be processed, where
+    ///                     anything already due is placed
+    void insert(std::unique_ptr<Timer> timer, std::uint64_t earliest)
+    {
+        const std::uint64_t expiry = std::max(timer->expiry, earliest);
+        const std::uint64_t delta = expiry - mCurrent;
+        for (std::size_t level = 0; level < LEVELS; ++level)
+        {
+            const unsigned shift = static_cast<unsigned>(SLOT_BITS * level);
+            if (level + 1 == LEVELS || delta < (std::uint64_t{ 1 } << (shift + SLOT_BITS)))
+            {
+                // Beyond the top level, the job is placed as far ahead as the
+                // wheel reaches, and simply cascaded again when it comes round
+                const std::uint64_t reach = mCurrent +
+                    (std::uint64_t{ 1 } << (shift + SLOT_BITS)) - 1;
+                const std::uint64_t at = std::min(expiry, reach);
+                mWheel[level][(at >> shift) & (SLOTS - 1)].push_back(std::move(timer));
+                return;
+            }
+        }
+    }
+
+    /// @brief  Moves every job in a slot back through insert(), so that each
+    ///         drops to a lower level now that it is nearer its expiry
+    /// @param  level   The level to cascade from
+    void cascade(std::size_t level)
+    {
+        const unsigned shift = static_cast<unsigned>(SLOT_BITS * level);
+        Slot slot = std::move(mWheel[level][(mCurrent >> shift) & (SLOTS - 1)]);
+        mWheel[level][(mCurrent >> shift) & (SLOTS - 1)].clear();
+        for (auto &timer : slot)
+        {
+            // The current tick's own slot is still to be processed
+            insert(std::move(timer), mCurrent);
+        }
+    }
+
+    /// @brief  Advances the wheel by one tick, collecting the jobs now due.
+    ///         Must be called with mMutex held.
+    /// @param  due     Collects the jobs that are due
+    void advance(std::vector<std::unique_ptr<Timer>> &due)
+    {
+        ++mCurrent;
+        for (std::size_t level = 1; level < LEVELS; ++level)
+        {
+            const unsigned shift = static_cast<unsigned>(SLOT_BITS * level);
+            if ((mCurrent & ((std::uint64_t{ 1 } << shift) - 1)) != 0)
+            {
+                break;
+            }
+            cascade(level);
+        }
+
+        Slot &slot = mWheel[0][mCurrent & (SLOTS - 1)];
+        for (auto &timer : slot)
+        {
+            if (timer->expiry > mCurrent)
+            {
+                // Placed early as it was beyond the reach of the wheel
+                insert(std::move(timer), mCurrent + 1);
+            }
+            else
+            {
+                due.push_back(std::move(timer));
+            }
+        }
+        slot.clear();
+    }
+
+    /// @brief  The ticker thread, advancing the wheel in time with the clock
+    ///         and handing the jobs due to the workers
+    /// @param  token   The stop token for this thread
+    void ticker(std::stop_token token)
+    {
+        std::vector<std::unique_ptr<Timer>> due;
+        while (!token.stop_requested())
+        {
+            {
+                std::unique_lock lock(mMutex);
+                // With nothing scheduled there is no reason to tick, so wait
+                // for a job to be added, or to be stopped
+                if (!mCv.wait(lock, token, [&]() { return mCount > 0; }))
+                {
+                    break;
+                }
+                const auto next = mStart + mTick * (mCurrent + 1);
+                mCv.wait_until(lock, token, next, [&]() { return false; });
+
+                // Catch up on every tick that has passed, so no job is lost
+                // if the ticker was held up
+                const auto now = Clock::now();
+                while (mStart + mTick * (mCurrent + 1) <= now)
+                {
+                    advance(due);
+                }
+            }
+            if (!due.empty())
+            {
+                mDue.pushBulk(std::span(due));
+                due.clear();
+            }
+        }
+    }
+
+    /// @brief  A worker thread, running the jobs handed over by the ticker
+    /// @param  token   The stop token for this thread
+    void worker(std::stop_token token)
+    {
+        std::vector<std::unique_ptr<Timer>> batch(16);
+        std::size_t count = 0;
+        while ((count = mDue.popUpTo(batch, token, true)) > 0)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                run(std::move(batch[i]));
+            }
+        }
+    }
+
+    /// @brief  Runs a job, then schedules its next run if it has not been
+    ///         cancelled
+    /// @param  timer   The job
+    void run(std::unique_ptr<Timer> timer)
+    {
+        if (!timer->token.stop_requested())
+        {
+            timer->callback();
+        }
+
+        std::lock_guard lock(mMutex);
+        if (timer->token.stop_requested())
+        {
+            --mCount;
+            return;
+        }
+        timer->expiry += timer->period;
+        if (timer->expiry <= mCurrent)
+        {
+            timer->expiry += (mCurrent - timer->expiry) / timer->period *
+                timer->period + timer->period;
+        }
+        insert(std::move(timer), mCurrent + 1);
+    }
+
+    /// @brief  The length of a tick
+    const std::chrono::milliseconds mTick;
+    /// @brief  The time of tick zero
+    const Clock::time_point mStart;
+    /// @brief  Mutex protecting the wheel, mCurrent and mCount
+    mutable std::mutex mMutex;
+    /// @brief  Wakes the ticker when a job is added to an empty wheel
+    std::condition_variable_any mCv;
+    /// @brief  The slots of each level
+    std::array<std::array<Slot, SLOTS>, LEVELS> mWheel;
+    /// @brief  The last tick processed
+    std::uint64_t mCurrent = 0;
+    /// @brief  The number of live jobs, in the wheel or running
+    std::size_t mCount = 0;
+    /// @brief  Jobs that are due, waiting for a worker
+    TaskQueue<std::unique_ptr<Timer>> mDue;
+    /// @brief  The threads that run the jobs
+    std::vector<std::jthread> mWorkers;
+    /// @brief  The thread that advances the wheel
+    std::jthread mTicker;
+};
@@ -0,0 +1,348 @@
+/**
+ * @file    trace.h
+ *
+ * @brief   Opt-in tracing of thread lifecycle events, such as a thread
+ *          starting and ending, a stop being requested, a stop_callback
+ *          running or a join completing, saved in the Chrome trace event
+ *          format, which chrome://tracing and the Perfetto UI both open.
+ *
+ *          Tracing is compiled in only when THREAD_TRACE is defined. Otherwise
+ *          every TRACE macro expands to nothing, its arguments are never
+ *          evaluated, and the examples are built exactly as without it.
+ *
+ *          Once compiled in, each thread records its events into a buffer of
+ *          its own, created when it records its first, so that recording
+ *          never takes a lock or allocates. Each event is stamped with the
+ *          processor's time stamp counter where there is one, which a read
+ *          costs a few nanoseconds, converted to real time only when saved.
+ *          A full buffer drops any further events, counting how many, rather
+ *          than overwriting the earliest, so that the events kept for a
+ *          thread are always those from its start. The buffers outlive their
+ *          threads, so that a trace may be saved once they have all ended.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+
+#if defined(THREAD_TRACE)
+/// @brief  Records an instant event
+#define TRACE(name)                 Trace::instant(name)
+/// @brief  Records an instant event with a value, such as a task's ID
+#define TRACE_VALUE(name, value)    Trace::instant(name, static_cast<std::int64_t>(value))
+/// @brief  Records the start of a span, and its end as the enclosing scope ends
+#define TRACE_SCOPE(name)           const TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+/// @brief  Names the calling thread in the trace
+#define TRACE_THREAD(name)          Trace::nameThread(name)
+/// @brief  Saves the trace to a file as the program exits, after every
+///         std::jthread in main has been joined
+#define TRACE_SAVE_ON_EXIT(path)    static const TraceSaver traceSaver(path)
+#else
+#define TRACE(name)                 ((void)0)
+#define TRACE_VALUE(name, value)    ((void)0)
+#define TRACE_SCOPE(name)           ((void)0)
+#define TRACE_THREAD(name)          ((void)0)
+#define TRACE_SAVE_ON_EXIT(path)    ((void)0)
+#endif
+
+#define TRACE_CONCAT_INNER(a, b)    a##b
+#define TRACE_CONCAT(a, b)          TRACE_CONCAT_INNER(a, b)
+
+/// @brief  The trace of every thread, recorded through the TRACE macros
+class Trace
+{
+public:
+    /// @brief  The most events kept for each thread
+    static constexpr std::size_t CAPACITY = 32 * 1024;
+
+    /// @brief  Records an instant event
+    /// @param  name    The event's name, which must outlive the trace, such
+    ///                 as a string literal
+    static void instant(const char *name)
+    {
+        record('i', name, 0, false);
+    }
+
+    /// @brief  Records an instant event with a value
+    static void instant(const char *name, std::int64_t value)
+    {
+        record('i', name, value, true);
+    }
+
+    /// @brief  Records the start of a span
+    static void begin(const char *name)
+    {
+        record('B', name, 0, false);
+    }
+
+    /// @brief  Records the end of a span
+    static void end(const char *name)
+    {
+        record('E', name, 0, false);
+    }
+
+    /// @brief  Names the calling thread
+    static void nameThread(const std::string &name)
+    {
+        Buffer &buffer = local();
+        std::lock_guard lock(registry().mutex);
+        buffer.name = name;
+    }
+
+    /// @brief  Writes every event recorded so far, in the Chrome trace event
+    ///         format. Any thread may call this whilst others are recording.
+    static void writeJson(std::ostream &out)
+    {
+        Registry &reg = registry();
+        std::lock_guard lock(reg.mutex);
+        // Time stamp counter ticks per microsecond, measured over the run
+        const Stamp now = Stamp::take();
+        const double elapsed = static_cast<double>(std::chrono::duration_cast<
+            std::chrono::nanoseconds>(now.clock - reg.start.clock).count());
+        const double ticksPerMicro = (elapsed > 0.0 && now.counter > reg.start.counter) ?
+            static_cast<double>(now.counter - reg.start.counter) * 1000.0 / elapsed : 1.0;
+
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        const auto separate = [&out, &first]() {
+            out << (first ? "\n" : ",\n");
+            first = false;
+        };
+        for (const std::unique_ptr<Buffer> &buffer : reg.buffers)
+        {
+            separate();
+            out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid <<
+                ",\"args\":{\"name\":";
+            writeString(out, buffer->name.empty() ?
+                "Thread " + std::to_string(buffer->tid) : buffer->name);
+            out << "}}";
+
+            const std::size_t count = buffer->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                const Event &event = buffer->events[i];
+                const double micros = static_cast<double>(event.ticks - reg.start.counter) /
+                    ticksPerMicro;
+                separate();
+                out << "{\"name\":";
+                writeString(out, event.name);
+                out << ",\"ph\":\"" << event.phase << "\"";
+                if (event.phase == 'i')
+                {
+                    out << ",\"s\":\"t\"";
+                }
+                out << ",\"ts\":" << std::fixed << micros << ",\"pid\":1,\"tid\":" << buffer->tid;
+                if (event.hasValue)
+                {
+                    out << ",\"args\":{\"value\":" << event.value << "}";
+                }
+                out << "}";
+            }
+
+            const std::uint64_t dropped = buffer->dropped.load(std::memory_order_relaxed);
+            if (dropped > 0)
+            {
+                separate();
+                const double micros = static_cast<double>(now.counter - reg.start.counter) /
+                    ticksPerMicro;
+                out << "{\"name\":\"Events dropped\",\"ph\":\"i\",\"s\":\"t\",\"ts\":" <<
+                    std::fixed << micros << ",\"pid\":1,\"tid\":" << buffer->tid <<
+                    ",\"args\":{\"value\":" << dropped << "}}";
+            }
+        }
+        out << "\n]}\n";
+    }
+
+    /// @brief  Saves every event recorded so far to a file
+    /// @returns    False if the file could not be written
+    static bool save(const std::string &path)
+    {
+        std::ofstream out(path);
+        writeJson(out);
+        return static_cast<bool>(out);
+    }
+
+private:
+    /// @brief  A recorded event
+    struct Event
+    {
+        /// @brief  When it happened, in time stamp counter ticks
+        std::uint64_t ticks;
+        /// @brief  Its name
+        const char *name;
+        /// @brief  Its value, if it has one
+        std::int64_t value;
+        /// @brief  The Chrome trace phase: instant, span begin or span end
+        char phase;
+        /// @brief  Whether it has a value
+        bool hasValue;
+    };
+
+    /// @brief  A thread's events, written only by that thread
+    struct alignas(CACHE_LINE_SIZE) Buffer
+    {
+        /// @brief  The number of events recorded, published after each
+        std::atomic<std::size_t> count{ 0 };
+        /// @brief  The number of events dropped once full
+        std::atomic<std::uint64_t> dropped{ 0 };
+        /// @brief  The thread's number in the trace
+        int tid = 0;
+        /// @brief  The thread's name, guarded by the registry's mutex
+        std::string name;
+        /// @brief  The events, left uninitialised until recorded
+        Event events[CAPACITY];
+    };
+
+    /// @brief  A time stamp counter reading, with the clock's time
+    struct Stamp
+    {
+        std::uint64_t counter;
+        std::chrono::steady_clock::time_point clock;
+
+        static Stamp take()
+        {
+            return Stamp{ ticks(), std::chrono::steady_clock::now() };
+        }
+    };
+
+    /// @brief  Every thread's buffer
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Buffer>> buffers;
+        /// @brief  When tracing began, against which the counter's rate is
+        ///         measured
+        const Stamp start = Stamp::take();
+    };
+
+    /// @brief  The registry, never destroyed, so that threads still running
+    ///         as the program exits may keep recording
+    static Registry &registry()
+    {
+        static Registry *const reg = new Registry();
+        return *reg;
+    }
+
+    /// @brief  The calling thread's buffer, created on first use
+    static Buffer &local()
+    {
+        thread_local Buffer *const buffer = []() {
+            Registry &reg = registry();
+            std::unique_ptr<Buffer> created(new Buffer);
+            std::lock_guard lock(reg.mutex);
+            created->tid = static_cast<int>(reg.buffers.size()) + 1;
+            reg.buffers.push_back(std::move(created));
+            return reg.buffers.back().get();
+        }();
+        return *buffer;
+    }
+
+    /// @brief  Reads the time stamp counter, or the clock in nanoseconds
+    ///         without one
+    static std::uint64_t ticks()
+    {
+#if defined(CPU_X86)
+        return __rdtsc();
+#else
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /// @brief  Records an event on the calling thread
+    static void record(char phase, const char *name, std::int64_t value, bool hasValue)
+    {
+        Buffer &buffer = local();
+        const std::size_t index = buffer.count.load(std::memory_order_relaxed);
+        if (index == CAPACITY)
+        {
+            buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+            return;
+        }
+        buffer.events[index] = Event{ ticks(), name, value, phase, hasValue };
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    /// @brief  Writes a JSON string, escaping as needed
+    static void writeString(std::ostream &out, const std::string &text)
+    {
+        out << '"';
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out << ' ';
+            }
+            else
+            {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+};
+
+/// @brief  Records a span over its own lifetime
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name)
+        : mName(name)
+    {
+        Trace::begin(mName);
+    }
+
+    ~TraceScope()
+    {
+        Trace::end(mName);
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    /// @brief  The span's name
+    const char *const mName;
+};
+
+/// @brief  Saves the trace on destruction, held as a static so that it is
+///         destroyed as the program exits
+class TraceSaver
+{
+public:
+    explicit TraceSaver(std::string path)
+        : mPath(std::move(path))
+    {
+    }
+
+    ~TraceSaver()
+    {
+        Trace::save(mPath);
+    }
+
+    TraceSaver(const TraceSaver &) = delete;
+    TraceSaver &operator=(const TraceSaver &) = delete;
+
+private:
+    /// @brief  The file to save to
+    const std::string mPath;
+};
@@ -0,0 +1,284 @@
+/**
+ * @file    work-stealing-pool.h
+ *
+ * @brief   A collection of per-worker task queues. Each worker takes work from
+ *          its own queue, and only when that is empty does it steal from the
+ *          queues of its peers. This replaces the single mutex guarding a
+ *          single std::queue that every worker would otherwise contend on.
+ *
+ *          Idle workers park on a std::condition_variable_any using the same
+ *          stop_token aware wait() as the shared queue, so a stop request
+ *          still wakes them immediately. A worker passing an AdaptiveWait
+ *          first spins briefly on the pending count, before parking.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <stop_token>
+
+#include "adaptive-wait.h"
+#include "cpu.h"
+
+/// @brief  Per-worker queues with stealing between peers when idle
+template<typename T>
+class WorkStealingPool
+{
+public:
+    /// @brief  Constructor
+    /// @param  capacity    The maximum number of workers that may attach
+    explicit WorkStealingPool(std::size_t capacity)
+        : mCapacity(capacity > 0 ? capacity : 1)
+        , mShards(std::make_unique<Shard[]>(mCapacity))
+    {
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    /// @brief  Registers a new worker with the pool, giving it its own queue
+    /// @returns    The slot index to be used by the worker when popping
+    std::size_t attach()
+    {
+        const std::size_t slot = mAttached.fetch_add(1);
+        if (slot >= mCapacity)
+        {
+            mAttached.fetch_sub(1);
+            throw std::length_error("WorkStealingPool: no free worker slots");
+        }
+        return slot;
+    }
+
+    /// @brief  Adds an item to the pool. Items are spread across the attached
+    ///         workers in turn, and a parked worker is only woken if there is
+    ///         one to wake.
+    /// @param  item    The item to be added
+    void push(T item)
+    {
+        pushBulk(std::span<T>(&item, 1));
+    }
+
+    /// @brief  Adds a batch of items, giving each worker a contiguous share so
+    ///         that each of their queues is only locked once. Successive
+    ///         batches start at the worker after the last one given a share.
+    /// @param  items   The items to be added, which are moved from
+    void pushBulk(std::span<T> items)
+    {
+        if (items.empty())
+        {
+            return;
+        }
+        const std::size_t attached = std::max<std::size_t>(mAttached.load(), 1);
+        const std::size_t share = (items.size() + attached - 1) / attached;
+        const std::size_t shares = (items.size() + share - 1) / share;
+        std::size_t slot = mNext.fetch_add(shares, std::memory_order_relaxed);
+        for (std::size_t first = 0; first < items.size(); first += share, ++slot)
+        {
+            const std::size_t last = std::min(items.size(), first + share);
+            Shard &shard = mShards[slot % attached];
+            std::lock_guard lock(shard.mutex);
+            for (std::size_t i = first; i < last; ++i)
+            {
+                shard.items.push_back(std::move(items[i]));
+            }
+            shard.count.store(shard.items.size(), std::memory_order_relaxed);
+            // Must be counted before the items can be taken by anyone else
+            mPending.fetch_add(last - first);
+        }
+        wake(items.size());
+    }
+
+    /// @brief  Takes the next item for the given worker, stealing from its
+    ///         peers if its own queue is empty, and parking if there is no
+    ///         work anywhere.
+    /// @param  slot        The slot returned from attach()
+    /// @param  item        Set to the item taken
+    /// @param  token       The stop token of the calling worker
+    /// @param  finishEarly Whether the worker may leave work behind once a
+    ///                     stop has been requested
+    /// @returns    True if an item was taken, false if the worker should stop
+    bool pop(std::size_t slot, T &item, const std::stop_token &token,
+        bool finishEarly)
+    {
+        return popUpTo(slot, std::span<T>(&item, 1), token, finishEarly) == 1;
+    }
+
+    /// @brief  Takes up to out.size() items for the given worker under a single
+    ///         lock of its own queue. If that is empty, up to half of the
+    ///         first busy peer's queue is stolen instead, and if there is no
+    ///         work anywhere, the worker parks.
+    /// @param  slot        The slot returned from attach()
+    /// @param  out         Storage for the items taken
+    /// @param  token       The stop token of the calling worker
+    /// @param  finishEarly Whether the worker may leave work behind once a
+    ///                     stop has been requested
+    /// @param  spin        If given, the calling worker's wait, which is made
+    ///                     before parking
+    /// @returns    The number of items taken, zero if the worker should stop
+    std::size_t popUpTo(std::size_t slot, std::span<T> out,
+        const std::stop_token &token, bool finishEarly, AdaptiveWait *spin = nullptr)
+    {
+        if (out.empty())
+        {
+            return 0;
+        }
+        while (true)
+        {
+            if (finishEarly && token.stop_requested())
+            {
+                return 0;
+            }
+            std::size_t count = takeFrom(slot, slot, out);
+            const std::size_t attached = mAttached.load();
+            for (std::size_t i = 1; count == 0 && i < attached &&
+                mPending.load() > 0; ++i)
+            {
+                count = takeFrom(slot, (slot + i) % attached, out);
+            }
+            if (count > 0)
+            {
+                return count;
+            }
+            // Nothing to do anywhere, so wait briefly for work, if asked
+            if (spin && spin->wait(token, [this]() { return mPending.load() > 0; }))
+            {
+                continue;
+            }
+
+            // Still nothing, so park until work arrives. As with the
+            // shared queue, wait() returns the predicate result, so a false
+            // value means that a stop was requested with no work remaining.
+            std::unique_lock lock(mParkMutex);
+            mSleepers.fetch_add(1);
+            const bool hasWork = mParkCv.wait(lock, token, [&]() {
+                return mPending.load() > 0;
+            });
+            mSleepers.fetch_sub(1);
+            if (!hasWork)
+            {
+                return 0;
+            }
+            if (spin)
+            {
+                spin->parked();
+            }
+        }
+    }
+
+    /// @brief  The number of items waiting across all of the queues
+    std::size_t size() const
+    {
+        return mPending.load(std::memory_order_relaxed);
+    }
+
+    /// @brief  The number of items waiting in a single worker's queue
+    /// @param  slot    The slot returned from attach()
+    std::size_t size(std::size_t slot) const
+    {
+        return mShards[slot].count.load(std::memory_order_relaxed);
+    }
+
+private:
+
+    /// @brief  A single worker's queue, on cache lines of its own so that
+    ///         workers taking from neighbouring queues do not contend
+    struct alignas(CACHE_LINE_SIZE) Shard
+    {
+        /// @brief  Mutex protecting this queue only
+        std::mutex mutex;
+        /// @brief  The queued items
+        std::deque<T> items;
+        /// @brief  Copy of the queue size, readable without the lock
+        std::atomic<std::size_t> count{ 0 };
+    };
+
+    /// @brief  Takes up to out.size() items from the given queue. Owners take
+    ///         their newest work, whilst thieves take the oldest half.
+    /// @param  slot    The slot of the calling worker
+    /// @param  victim  The slot to take from, which may be the caller's own
+    /// @param  out     Storage for the items taken
+    /// @returns    The number of items taken
+    std::size_t takeFrom(std::size_t slot, std::size_t victim, std::span<T> out)
+    {
+        // Queues with nothing in them are skipped without taking their lock
+        Shard &shard = mShards[victim];
+        if (shard.count.load(std::memory_order_relaxed) == 0)
+        {
+            return 0;
+        }
+        std::lock_guard lock(shard.mutex);
+        const std::size_t available = (victim == slot) ?
+            shard.items.size() : (shard.items.size() + 1) / 2;
+        const std::size_t count = std::min(out.size(), available);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (victim == slot)
+            {
+                out[i] = std::move(shard.items.back());
+                shard.items.pop_back();
+            }
+            else
+            {
+                out[i] = std::move(shard.items.front());
+                shard.items.pop_front();
+            }
+        }
+        shard.count.store(shard.items.size(), std::memory_order_relaxed);
+        mPending.fetch_sub(count);
+        return count;
+    }
+
+    /// @brief  Wakes parked workers, if there are any, but no more than
+    ///         there are new items for
+    /// @param  count   The number of new items, and so workers worth waking
+    void wake(std::size_t count = 1)
+    {
+        // Sleepers register under mParkMutex before checking mPending, so if
+        // none are seen here, any worker about to park will see the new item.
+        const int sleepers = mSleepers.load();
+        if (sleepers > 0)
+        {
+            std::lock_guard lock(mParkMutex);
+            const std::size_t wakes = std::min(count, static_cast<std::size_t>(sleepers));
+            for (std::size_t i = 0; i < wakes; ++i)
+            {
+                mParkCv.notify_one();
+            }
+        }
+    }
+
+    // The members are grouped by who writes them, each group starting a cache
+    // line of its own, so that the producers counting new items and the
+    // workers parking do not invalidate the line every take() reads first.
+
+    /// @brief  The maximum number of workers, read-mostly from here
+    const std::size_t mCapacity;
+    /// @brief  One queue per worker slot
+    std::unique_ptr<Shard[]> mShards;
+    /// @brief  The number of attached workers, which only changes as they
+    ///         attach
+    std::atomic<std::size_t> mAttached{ 0 };
+    /// @brief  Round-robin counter used to distribute new items, written by
+    ///         the producers only
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mNext{ 0 };
+    /// @brief  The number of items across all queues, written by everyone,
+    ///         with the parking state that is always used alongside it
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> mPending{ 0 };
+    /// @brief  The number of workers currently parked
+    std::atomic<int> mSleepers{ 0 };
+    /// @brief  Mutex used only for parking idle workers
+    std::mutex mParkMutex;
+    /// @brief  Condition variable that idle workers park on
+    std::condition_variable_any mParkCv;
+};
@@ -0,0 +1,241 @@
+/**
+ * @file    worker-stats.h
+ *
+ * @brief   Counters recording where a worker thread's time goes: the tasks it
+ *          runs, how long each waited in the queue and took to run, how long
+ *          it held or waited for the queue lock, and how long it sat idle
+ *          waiting for work.
+ *
+ *          Each worker owns its own WorkerStats, padded to whole cache lines,
+ *          and is the only thread writing it. The counters can then be updated
+ *          with relaxed loads and stores rather than locked read-modify-write
+ *          instructions, and cost little more than the clock reads needed to
+ *          fill them. Any thread may take a snapshot at any time, and a
+ *          StatsDumper logs them periodically.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+#include "cpu.h"
+#include "interruptible-sleep.h"
+
+/// @brief  The counters for a single worker thread
+class alignas(CACHE_LINE_SIZE) WorkerStats
+{
+public:
+    /// @brief  The clock used for all timings
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief  The number of execution time histogram buckets. Bucket zero
+    ///         counts tasks taking under 1us, and bucket i those taking from
+    ///         2^(i-1)us up to 2^i us, with the last also counting anything
+    ///         slower, from around 17 seconds
+    static constexpr std::size_t BUCKETS = 26;
+
+    /// @brief  A copy of the counters at one moment
+    struct Snapshot
+    {
+        /// @brief  The number of tasks run
+        std::uint64_t tasks = 0;
+        /// @brief  The number of tasks dropped unrun, their deadlines passed
+        std::uint64_t expired = 0;
+        /// @brief  The total time tasks spent queued before being taken
+        std::chrono::nanoseconds queueWait{ 0 };
+        /// @brief  The total time spent running tasks
+        std::chrono::nanoseconds execution{ 0 };
+        /// @brief  The total time spent waiting to take the queue lock
+        std::chrono::nanoseconds lockWait{ 0 };
+        /// @brief  The total time the queue lock was held, not counting
+        ///         time spent waiting on its condition variable
+        std::chrono::nanoseconds lockHold{ 0 };
+        /// @brief  The total time spent waiting for work
+        std::chrono::nanoseconds idle{ 0 };
+        /// @brief  The execution time histogram
+        std::array<std::uint64_t, BUCKETS> histogram{};
+
+        /// @brief  Adds another snapshot, e.g. to total a whole pool
+        Snapshot &operator+=(const Snapshot &other)
+        {
+            tasks += other.tasks;
+            expired += other.expired;
+            queueWait += other.queueWait;
+            execution += other.execution;
+            lockWait += other.lockWait;
+            lockHold += other.lockHold;
+            idle += other.idle;
+            for (std::size_t i = 0; i < BUCKETS; ++i)
+            {
+                histogram[i] += other.histogram[i];
+            }
+            return *this;
+        }
+
+        /// @brief  An upper bound on the given percentile of execution time,
+        ///         to the resolution of the histogram
+        /// @param  fraction    The percentile, from 0 to 1
+        std::chrono::microseconds percentile(double fraction) const
+        {
+            const std::uint64_t wanted =
+                static_cast<std::uint64_t>(fraction * static_cast<double>(tasks));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < BUCKETS; ++i)
+            {
+                seen += histogram[i];
+                if (seen > wanted || seen == tasks)
+                {
+                    return std::chrono::microseconds(std::uint64_t{ 1 } << i);
+                }
+            }
+            return std::chrono::microseconds(std::uint64_t{ 1 } << (BUCKETS - 1));
+        }
+
+        /// @brief  A one line summary, suitable for logging
+        std::string summary() const
+        {
+            const auto average = [this](std::chrono::nanoseconds total) {
+                return std::to_string(tasks > 0 ?
+                    total.count() / 1000 / static_cast<long long>(tasks) : 0) + "us";
+            };
+            const auto micros = [](std::chrono::nanoseconds total) {
+                return std::to_string(total.count() / 1000) + "us";
+            };
+            return "tasks " + std::to_string(tasks) +
+                " | queued avg " + average(queueWait) +
+                " | exec avg " + average(execution) +
+                " p50 <" + std::to_string(percentile(0.5).count()) + "us" +
+                " p99 <" + std::to_string(percentile(0.99).count()) + "us" +
+                " | lock wait " + micros(lockWait) +
+                " hold " + micros(lockHold) +
+                " | idle " + micros(idle) +
+                (expired > 0 ? " | expired " + std::to_string(expired) : "");
+        }
+    };
+
+    WorkerStats() = default;
+    WorkerStats(const WorkerStats &) = delete;
+    WorkerStats &operator=(const WorkerStats &) = delete;
+
+    /// @brief  Records a task having been run. Owning thread only.
+    /// @param  queueWait   The time from the task being queued to being taken
+    /// @param  execution   The time taken to run it
+    void recordTask(Clock::duration queueWait, Clock::duration execution)
+    {
+        add(mTasks, 1);
+        add(mQueueWait, nanos(queueWait));
+        add(mExecution, nanos(execution));
+        const std::uint64_t micros = nanos(execution) / 1000;
+        const std::size_t bucket = std::min<std::size_t>(
+            static_cast<std::size_t>(std::bit_width(micros)), BUCKETS - 1);
+        add(mHistogram[bucket], 1);
+    }
+
+    /// @brief  Records a task having been dropped unrun, as its deadline had
+    ///         passed by the time it was taken. Owning thread only.
+    void recordExpired()
+    {
+        add(mExpired, 1);
+    }
+
+    /// @brief  Records a use of the queue lock. Owning thread only.
+    /// @param  wait    The time taken to acquire it
+    /// @param  hold    The time it was held, excluding idle time
+    void recordLock(Clock::duration wait, Clock::duration hold)
+    {
+        add(mLockWait, nanos(wait));
+        add(mLockHold, nanos(hold));
+    }
+
+    /// @brief  Records time spent waiting for work. Owning thread only.
+    /// @param  idle    The time spent waiting
+    void recordIdle(Clock::duration idle)
+    {
+        add(mIdle, nanos(idle));
+    }
+
+    /// @brief  Copies the counters. Any thread may call this, though the
+    ///         counters are read one at a time, so the copy may be part way
+    ///         through recording a task.
+    Snapshot snapshot() const
+    {
+        Snapshot snap;
+        snap.tasks = mTasks.load(std::memory_order_relaxed);
+        snap.expired = mExpired.load(std::memory_order_relaxed);
+        snap.queueWait = std::chrono::nanoseconds(mQueueWait.load(std::memory_order_relaxed));
+        snap.execution = std::chrono::nanoseconds(mExecution.load(std::memory_order_relaxed));
+        snap.lockWait = std::chrono::nanoseconds(mLockWait.load(std::memory_order_relaxed));
+        snap.lockHold = std::chrono::nanoseconds(mLockHold.load(std::memory_order_relaxed));
+        snap.idle = std::chrono::nanoseconds(mIdle.load(std::memory_order_relaxed));
+        for (std::size_t i = 0; i < BUCKETS; ++i)
+        {
+            snap.histogram[i] = mHistogram[i].load(std::memory_order_relaxed);
+        }
+        return snap;
+    }
+
+private:
+    /// @brief  A duration as a number of nanoseconds
+    static std::uint64_t nanos(Clock::duration duration)
+    {
+        const auto count = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        return count > 0 ? static_cast<std::uint64_t>(count) : 0;
+    }
+
+    /// @brief  Adds to a counter. There is only ever one writer, so this need
+    ///         not be a locked read-modify-write.
+    static void add(std::atomic<std::uint64_t> &counter, std::uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value,
+            std::memory_order_relaxed);
+    }
+
+    /// @brief  The number of tasks run
+    std::atomic<std::uint64_t> mTasks{ 0 };
+    /// @brief  The number of tasks dropped unrun
+    std::atomic<std::uint64_t> mExpired{ 0 };
+    /// @brief  The times in each Snapshot, as totals in nanoseconds
+    std::atomic<std::uint64_t> mQueueWait{ 0 };
+    std::atomic<std::uint64_t> mExecution{ 0 };
+    std::atomic<std::uint64_t> mLockWait{ 0 };
+    std::atomic<std::uint64_t> mLockHold{ 0 };
+    std::atomic<std::uint64_t> mIdle{ 0 };
+    /// @brief  The execution time histogram
+    std::array<std::atomic<std::uint64_t>, BUCKETS> mHistogram{};
+};
+
+/// @brief  A thread calling a dump function periodically, e.g. to log the
+///         snapshots of every worker in a pool
+class StatsDumper
+{
+public:
+    /// @brief  Constructor, starting the thread
+    /// @param  period  The time between dumps
+    /// @param  dump    Called once each period from the dumping thread
+    StatsDumper(std::chrono::milliseconds period, std::function<void(void)> dump)
+        : mThread([period, dump = std::move(dump)](std::stop_token token) {
+            while (interruptibleSleep(token, period))
+            {
+                dump();
+            }
+        })
+    {
+    }
+
+private:
+    /// @brief  The dumping thread, stopped and joined on destruction
+    std::jthread mThread;
+};
@@ -12,6 +12,8 @@
 #include <chrono>
 #include <iostream>
 
+#include "../common/trace.h"
+
 using namespace std::chrono_literals;
 
 /// @brief  Provides a standardised log message
@@ -25,6 +27,8 @@ static void uninterruptibleArgs(
     const std::chrono::milliseconds &delay
 )
 {
+    TRACE_THREAD(name);
+    TRACE_SCOPE("Running");
     LOG(name, "Thread will terminate in " << delay.count() << " milliseconds");
     std::this_thread::sleep_for(delay);
     LOG(name, "Leaving thread.");
@@ -38,8 +42,12 @@ static void uninterruptible()
 }
 
 /// @brief  Main
-int main(int argc, char** argv)
+int main()
 {
+    // When built with THREAD_TRACE, saves the thread lifecycle events on exit
+    TRACE_SAVE_ON_EXIT("ex1-trace.json");
+    TRACE_THREAD("Main");
+
     // Runs the function without arguments - this will run for a set length of
     // time - in this example, deliberately longer than thread uThreadQuick.
     std::jthread uThread(uninterruptible);
@@ -64,6 +72,7 @@ int main(int argc, char** argv)
     // carry out an action once the thread has completed. In this case, we start
     // one final thread and let it run without joining.
     uThreadSlow.join();
+    TRACE("Joined");
 
     // Final thread, runs without joining.
     std::jthread uFinalThread(uninterruptibleArgs, "Final Thread", 100ms);
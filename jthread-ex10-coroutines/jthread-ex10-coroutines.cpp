@@ -0,0 +1,182 @@
+/**
+ * @file    jthread-ex10-coroutines.cpp
+ *
+ * @brief   Example of C++20 coroutines waiting on data, time and stop
+ *          requests in place of threads. The blocking workers of examples 4
+ *          and 6 each hold an OS thread for as long as they sit in a
+ *          condition variable's wait(). Here each waiter is a CoTask instead,
+ *          costing only its coroutine frame whilst suspended, and a CoExecutor
+ *          resumes them on a small pool of std::jthreads.
+ *          A stop request still ends each wait through a std::stop_callback,
+ *          exactly as the blocking workers do, so tens of thousands of waiters
+ *          sharing a couple of threads can all be stopped at once.
+ *
+ *          Usage: ex10 [waiters] [threads]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <string>
+#include <atomic>
+
+#include "../common/async-log.h"
+#include "../common/colour.h"
+#include "../common/coroutine.h"
+
+using namespace std::chrono_literals;
+
+/// @brief  The coroutine version of example 4's blockingWorker(), waiting
+///         until the data is ready or a stop is requested
+/// @param  foreground  The colour used for logging
+/// @param  name        The name used for logging
+/// @param  signal      The data to wait on
+static CoTask blockingWorker(const Colour foreground, const std::string name,
+    CoSignal<bool> &signal)
+{
+    LOG(foreground, name, "Starting task until data ready or stopped.");
+    const bool done = co_await dataReady(signal, [](bool ready) { return ready; });
+    LOG(foreground, name, "Data: " << done);
+    LOG(foreground, name, "Leaving task.");
+}
+
+/// @brief  Waits for a signal's value to reach a target
+/// @param  signal      The value to wait on
+/// @param  target      The value to wait for
+/// @param  satisfied   Counts the waiters that saw their target
+static CoTask targetWaiter(CoSignal<int> &signal, int target,
+    std::atomic<int> &satisfied)
+{
+    if (co_await dataReady(signal, [target](int value) { return value >= target; }))
+    {
+        satisfied.fetch_add(1);
+    }
+}
+
+/// @brief  Sleeps a number of times, as a periodic thread would
+/// @param  period  The time between wake-ups
+/// @param  times   The number of wake-ups
+/// @param  woken   Counts the wake-ups across all of the sleepers
+static CoTask sleeper(std::chrono::milliseconds period, int times,
+    std::atomic<int> &woken)
+{
+    for (int i = 0; i < times; ++i)
+    {
+        if (!co_await sleepFor(period))
+        {
+            co_return;
+        }
+        woken.fetch_add(1);
+    }
+}
+
+/// @brief  Does nothing but wait to be stopped
+/// @param  stopped Counts the tasks that saw the stop
+static CoTask stopWaiter(std::atomic<int> &stopped)
+{
+    co_await stopRequested();
+    stopped.fetch_add(1);
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    static const std::string NAME = "Main";
+    static const Colour COL = COL_BLU;
+
+    int waiters = 10000;
+    int threadCount = 2;
+    try
+    {
+        if (argc > 1)
+        {
+            waiters = std::stoi(argv[1]);
+        }
+        if (argc > 2)
+        {
+            threadCount = std::stoi(argv[2]);
+        }
+    }
+    catch (const std::exception &)
+    {
+        LOG(COL_RED, "ERROR", "Usage: " << argv[0] << " [waiters] [threads]");
+        return 1;
+    }
+
+    CoExecutor executor(threadCount > 0 ? threadCount : 1);
+    LOG(COL, NAME, "Running coroutines on " << executor.threads() << " threads");
+
+    // As in example 4, one waiter is released by its data, and another by a
+    // stop request on its own token
+    CoSignal<bool> dataReleased;
+    CoSignal<bool> neverReleased;
+    std::stop_source manualStop;
+    executor.spawn(blockingWorker(COL_RED, "Data Released Red", dataReleased));
+    executor.spawn(blockingWorker(COL_GRN, "Manually Stopped Green", neverReleased),
+        manualStop.get_token());
+    std::this_thread::sleep_for(500ms);
+    LOG(COL, NAME, "Releasing the data");
+    dataReleased.set(true);
+    std::this_thread::sleep_for(500ms);
+    LOG(COL, NAME, "Requesting a stop");
+    manualStop.request_stop();
+    executor.wait();
+
+    // Many waiters on one value, each with its own target, resumed in turn as
+    // the value rises
+    static const int STEPS = 10;
+    CoSignal<int> value(0);
+    std::atomic<int> satisfied{ 0 };
+    for (int i = 0; i < waiters; ++i)
+    {
+        executor.spawn(targetWaiter(value, i % STEPS + 1, satisfied));
+    }
+    LOG(COL_YLW, "Signal", executor.active() << " waiters suspended on " <<
+        executor.threads() << " threads");
+    for (int step = 1; step <= STEPS; ++step)
+    {
+        value.set(step);
+        std::this_thread::sleep_for(20ms);
+        LOG(COL_YLW, "Signal", "Value " << step << ": " << satisfied.load() <<
+            " waiters satisfied");
+    }
+    executor.wait();
+
+    // Many periodic sleepers, all driven by the executor's single timer thread
+    static const int SLEEPS = 5;
+    std::atomic<int> woken{ 0 };
+    const auto sleepStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < waiters; ++i)
+    {
+        executor.spawn(sleeper(std::chrono::milliseconds(20 + i % 5 * 10), SLEEPS, woken));
+    }
+    executor.wait();
+    const auto slept = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - sleepStart);
+    LOG(COL_CYN, "Sleep", waiters << " sleepers woke " << woken.load() <<
+        " times in " << slept.count() << " ms");
+
+    // And many waiters that only leave when stopped, alongside sleepers far
+    // longer than the demonstration, all ended by one stop request
+    std::atomic<int> stopped{ 0 };
+    std::atomic<int> unused{ 0 };
+    for (int i = 0; i < waiters; ++i)
+    {
+        executor.spawn(stopWaiter(stopped));
+        executor.spawn(sleeper(1h, 1, unused));
+    }
+    std::this_thread::sleep_for(100ms);
+    LOG(COL_MAG, "Stop", "Stopping " << executor.active() << " suspended tasks");
+    const auto stopStart = std::chrono::steady_clock::now();
+    executor.requestStop();
+    executor.wait();
+    const auto stopTaken = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - stopStart);
+    LOG(COL_MAG, "Stop", stopped.load() << " stop waiters and " << waiters <<
+        " sleepers ended in " << stopTaken.count() << " ms");
+
+    LOG(COL, NAME, "About to leave the main thread");
+    return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * @file    jthread-ex11-task-graph.cpp
+ *
+ * @brief   Example of a graph of dependent tasks. Examples 5 to 7 chain one
+ *          thread onto another by starting the second from a stop_callback of
+ *          the first, a single dependency set up by hand. Here the steps of a
+ *          build are declared as nodes of a TaskGraph, with an edge for every
+ *          dependency, and each runs on the pool as soon as everything it
+ *          depends on is done. The steps compiling in parallel each run on a
+ *          worker of their own, whilst the single step that follows continues
+ *          on whichever worker finished last, without being queued.
+ *
+ *          The graph is then run twice more. First, one of the compile steps
+ *          is cancelled part way through by another thread, which, through a
+ *          stop_callback on every edge, cancels every step downstream of it
+ *          straight away, whilst the other compile steps complete. Then, a
+ *          step throws, cancelling only the steps that depend on it.
+ *
+ *          Usage: ex11 [threads]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+
+#include "../common/async-log.h"
+#include "../common/colour.h"
+#include "../common/task-graph.h"
+#include "../common/thread-pool.h"
+
+using namespace std::chrono_literals;
+
+/// @brief  A small number for the calling thread, given out in the order
+///         that threads first ask, for logging
+static int threadNumber()
+{
+    static std::atomic<int> next{ 0 };
+    thread_local const int number = ++next;
+    return number;
+}
+
+/// @brief  The name of each state, for logging
+static const char *stateName(TaskGraph::NodeState state)
+{
+    switch (state)
+    {
+    case TaskGraph::NodeState::COMPLETED:
+        return "completed";
+    case TaskGraph::NodeState::CANCELLED:
+        return "cancelled";
+    case TaskGraph::NodeState::FAILED:
+        return "failed";
+    default:
+        return "pending";
+    }
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    static const std::string NAME = "Main";
+    static const Colour COL = COL_BLU;
+
+    int threadCount = 4;
+    if (argc > 1)
+    {
+        try
+        {
+            threadCount = std::stoi(argv[1]);
+        }
+        catch (const std::exception &)
+        {
+            LOG(COL_RED, "ERROR", "Invalid thread count: " << argv[1]);
+        }
+    }
+    ThreadPool pool(threadCount > 0 ? threadCount : 1);
+    LOG(COL, NAME, "Running with a pool of " << pool.size() << " threads, on thread " <<
+        threadNumber());
+
+    // Whether the test step should fail, for the last run
+    std::atomic<bool> failTests{ false };
+
+    // A step of the build, which works in slices so that it notices a stop
+    // request promptly
+    struct Step
+    {
+        std::string name;
+        Colour colour;
+        std::chrono::milliseconds length;
+    };
+    const std::vector<Step> STEPS = {
+        { "Fetch", COL_GRN, 200ms },
+        { "Compile_A", COL_YLW, 600ms },
+        { "Compile_B", COL_RED, 900ms },
+        { "Compile_C", COL_CYN, 400ms },
+        { "Link", COL_MAG, 300ms },
+        { "Test", COL_GRN, 500ms },
+        { "Package", COL_YLW, 200ms },
+        { "Publish", COL_CYN, 100ms },
+    };
+
+    TaskGraph graph;
+    std::vector<TaskGraph::NodeId> ids;
+    for (const Step &step : STEPS)
+    {
+        ids.push_back(graph.add([&step, &failTests](const std::stop_token &token) {
+            LOG(step.colour, step.name, "Starting on thread " << threadNumber());
+            const auto end = std::chrono::steady_clock::now() + step.length;
+            while (std::chrono::steady_clock::now() < end)
+            {
+                if (token.stop_requested())
+                {
+                    LOG(step.colour, step.name, "Stopped part way through");
+                    return;
+                }
+                std::this_thread::sleep_for(20ms);
+            }
+            if (step.name == "Test" && failTests)
+            {
+                throw std::runtime_error("Test failed");
+            }
+            LOG(step.colour, step.name, "Done");
+        }));
+    }
+    enum { FETCH, COMPILE_A, COMPILE_B, COMPILE_C, LINK, TEST, PACKAGE, PUBLISH };
+    for (const int compile : { COMPILE_A, COMPILE_B, COMPILE_C })
+    {
+        graph.addEdge(ids[FETCH], ids[compile]);
+        graph.addEdge(ids[compile], ids[LINK]);
+    }
+    graph.addEdge(ids[LINK], ids[TEST]);
+    graph.addEdge(ids[LINK], ids[PACKAGE]);
+    graph.addEdge(ids[TEST], ids[PUBLISH]);
+    graph.addEdge(ids[PACKAGE], ids[PUBLISH]);
+
+    // Logs what became of every step
+    auto logStates = [&]() {
+        for (std::size_t i = 0; i < STEPS.size(); ++i)
+        {
+            LOG(STEPS[i].colour, STEPS[i].name, stateName(graph.state(ids[i])));
+        }
+    };
+
+    // A full run, with the main thread helping rather than waiting
+    LOG(COL, NAME, "Running the whole build");
+    auto start = std::chrono::steady_clock::now();
+    bool completed = graph.run(pool);
+    LOG(COL, NAME, "Build " << (completed ? "completed" : "did not complete") << " in " <<
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count() << " ms");
+    logStates();
+
+    // Cancel one compile step whilst it runs. Everything downstream of it is
+    // cancelled at once, whilst the other compile steps finish.
+    LOG(COL, NAME, "Running again, cancelling " << STEPS[COMPILE_B].name << " part way");
+    {
+        std::jthread canceller([&]() {
+            std::this_thread::sleep_for(400ms);
+            LOG(COL, NAME, "Cancelling " << STEPS[COMPILE_B].name);
+            graph.cancel(ids[COMPILE_B]);
+        });
+        completed = graph.run(pool);
+    }
+    LOG(COL, NAME, "Build " << (completed ? "completed" : "did not complete"));
+    logStates();
+
+    // A step that throws cancels only what depends on it
+    LOG(COL, NAME, "Running again, with the tests failing");
+    failTests = true;
+    try
+    {
+        graph.run(pool);
+    }
+    catch (const std::exception &e)
+    {
+        LOG(COL_RED, NAME, "Build failed: " << e.what());
+    }
+    logStates();
+
+    LOG(COL, NAME, "About to leave the main thread");
+    return 0;
+}
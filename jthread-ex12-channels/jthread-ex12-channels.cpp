@@ -0,0 +1,178 @@
+/**
+ * @file    jthread-ex12-channels.cpp
+ *
+ * @brief   Example of streaming values between std::jthreads through bounded
+ *          channels. Examples 4 and 6 hand a single value from one thread to
+ *          another, through a reference guarded by a mutex and condition
+ *          variable. Here a producer streams a run of readings to a slower
+ *          consumer through a small Channel, and is held back whenever the
+ *          channel fills, before closing it, leaving the consumer to take
+ *          what is left.
+ *
+ *          Several producers then share a single channel, sending values that
+ *          can only be moved, which the consumer takes in batches. Finally, a
+ *          receiver waiting on an empty channel and a sender waiting on a full
+ *          one are both woken by a stop request.
+ *
+ *          Usage: ex12 [readings]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <span>
+
+#include "../common/async-log.h"
+#include "../common/channel.h"
+#include "../common/colour.h"
+
+using namespace std::chrono_literals;
+
+/// @brief  A reading streamed from the producer
+struct Reading
+{
+    /// @brief  The reading's number, in the order sent
+    int sequence = 0;
+    /// @brief  The value read
+    double value = 0.0;
+};
+
+/// @brief  A message that can only be moved, sent by one of many producers
+struct Message
+{
+    /// @brief  The producer that sent it
+    int producer = 0;
+    /// @brief  The message's number, for its producer
+    int sequence = 0;
+};
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    static const std::string NAME = "Main";
+    static const Colour COL = COL_BLU;
+
+    int readings = 12;
+    if (argc > 1)
+    {
+        try
+        {
+            readings = std::stoi(argv[1]);
+        }
+        catch (const std::exception &)
+        {
+            LOG(COL_RED, "ERROR", "Invalid reading count: " << argv[1]);
+        }
+    }
+
+    // A single producer, faster than its consumer, through a channel of four
+    {
+        LOG(COL, NAME, "Streaming " << readings << " readings through a channel of 4");
+        Channel<Reading> channel(4);
+
+        std::jthread consumer([&channel]() {
+            static const std::string NAME = "Consumer";
+            while (std::optional<Reading> reading = channel.recv())
+            {
+                LOG(COL_GRN, NAME, "Reading " << reading->sequence << ": " << reading->value);
+                std::this_thread::sleep_for(50ms);
+            }
+            LOG(COL_GRN, NAME, "Channel closed and empty");
+        });
+
+        std::jthread producer([&channel, readings]() {
+            static const std::string NAME = "Producer";
+            for (int i = 0; i < readings; ++i)
+            {
+                Reading reading{ i, 20.0 + 0.5 * i };
+                if (!channel.trySend(reading))
+                {
+                    LOG(COL_YLW, NAME, "Channel full at reading " << i << ", waiting");
+                    channel.send(reading);
+                }
+            }
+            LOG(COL_YLW, NAME, "All sent, closing the channel");
+            channel.close();
+        });
+    }
+
+    // Several producers sharing one channel, the consumer taking batches
+    {
+        static const int PRODUCERS = 3;
+        static const int MESSAGES = 10;
+        LOG(COL, NAME, "Streaming from " << PRODUCERS << " producers through one channel");
+        Channel<std::unique_ptr<Message>, ChannelKind::MPSC> channel(8);
+
+        std::jthread consumer([&channel]() {
+            static const std::string NAME = "Consumer";
+            std::array<int, PRODUCERS> counts{};
+            std::array<std::unique_ptr<Message>, 8> batch;
+            while (const std::size_t count = channel.recvUpTo(batch))
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    ++counts[static_cast<std::size_t>(batch[i]->producer)];
+                    batch[i].reset();
+                }
+                LOG(COL_GRN, NAME, "Took a batch of " << count);
+                std::this_thread::sleep_for(20ms);
+            }
+            for (int p = 0; p < PRODUCERS; ++p)
+            {
+                LOG(COL_GRN, NAME, "Producer " << p << " sent " << counts[p]);
+            }
+        });
+
+        {
+            std::vector<std::jthread> producers;
+            for (int p = 0; p < PRODUCERS; ++p)
+            {
+                producers.emplace_back([&channel, p]() {
+                    for (int i = 0; i < MESSAGES; ++i)
+                    {
+                        channel.send(std::make_unique<Message>(Message{ p, i }));
+                        std::this_thread::sleep_for(5ms);
+                    }
+                });
+            }
+        }
+        LOG(COL, NAME, "Every producer has finished, closing the channel");
+        channel.close();
+    }
+
+    // Stop requests wake both a waiting receiver and a waiting sender
+    {
+        LOG(COL, NAME, "Stopping threads waiting on an empty and a full channel");
+        Channel<int> empty(2);
+        Channel<int> full(2);
+        full.trySend(1);
+        full.trySend(2);
+
+        std::jthread receiver([&empty](std::stop_token token) {
+            static const std::string NAME = "Receiver";
+            LOG(COL_CYN, NAME, "Waiting for a value");
+            const std::optional<int> value = empty.recv(token);
+            LOG(COL_CYN, NAME, (value ? "Received a value" : "Woken by the stop request"));
+        });
+        std::jthread sender([&full](std::stop_token token) {
+            static const std::string NAME = "Sender";
+            LOG(COL_MAG, NAME, "Waiting for room");
+            const bool sent = full.send(3, token);
+            LOG(COL_MAG, NAME, (sent ? "Sent the value" : "Woken by the stop request"));
+        });
+
+        std::this_thread::sleep_for(200ms);
+        LOG(COL, NAME, "Requesting stops");
+        receiver.request_stop();
+        sender.request_stop();
+    }
+
+    LOG(COL, NAME, "About to leave the main thread");
+    return 0;
+}
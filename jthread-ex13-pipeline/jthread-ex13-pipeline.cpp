@@ -0,0 +1,155 @@
+/**
+ * @file    jthread-ex13-pipeline.cpp
+ *
+ * @brief   Example of a pipeline of stages, each with its own worker threads,
+ *          connected by bounded channels. Lines of text are parsed into
+ *          records, each record is transformed, which is the slowest step,
+ *          and the results are written out. Run one after another on a single
+ *          thread, every line costs the time of all three steps. Run as a
+ *          Pipeline, the stages overlap, with the transform stage given the
+ *          most workers. The counters logged while it runs show where the
+ *          time goes, the bottleneck being the stage whose workers are rarely
+ *          idle, while those before it wait for room in its full channel.
+ *
+ *          The source streams lines until it is stopped, after which the
+ *          pipeline is drained from its head, so that every line sent in is
+ *          still written out.
+ *
+ *          Usage: ex13 [run time in ms]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../common/async-log.h"
+#include "../common/colour.h"
+#include "../common/pipeline.h"
+#include "../common/worker-stats.h"
+
+using namespace std::chrono_literals;
+
+/// @brief  A line once parsed
+struct Record
+{
+    /// @brief  The line's number
+    int id = 0;
+    /// @brief  The value it held
+    double value = 0.0;
+};
+
+/// @brief  Parses a line of the form "id,value"
+static Record parse(std::string &&line)
+{
+    std::this_thread::sleep_for(200us);
+    const std::size_t comma = line.find(',');
+    return Record{ std::stoi(line.substr(0, comma)), std::stod(line.substr(comma + 1)) };
+}
+
+/// @brief  Transforms a record, the slowest of the three steps
+static Record transform(Record &&record)
+{
+    std::this_thread::sleep_for(1ms);
+    record.value = record.value * 1.8 + 32.0;
+    return record;
+}
+
+/// @brief  Formats a record for writing
+static std::string format(const Record &record)
+{
+    std::this_thread::sleep_for(300us);
+    return std::to_string(record.id) + ": " + std::to_string(record.value);
+}
+
+/// @brief  Makes the line with the given number
+static std::string makeLine(int id)
+{
+    return std::to_string(id) + "," + std::to_string(15.0 + (id % 20) * 0.5);
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    static const std::string NAME = "Main";
+    static const Colour COL = COL_BLU;
+
+    std::chrono::milliseconds runTime = 1500ms;
+    if (argc > 1)
+    {
+        try
+        {
+            runTime = std::chrono::milliseconds(std::stoi(argv[1]));
+        }
+        catch (const std::exception &)
+        {
+            LOG(COL_RED, "ERROR", "Invalid run time: " << argv[1]);
+        }
+    }
+
+    // All three steps, one after another, on this thread
+    {
+        static const int LINES = 200;
+        std::vector<std::string> written;
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < LINES; ++i)
+        {
+            written.push_back(format(transform(parse(makeLine(i)))));
+        }
+        const double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        LOG(COL, NAME, "Serially, " << LINES << " lines took " <<
+            static_cast<int>(seconds * 1000) << " ms, " <<
+            static_cast<int>(LINES / seconds) << " lines per second");
+    }
+
+    // The same steps as a pipeline, with workers for each
+    std::vector<std::string> written;
+    int sent = 0;
+    {
+        Pipeline pipeline(64, 16);
+        Pipeline::Link<std::string> &lines = pipeline.source<std::string>();
+        Pipeline::Link<Record> &records = pipeline.stage("Parse", lines, 2, parse);
+        Pipeline::Link<Record> &results = pipeline.stage("Transform", records, 6, transform);
+        // A single writer, so the output needs no lock of its own
+        pipeline.sink("Write", results, 1, [&written](Record &&record) {
+            written.push_back(format(record));
+        });
+        LOG(COL, NAME, "Running the pipeline for " << runTime.count() << " ms");
+
+        const StatsDumper dumper(500ms, [&pipeline]() {
+            for (const Pipeline::StageStats &stats : pipeline.stats())
+            {
+                LOG(COL_CYN, "Stats", stats.summary());
+            }
+        });
+
+        std::jthread source([&lines, &sent](std::stop_token token) {
+            while (!token.stop_requested() && lines.send(makeLine(sent), token))
+            {
+                ++sent;
+            }
+            LOG(COL_GRN, "Source", "Stopped after sending " << sent << " lines");
+        });
+
+        std::this_thread::sleep_for(runTime);
+        LOG(COL, NAME, "Stopping the source, then draining the pipeline");
+        source.request_stop();
+        source.join();
+        const auto draining = std::chrono::steady_clock::now();
+        pipeline.drain();
+        LOG(COL, NAME, "Drained in " << std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - draining).count() << " ms");
+        for (const Pipeline::StageStats &stats : pipeline.stats())
+        {
+            LOG(COL_YLW, "Final", stats.summary());
+        }
+    }
+    LOG(COL, NAME, "Sent " << sent << " lines, wrote " << written.size());
+
+    LOG(COL, NAME, "About to leave the main thread");
+    return 0;
+}
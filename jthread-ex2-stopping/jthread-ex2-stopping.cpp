@@ -10,67 +10,47 @@
 
 #include <thread>
 #include <chrono>
-#include <iostream>
-#include <sstream>
+#include <string>
 
-using namespace std::chrono_literals;
-
-/// @brief  The colour code prefix
-static const std::string COL_PRE = "\033[1;";
-/// @brief  The colour code suffix
-static const std::string COL_SUF = "m";
-/// @brief  Colour code to return to normal
-static const std::string COL_NORM = "\033[0m";
-
-/// @brief  Value to set the terminal text red
-static const int COL_RED = 31;
-/// @brief  Value to set the terminal text green
-static const int COL_GRN = 32;
-/// @brief  Value to set the terminal text blue
-static const int COL_BLU = 34;
-/// @brief  Value to set the terminal text magenta
-static const int COL_MAG = 35;
-
-/// @brief  Helper function to get the colour string so that it does not get
-///         flushed to the terminal before it has been combined.
-std::string getColour(int col)
-{
-    std::stringstream ss;
-    ss << COL_PRE << std::to_string(col) << COL_SUF;
-    return ss.str();
-}
-
-/// @brief  Provides a standardised log message with colour
-#define LOG(col, name, msg)     std::cout << getColour(col) << name << ": " << \
-                                msg << COL_NORM << std::endl;
+#include "../common/async-log.h"
+#include "../common/colour.h"
+#include "../common/interruptible-sleep.h"
+#include "../common/trace.h"
 
-/// @brief  Prints a coloured dot to screen, indicating a thread is still
-///         running.
-#define DOT(col)        std::cout << getColour(col) << "." << COL_NORM << \
-                        std::flush;
+using namespace std::chrono_literals;
 
 /// @brief  A function that takes in a stop_token from the jthread, and three 
 ///         user arguments. This function observes the stop_token to exit 
 ///         politely.
 ///         Until it receives a stop signal, it will continue running.
+///         The stop also interrupts the delay, so the thread leaves
+///         promptly however long the delay is.
 /// @param  token       The stop token for this thread
 /// @param  foreground  Foreground colour for disambiguation
 /// @param  name        The name given to this action
 /// @param  delay       The time between stop checks and dot prints
 static void interruptibleArgs(std::stop_token token,
-    const int foreground,
+    const Colour foreground,
     const std::string name,
     const std::chrono::milliseconds delay
 )
 {
+    TRACE_THREAD(name);
+    TRACE_SCOPE("Running");
+    // Records the time that a stop is requested, to show how quickly the
+    // thread responds
+    const StopLatency latency(token);
     LOG(foreground, name, "Starting thread until stopped.");
     while (!token.stop_requested())
     {
         DOT(foreground);
-        std::this_thread::sleep_for(delay);
+        // Unlike std::this_thread::sleep_for(), this returns as soon as a
+        // stop is requested, rather than once the delay has passed.
+        interruptibleSleep(token, delay);
     }
     
-    LOG(foreground, name, "Leaving thread.");
+    LOG(foreground, name, "Leaving thread, " << latency.elapsed().count() <<
+        " us after the stop request.");
 }
 
 /// @brief  A function that takes only the jthread's stop_token.
@@ -82,9 +62,12 @@ static void interruptible(std::stop_token token)
 }
 
 /// @brief  Main
-int main(int argc, char** argv)
+int main()
 {
     static const std::string NAME = "Main";
+    // When built with THREAD_TRACE, saves the thread lifecycle events on exit
+    TRACE_SAVE_ON_EXIT("ex2-trace.json");
+    TRACE_THREAD(NAME);
     // Runs the function without arguments - this will print a dot to screen in
     // a default colour until stopped.
     std::jthread iThread(interruptible);
@@ -112,6 +95,7 @@ int main(int argc, char** argv)
     if (iThread.get_stop_token().stop_possible())
     {
         LOG(COL_BLU, NAME, "Stopping the parameterless thread");
+        TRACE("request_stop");
         iThread.request_stop();
     }
 
@@ -121,6 +105,7 @@ int main(int argc, char** argv)
     if (iThreadQuick.get_stop_token().stop_possible())
     {
         LOG(COL_BLU, NAME, "Stopping the quick red thread");
+        TRACE("request_stop");
         iThreadQuick.request_stop();
     }
 
@@ -130,6 +115,7 @@ int main(int argc, char** argv)
     if (iThreadSlow.get_stop_token().stop_possible())
     {
         LOG(COL_BLU, NAME, "Stopping the slow green thread");
+        TRACE("request_stop");
         iThreadSlow.request_stop();
     }
 
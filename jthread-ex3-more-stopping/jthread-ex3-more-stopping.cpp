@@ -12,44 +12,15 @@
 
 #include <thread>
 #include <chrono>
-#include <iostream>
-#include <sstream>
+#include <string>
+#include <string_view>
 
-using namespace std::chrono_literals;
-
-/// @brief  The colour code prefix
-static const std::string COL_PRE = "\033[1;";
-/// @brief  The colour code suffix
-static const std::string COL_SUF = "m";
-/// @brief  Colour code to return to normal
-static const std::string COL_NORM = "\033[0m";
-
-/// @brief  Value to set the terminal text red
-static const int COL_RED = 31;
-/// @brief  Value to set the terminal text green
-static const int COL_GRN = 32;
-/// @brief  Value to set the terminal text blue
-static const int COL_BLU = 34;
-/// @brief  Value to set the terminal text magenta
-static const int COL_MAG = 35;
-
-/// @brief  Helper function to get the colour string so that it does not get
-///         flushed to the terminal before it has been combined.
-std::string getColour(int col)
-{
-    std::stringstream ss;
-    ss << COL_PRE << std::to_string(col) << COL_SUF;
-    return ss.str();
-}
-
-/// @brief  Provides a standardised log message with colour
-#define LOG(col, name, msg)     std::cout << getColour(col) << name << ": " << \
-                                msg << COL_NORM << std::endl;
+#include "../common/async-log.h"
+#include "../common/colour.h"
+#include "../common/interruptible-sleep.h"
+#include "../common/trace.h"
 
-/// @brief  Prints a coloured dot to screen, indicating a thread is still
-///         running.
-#define DOT(col)        std::cout << getColour(col) << "." << COL_NORM << \
-                        std::flush;
+using namespace std::chrono_literals;
 
 /// @brief  A function that takes in a stop_token from the jthread, and three
 ///         user arguments. This function observes the stop_token to exit
@@ -57,52 +28,66 @@ std::string getColour(int col)
 ///         Until it receives a stop signal, it will continue running.
 ///
 ///         When stopped, this method will use a std::stop_callback to
-///         calculate the approximate run time of the thread.
+///         calculate the approximate run time of the thread, and on leaving,
+///         reports how long it took to respond to the stop.
 ///
 /// @param  token       The stop token for this thread
 /// @param  foreground  Foreground colour for disambiguation
 /// @param  name        The name given to this action
 /// @param  delay       The time between stop checks and dot prints
 static void worker(std::stop_token token,
-    const int foreground,
+    const Colour foreground,
     const std::string name,
     const std::chrono::milliseconds delay
 )
 {
+    TRACE_THREAD(name);
+    TRACE_SCOPE("Running");
     auto start = std::chrono::system_clock::now();
+    const StopLatency latency(token);
     LOG(foreground, name, "Starting thread until stopped.");
 
     // Here we have a callback within the thread function, which will
     // take in local parameters and print some information to the
-    // terminal.
-    std::stop_callback cb(token, [foreground, name, start]() {
+    // terminal. The callback never outlives this function, so it can refer
+    // to the name rather than copying it, and the suffix is streamed after
+    // it rather than building a new string.
+    std::stop_callback cb(token, [foreground, name = std::string_view(name), start]() {
+        TRACE("stop_callback");
         const std::chrono::milliseconds duration =
             std::chrono::duration_cast<std::chrono::milliseconds>
                 (std::chrono::system_clock::now() - start);
-        LOG(foreground, name + "_CB", "Thread terminated after: " <<
+        LOG(foreground, name << "_CB", "Thread terminated after: " <<
             duration.count() << " ms");
     });
     while (!token.stop_requested())
     {
         DOT(foreground);
-        std::this_thread::sleep_for(delay);
+        // Unlike std::this_thread::sleep_for(), this returns as soon as a
+        // stop is requested, rather than once the delay has passed.
+        interruptibleSleep(token, delay);
     }
 
-    LOG(foreground, name, "Leaving thread.");
+    LOG(foreground, name, "Leaving thread, " << latency.elapsed().count() <<
+        " us after the stop request.");
 }
 
 /// @brief  Main
-int main(int argc, char** argv)
+int main()
 {
     static const std::string NAME = "Main";
-    static const int COL = COL_BLU;
+    static const Colour COL = COL_BLU;
+    // When built with THREAD_TRACE, saves the thread lifecycle events on exit
+    TRACE_SAVE_ON_EXIT("ex3-trace.json");
+    TRACE_THREAD(NAME);
 
     // Runs the function with arguments. This will display frequent red dots
     // until stopped.
     std::jthread iThreadQuick(worker, COL_RED, "Quick Red Thread", 25ms);
     // Callback added here, acted upon when the thread above is stopped
     std::stop_callback quickCallback(iThreadQuick.get_stop_token(), []() {
-            LOG(COL, NAME + "_CB", ">> Stop callback triggered from the quick thread <<");
+            TRACE("stop_callback");
+            LOG(COL, NAME << "_CB", ">> Stop callback triggered from the quick thread <<");
         }
     );
 
@@ -122,6 +107,7 @@ int main(int argc, char** argv)
     if (iThreadQuick.get_stop_token().stop_possible())
     {
         LOG(COL, NAME, "Stopping the quick red thread");
+        TRACE("request_stop");
         iThreadQuick.request_stop();
     }
 
@@ -133,6 +119,7 @@ int main(int argc, char** argv)
     if (iThreadSlow.get_stop_token().stop_possible())
     {
         LOG(COL, NAME, "Stopping the slow green thread");
+        TRACE("request_stop");
         iThreadSlow.request_stop();
     }
 
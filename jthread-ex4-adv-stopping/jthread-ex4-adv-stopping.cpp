@@ -4,6 +4,8 @@
  * @brief   Example using condition variables to terminate a blocking call
  *          within a std::jthread. This example is roughly based on the previous
  *          with some modifications.
+ *          A third thread is given a deadline, and gives up waiting once it
+ *          passes, neither released by its data nor stopped.
  *
  * @author  Kris Dunning (kris.dunning@itdev.co.uk)
  * @date    2022
@@ -11,50 +13,23 @@
 
 #include <thread>
 #include <chrono>
-#include <iostream>
-#include <sstream>
+#include <string>
 #include <mutex>
 #include <condition_variable>
 
-using namespace std::chrono_literals;
+#include "../common/async-log.h"
+#include "../common/colour.h"
+#include "../common/trace.h"
 
-/// @brief  The colour code prefix
-static const std::string COL_PRE = "\033[1;";
-/// @brief  The colour code suffix
-static const std::string COL_SUF = "m";
-/// @brief  Colour code to return to normal
-static const std::string COL_NORM = "\033[0m";
-
-/// @brief  Value to set the terminal text red
-static const int COL_RED = 31;
-/// @brief  Value to set the terminal text green
-static const int COL_GRN = 32;
-/// @brief  Value to set the terminal text blue
-static const int COL_BLU = 34;
-/// @brief  Value to set the terminal text magenta
-static const int COL_MAG = 35;
-
-/// @brief  Helper function to get the colour string so that it does not get
-///         flushed to the terminal before it has been combined.
-std::string getColour(int col)
-{
-    std::stringstream ss;
-    ss << COL_PRE << std::to_string(col) << COL_SUF;
-    return ss.str();
-}
-
-/// @brief  Provides a standardised log message with colour
-#define LOG(col, name, msg)     std::cout << getColour(col) << name << ": " << \
-                                msg << COL_NORM << std::endl;
+using namespace std::chrono_literals;
 
-/// @brief  Prints a coloured dot to screen, indicating a thread is still
-///         running.
-#define DOT(col)        std::cout << getColour(col) << "." << COL_NORM << \
-                        std::flush;
+/// @brief  The deadline of a worker that waits for as long as it takes
+static constexpr std::chrono::steady_clock::time_point NO_DEADLINE =
+    std::chrono::steady_clock::time_point::max();
 
 /// @brief  Function that waits for a value to be updated before continuing.
-///         Until it receives a stop signal, or the data has been signalled
-///         as done, it will continue waiting.
+///         Until it receives a stop signal, the data has been signalled as
+///         done, or the deadline passes, it will continue waiting.
 /// 
 /// @param  token       The stop token for this thread
 /// @param  foreground  Foreground colour for disambiguation
@@ -62,33 +37,49 @@ std::string getColour(int col)
 /// @param  mutex       The data mutex (protecting "blockingRes" value)
 /// @param  cv          Condition variable to check for changes
 /// @param  blockingRes Reference to the blocking data being processed
+/// @param  deadline    When to give up waiting, never if NO_DEADLINE
 static void blockingWorker(std::stop_token token,
-    const int foreground,
+    const Colour foreground,
     const std::string name,
     std::mutex &mutex,
     std::condition_variable &cv,
-    bool &blockingRes
+    bool &blockingRes,
+    const std::chrono::steady_clock::time_point deadline
 )
 {
+    TRACE_THREAD(name);
+    TRACE_SCOPE("Running");
     LOG(foreground, name, "Starting thread until data ready or stopped.");
 
     // Here we have a callback within the thread function, which will
     // break free from the condition_variable's wait.
     std::stop_callback cb(token, [foreground, name, &cv]() {
+            TRACE("stop_callback");
             LOG(foreground, name + "_CB", "Thread terminating...");
             cv.notify_all();
         }
     );
     bool done = false;
+    bool timedOut = false;
     do
     {
         DOT(foreground);
         std::unique_lock lock(mutex);
-        cv.wait(lock, [&]() {
+        const auto ready = [&]() {
             return (done = blockingRes) || token.stop_requested();
-        });
-        LOG(foreground, name, "Token: " << token.stop_requested() << " | Data: " << done);
-    } while (!token.stop_requested() && !done);
+        };
+        if (deadline == NO_DEADLINE)
+        {
+            cv.wait(lock, ready);
+        }
+        else
+        {
+            // Returns false once the deadline has passed without either
+            timedOut = !cv.wait_until(lock, deadline, ready);
+        }
+        LOG(foreground, name, "Token: " << token.stop_requested() << " | Data: " << done <<
+            " | Timed out: " << timedOut);
+    } while (!token.stop_requested() && !done && !timedOut);
 
     LOG(foreground, name, "Leaving thread.");
 }
@@ -98,22 +89,26 @@ static void blockingWorker(std::stop_token token,
 /// @param  col         The colour to print log messages in
 /// @param  name        The name of the calling thread
 /// @param  thrName     The name of the thread to be closed
-static void stopThread(std::jthread& jt, int col, 
+static void stopThread(std::jthread& jt, Colour col, 
     const std::string &name, const std::string &thrName
 )
 {
     if (jt.get_stop_token().stop_possible())
     {
         LOG(col, name, "Stopping thread: " << thrName);
+        TRACE("request_stop");
         jt.request_stop();
     }
 }
 
 /// @brief  Main
-int main(int argc, char** argv)
+int main()
 {
     static const std::string NAME = "Main";
-    static const int COL = COL_BLU;
+    static const Colour COL = COL_BLU;
+    // When built with THREAD_TRACE, saves the thread lifecycle events on exit
+    TRACE_SAVE_ON_EXIT("ex4-trace.json");
+    TRACE_THREAD(NAME);
 
     /*
      * Thread to be stopped via "unblocking" data
@@ -124,7 +119,8 @@ int main(int argc, char** argv)
     bool dataRelData = false;
     // Start the thread
     std::jthread dataRelThread(blockingWorker, COL_RED, DATA_RELEASE_THREAD_NAME,
-        std::ref(dataRelThrMutex), std::ref(dataRelThrCv), std::ref(dataRelData));
+        std::ref(dataRelThrMutex), std::ref(dataRelThrCv), std::ref(dataRelData),
+        NO_DEADLINE);
 
     // Slight sleep to allow the thread thread to print to screen before the
     // next thread starts.
@@ -139,7 +135,8 @@ int main(int argc, char** argv)
     bool manRelData = false;
     // Start the thread
     std::jthread manRelThread(blockingWorker, COL_GRN, MAN_STOP_THREAD_NAME,
-        std::ref(manRelThrMutex), std::ref(manRelThrCv), std::ref(manRelData));
+        std::ref(manRelThrMutex), std::ref(manRelThrCv), std::ref(manRelData),
+        NO_DEADLINE);
 
     // Add a delay allowing each thread to run for a few seconds
     std::this_thread::sleep_for(3s);
@@ -150,6 +147,7 @@ int main(int argc, char** argv)
     {
         std::lock_guard lock(dataRelThrMutex);
         dataRelData = true;
+        TRACE("Data released");
         dataRelThrCv.notify_all();
     }
 
@@ -160,7 +158,22 @@ int main(int argc, char** argv)
     LOG(COL, NAME, "Stopping " << MAN_STOP_THREAD_NAME);
     stopThread(manRelThread, COL, NAME, MAN_STOP_THREAD_NAME);
 
-    // Note - there's no need to join any of the threads
+    /*
+     * Thread that gives up waiting at its deadline, without being released
+     * or stopped
+     */
+    const std::string TIMEOUT_THREAD_NAME = "Timed Out Yellow";
+    std::mutex timeoutThrMutex;
+    std::condition_variable timeoutThrCv;
+    bool timeoutData = false;
+    LOG(COL, NAME, "Starting " << TIMEOUT_THREAD_NAME << " with a deadline 1s away");
+    std::jthread timeoutThread(blockingWorker, COL_YLW, TIMEOUT_THREAD_NAME,
+        std::ref(timeoutThrMutex), std::ref(timeoutThrCv), std::ref(timeoutData),
+        std::chrono::steady_clock::now() + 1s);
+    timeoutThread.join();
+    TRACE("Joined");
+
+    // Note - there's no need to join the other threads
 
     LOG(COL, NAME, "About to leave the main thread");
     return 0;
@@ -5,6 +5,9 @@
  *          Within this example, there is both an interruptable and
  *          uninterruptable version, and uses of std::stop_callback to trigger
  *          actions.
+ *          The thread is a RecycledThread, which behaves as a std::jthread but
+ *          runs on a parked thread from a cache where there is one, so that
+ *          restarting the worker does not create and tear down a thread.
  *
  * @author  Kris Dunning (kris.dunning@itdev.co.uk)
  * @date    2022
@@ -12,45 +15,16 @@
 
 #include <thread>
 #include <chrono>
-#include <iostream>
-#include <sstream>
+#include <string>
 #include <functional>
 
-using namespace std::chrono_literals;
-
-/// @brief  The colour code prefix
-static const std::string COL_PRE = "\033[1;";
-/// @brief  The colour code suffix
-static const std::string COL_SUF = "m";
-/// @brief  Colour code to return to normal
-static const std::string COL_NORM = "\033[0m";
-
-/// @brief  Value to set the terminal text red
-static const int COL_RED = 31;
-/// @brief  Value to set the terminal text green
-static const int COL_GRN = 32;
-/// @brief  Value to set the terminal text blue
-static const int COL_BLU = 34;
-/// @brief  Value to set the terminal text magenta
-static const int COL_MAG = 35;
-
-/// @brief  Helper function to get the colour string so that it does not get
-///         flushed to the terminal before it has been combined.
-std::string getColour(int col)
-{
-    std::stringstream ss;
-    ss << COL_PRE << std::to_string(col) << COL_SUF;
-    return ss.str();
-}
-
-/// @brief  Provides a standardised log message with colour
-#define LOG(col, name, msg)     std::cout << getColour(col) << name << ": " << \
-                                msg << COL_NORM << std::endl;
+#include "../common/async-log.h"
+#include "../common/callback-slab.h"
+#include "../common/colour.h"
+#include "../common/thread-cache.h"
+#include "../common/trace.h"
 
-/// @brief  Prints a coloured dot to screen, indicating a thread is still
-///         running.
-#define DOT(col)        std::cout << getColour(col) << "." << COL_NORM << \
-                        std::flush;
+using namespace std::chrono_literals;
 
 /// @brief  Simple class that uses a std::jthread to operate simple actions
 class SimpleWorkerThrad
@@ -60,7 +34,7 @@ public:
     /// @param  name            The name of the thread
     /// @param  colour          The colour to be used for logging
     /// @param  interruptable   Whether  interruptable or uninterruptable
-    SimpleWorkerThrad(const std::string &name, const int colour,
+    SimpleWorkerThrad(const std::string &name, const Colour colour,
         const bool interruptable)
     : mName(name)
     , mColour(colour)
@@ -75,16 +49,18 @@ public:
         stop();
     }
 
-    /// @brief  Starts the thread in the correct mode
+    /// @brief  Starts the thread in the correct mode. Each worker is given
+    ///         its run's stop token, as a parked thread may start it before
+    ///         mThread has been assigned, so it must never read mThread.
     void start()
     {
         if (mInterruptable)
         {
-            mThread = std::jthread(&SimpleWorkerThrad::interruptableWorker, this);
+            mThread = RecycledThread(std::bind_front(&SimpleWorkerThrad::interruptableWorker, this));
         }
         else
         {
-            mThread = std::jthread(&SimpleWorkerThrad::uninterruptableWorker, this);
+            mThread = RecycledThread(std::bind_front(&SimpleWorkerThrad::uninterruptableWorker, this));
         }
     }
 
@@ -94,10 +70,12 @@ public:
     {
         if (mThread.get_stop_token().stop_possible())
         {
+            TRACE("request_stop");
             mThread.request_stop();
             if (block)
             {
                 mThread.join();
+                TRACE("Joined");
             }
         }
     }
@@ -108,19 +86,24 @@ public:
         if (mThread.joinable())
         {
             mThread.join();
+            TRACE("Joined");
         }
     }
 
-    /// @brief  Short-hand name for the lamda provided for callback
-    using Callback = std::function<void(void)>;
+    /// @brief  The most stop callbacks that can be added at once
+    static constexpr std::size_t MAX_CALLBACKS = 4;
+    /// @brief  Deregisters a callback from addCallback() when destroyed
+    using CallbackHandle = CallbackSlab<MAX_CALLBACKS>::Handle;
 
-    /// @brief  Adds a stop_callback as requested
+    /// @brief  Adds a stop_callback as requested. The callback is held within
+    ///         this object rather than on the heap, and must be released, by
+    ///         destroying the handle, before this object is destroyed.
     /// @param cb   The callback to be triggered when stop is requested
-    /// @returns    Pointer to the new stop_callback
-    std::stop_callback<Callback> *addCallback(Callback cb)
+    /// @returns    Handle owning the new stop_callback
+    template<typename F>
+    [[nodiscard]] CallbackHandle addCallback(F &&cb)
     {
-        std::stop_callback<Callback> *v = new std::stop_callback<Callback>(mThread.get_stop_token(), cb);
-        return v;
+        return mCallbacks.add(mThread.get_stop_token(), std::forward<F>(cb));
     }
 
 private:
@@ -129,16 +112,18 @@ private:
     ///         stop_token and exits as required. A built-in delay is added
     ///         to demonstrate the delay between requesting a stop and the
     ///         thread stopping, i.e. when calling stop() as a blocking call.
-    void interruptableWorker()
+    /// @param  token   The stop token for this run of the thread
+    void interruptableWorker(const std::stop_token &token)
     {
+        TRACE_THREAD(mName);
+        TRACE_SCOPE("Running");
         LOG(mColour, mName, "Starting interruptable worker");
-        const std::stop_token &token = mThread.get_stop_token();
         while (!token.stop_requested())
         {
             DOT(mColour);
             std::this_thread::sleep_for(100ms);
         }
-        std::cout << std::endl;
+        NEWLINE();
         // Slight delay to show that stopping with block set
         LOG(mColour, mName, "Adding delierate pause...");
         std::this_thread::sleep_for(1s);
@@ -148,33 +133,42 @@ private:
     /// @brief  Worker for an uninterruptable thread. This simply runs until
     ///         completion. This is a very rare option, and should ideally be
     ///         replaced by some means of terminating the thread early.
-    void uninterruptableWorker()
+    /// @param  token   The stop token for this run of the thread, which is
+    ///                 only reported on, never acted upon
+    void uninterruptableWorker(const std::stop_token &token)
     {
+        TRACE_THREAD(mName);
+        TRACE_SCOPE("Running");
         LOG(mColour, mName, "Starting uninterruptable worker");
         for (int i = 0; i < 20; ++i) 
         { 
             DOT(mColour);
             std::this_thread::sleep_for(250ms);
         }
-        std::cout << std::endl;
-        LOG(mColour, mName, "Leaving uninterruptable worker: " << mThread.get_stop_token().stop_possible());
+        NEWLINE();
+        LOG(mColour, mName, "Leaving uninterruptable worker: " << token.stop_possible());
     }
 
     /// @brief  The thread name
     const std::string &mName;
     /// @brief  The colour to use in logging
-    const int mColour;
+    const Colour mColour;
     /// @brief  Whether interruptable
     const bool mInterruptable;
-    /// @brief  The underlying thread object
-    std::jthread mThread;
+    /// @brief  The underlying thread object, with a fresh stop token each run
+    RecycledThread mThread;
+    /// @brief  Inline storage for the callbacks from addCallback()
+    CallbackSlab<MAX_CALLBACKS> mCallbacks;
 };
 
 /// @brief  Main
-int main(int argc, char** argv)
+int main()
 {
     static const std::string NAME = "Main";
-    static const int COL = COL_BLU;
+    static const Colour COL = COL_BLU;
+    // When built with THREAD_TRACE, saves the thread lifecycle events on exit
+    TRACE_SAVE_ON_EXIT("ex5-trace.json");
+    TRACE_THREAD(NAME);
 
     static const std::string UNINT_THREAD_NAME = "Uninterruptable";
     static const std::string INT_1_THREAD_NAME = "Interruptable 1";
@@ -202,12 +196,13 @@ int main(int argc, char** argv)
     interruptableThread_1.start();
     // Trigger the start of the second thread based on the first
     auto lambda = [&interruptableThread_2]() {
+        TRACE("stop_callback");
         LOG(COL, NAME, "Callback triggered to start second thread");
         interruptableThread_2.start();
     };
-    std::unique_ptr<std::stop_callback<SimpleWorkerThrad::Callback>> cb(
-        interruptableThread_1.addCallback(lambda)
-    );
+    // The handle keeps the callback registered until it goes out of scope
+    SimpleWorkerThrad::CallbackHandle cb =
+        interruptableThread_1.addCallback(lambda);
     
 
     // Allow the first thread to run for a few seconds
@@ -4,6 +4,19 @@
  * @brief   Example using a class to show more thorough std::jthread examples.
  *          Within this example, a class is created and used to control a 
  *          std::jthread, allowing full control over terminating the thread.
+ *          The data is held in a DataSignal, which for simple types such as
+ *          bool and int is a lock-free std::atomic, so that setting a value
+ *          that does not complete the task neither locks nor wakes the worker.
+ *          The condition that completes the task is a template parameter
+ *          rather than a virtual method, so it is inlined into the wait, and a
+ *          target known at compile time can be a template parameter itself.
+ *          The thread is a RecycledThread, taking the same arguments as a
+ *          std::jthread, but reusing a parked thread from a cache for each
+ *          start, with a fresh stop token for every run.
+ *          A worker may be started with a deadline, past which it gives up
+ *          waiting for its data, and stopped with a deadline of its own, so
+ *          that a caller learns when a worker fails to stop in time, and may
+ *          escalate, rather than blocking on it.
  *
  * @author  Kris Dunning (kris.dunning@itdev.co.uk)
  * @date    2022
@@ -11,55 +24,30 @@
 
 #include <thread>
 #include <chrono>
-#include <iostream>
-#include <sstream>
+#include <string>
 #include <functional>
-#include <mutex>
-#include <condition_variable>
+#include <concepts>
 
-using namespace std::chrono_literals;
-
-/// @brief  The colour code prefix
-static const std::string COL_PRE = "\033[1;";
-/// @brief  The colour code suffix
-static const std::string COL_SUF = "m";
-/// @brief  Colour code to return to normal
-static const std::string COL_NORM = "\033[0m";
-
-/// @brief  Value to set the terminal text red
-static const int COL_RED = 31;
-/// @brief  Value to set the terminal text green
-static const int COL_GRN = 32;
-/// @brief  Value to set the terminal text blue
-static const int COL_BLU = 34;
-/// @brief  Value to set the terminal text magenta
-static const int COL_MAG = 35;
-/// @brief  Value to set the terminal text yellow
-static const int COL_YLW = 33;
-
-/// @brief  Helper function to get the colour string so that it does not get
-///         flushed to the terminal before it has been combined.
-std::string getColour(int col)
-{
-    std::stringstream ss;
-    ss << COL_PRE << std::to_string(col) << COL_SUF;
-    return ss.str();
-}
-
-/// @brief  Provides a standardised log message with colour
-#define LOG(col, name, msg)     std::cout << getColour(col) << name << ": " << \
-                                msg << COL_NORM << std::endl;
+#include "../common/async-log.h"
+#include "../common/callback-slab.h"
+#include "../common/colour.h"
+#include "../common/data-signal.h"
+#include "../common/thread-cache.h"
+#include "../common/trace.h"
 
-/// @brief  Prints a coloured dot to screen, indicating a thread is still
-///         running.
-#define DOT(col)        std::cout << getColour(col) << "." << COL_NORM << \
-                        std::flush;
+using namespace std::chrono_literals;
 
-/// @brief  Short-hand name for the lamda provided for callback
-using Callback = std::function<void(void)>;
+/// @brief  A condition that completes a worker's task, called with its data
+template<typename Complete, typename T>
+concept Completion = std::predicate<const Complete &, const T &>;
 
 /// @brief  Class that uses a std::jthread to operate stoppable actions
-template<typename T>
+/// @tparam T           The type of the thread data
+/// @tparam Complete    Indicates whether the data completes the task. As this
+///                     may be called from the thread calling setData() as
+///                     well as the worker, it must only examine the value
+///                     passed in.
+template<typename T, Completion<T> Complete>
 class WorkerThread
 {
 public:
@@ -67,16 +55,19 @@ public:
     /// @param  name            The name of the thread
     /// @param  colour          The colour to be used for logging
     /// @param  defaultValue    The default value
-    WorkerThread(const std::string &name, const int colour, T defaultValue)
+    /// @param  complete        The condition completing the task
+    WorkerThread(const std::string &name, const Colour colour,
+        T defaultValue = T(), Complete complete = Complete())
         : mName(name)
         , mColour(colour)
+        , mComplete(std::move(complete))
         , mData(defaultValue)
     {
         LOG(mColour, mName, "Constructed");
     }
 
     /// @brief  Destructor
-    virtual ~WorkerThread()
+    ~WorkerThread()
     {
         stop();
     }
@@ -84,8 +75,12 @@ public:
     /// @brief  Starts the thread in the correct mode
     /// NOTE:   Because we are passing an argument into the worker thread,
     ///         we need to bind the method.
-    void start()
+    /// @param  deadline    When the worker gives up waiting for the data to
+    ///                     complete its task, never by default
+    void start(std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::time_point::max())
     {
+        // A RecycledThread takes the same arguments as a std::jthread.
         // For reference, if starting a thread with additional parameters,
         // they would be set after the std::bind_front() call, e.g.
         // std::jthread(std::bind_front(&ClassName::MethodName, this), anInt, aStr);
@@ -93,7 +88,7 @@ public:
         // The signature for the bound method would be either:
         // void MethodName(std::stop_token, int, std::string) or 
         // void MethodName(int, std::string) or 
-        mThread = std::jthread(std::bind_front(&WorkerThread::worker, this));
+        mThread = RecycledThread(std::bind_front(&WorkerThread::worker, this), deadline);
     }
 
     /// @brief  Stops the thread, blocking if requested
@@ -102,21 +97,53 @@ public:
     {
         if (mThread.get_stop_token().stop_possible())
         {
+            TRACE("request_stop");
             mThread.request_stop();
             if (block)
             {
                 mThread.join();
+                TRACE("Joined");
             }
         }
     }
 
-    /// @brief  Adds a stop_callback as requested
+    /// @brief  Stops the thread, waiting for it only until the deadline, so
+    ///         that a worker slow to stop cannot hold up the caller for long
+    /// @param  deadline    When to give up waiting for the thread
+    /// @returns    True if the thread has stopped and been joined, false if
+    ///             it was still running at the deadline, leaving the caller
+    ///             to escalate, or to join it later
+    bool stopUntil(std::chrono::steady_clock::time_point deadline)
+    {
+        if (!mThread.joinable())
+        {
+            return true;
+        }
+        TRACE("request_stop");
+        mThread.request_stop();
+        if (!mThread.try_join_until(deadline))
+        {
+            TRACE("Stop timed out");
+            return false;
+        }
+        TRACE("Joined");
+        return true;
+    }
+
+    /// @brief  The most stop callbacks that can be added at once
+    static constexpr std::size_t MAX_CALLBACKS = 4;
+    /// @brief  Deregisters a callback from addCallback() when destroyed
+    using CallbackHandle = CallbackSlab<MAX_CALLBACKS>::Handle;
+
+    /// @brief  Adds a stop_callback as requested. The callback is held within
+    ///         this object rather than on the heap, and must be released, by
+    ///         destroying the handle, before this object is destroyed.
     /// @param cb   The callback to be triggered when stop is requested
-    /// @returns    Pointer to the new stop_callback
-    std::stop_callback<Callback> *addCallback(Callback cb)
+    /// @returns    Handle owning the new stop_callback
+    template<typename F>
+    [[nodiscard]] CallbackHandle addCallback(F &&cb)
     {
-        std::stop_callback<Callback> *v = new std::stop_callback<Callback>(mThread.get_stop_token(), cb);
-        return v;
+        return mCallbacks.add(mThread.get_stop_token(), std::forward<F>(cb));
     }
 
     /// @brief  Joins the thread, if it is running
@@ -125,6 +152,7 @@ public:
         if (mThread.joinable())
         {
             mThread.join();
+            TRACE("Joined");
         }
     }
 
@@ -135,9 +163,7 @@ public:
     {
         if (mThread.joinable() && !mThread.get_stop_token().stop_requested())
         {
-            std::lock_guard lock(mMutex);
-            mData = data;
-            mCv.notify_all();
+            mData.set(data, mComplete);
         }
     }
 
@@ -147,101 +173,98 @@ protected:
     ///         stop_token and exits as required. A built-in delay is added
     ///         to demonstrate the delay between requesting a stop and the
     ///         thread stopping, i.e. when calling stop() as a blocking call.
-    void worker(const std::stop_token &token)
+    /// @param  token       The stop token associated with this thread
+    /// @param  deadline    When to give up waiting for the data
+    void worker(const std::stop_token &token, std::chrono::steady_clock::time_point deadline)
     {
+        TRACE_THREAD(mName);
+        TRACE_SCOPE("Running");
         LOG(mColour, mName, "Starting worker");
-        // Signal the condition variable to check the current conditions
-        std::stop_callback stop(token, [&]() { mCv.notify_all(); });
         bool done = false;
-        while (!token.stop_requested() && !done)
+        bool timedOut = false;
+        while (!token.stop_requested() && !done && !timedOut)
         {
             DOT(mColour);
-            std::unique_lock lock(mMutex);
-            mCv.wait(lock, [&]() {
-                return (done = taskComplete()) || token.stop_requested();
-            });
+            // Returns once the data completes the task, a stop is requested,
+            // or the deadline passes
+            done = mData.waitUntil(token, deadline, mComplete);
+            timedOut = !done && !token.stop_requested();
             LOG(mColour, mName, "Token: " << token.stop_requested() <<
-                " | Data: " << done);
+                " | Data: " << done << " | Timed out: " << timedOut);
         }
-        std::cout << std::endl;
+        NEWLINE();
         LOG(mColour, mName, "Leaving worker");
     }
 
-    /// @brief  Abstract method, used to indicate whether the thread is complete
-    virtual bool taskComplete() = 0;
-
     /// @brief  The thread name
     const std::string &mName;
     /// @brief  The colour to use in logging
-    const int mColour;
-    /// @brief  The underlying thread object
-    std::jthread mThread;
-    /// @brief  Mutex used to protect the data value
-    std::mutex mMutex;
-    /// @brief  Condition variable used to signal when the thread data changes
-    std::condition_variable mCv;
-    /// @brief  The thread data
-    T mData;
+    const Colour mColour;
+    /// @brief  The condition completing the task
+    [[no_unique_address]] const Complete mComplete;
+    /// @brief  The underlying thread object, with a fresh stop token each run
+    RecycledThread mThread;
+    /// @brief  Inline storage for the callbacks from addCallback()
+    CallbackSlab<MAX_CALLBACKS> mCallbacks;
+    /// @brief  The thread data, and the means of waiting for it
+    DataSignal<T> mData;
 };
 
-/// @brief  Special worker class expecting the data to be true before finishing
-class BoolWorkerThread : public WorkerThread<bool>
+/// @brief  Completes the task once the data is true
+struct IsTrue
 {
-public:
-    /// @brief  Constructor
-    /// @param  name            The name of the thread
-    /// @param  colour          The colour to be used for logging
-    BoolWorkerThread(const std::string &name, const int colour)
-    : WorkerThread(name, colour, false)
-    {}
-
-protected:
-
-    /// @brief  Indicates whether the task is complete
-    /// NOTE: This is thread safe, as its usage is protected by the lock
-    ///       within the thread method's condition variable usage.
-    virtual bool taskComplete() override
+    bool operator()(const bool &data) const
     {
-        return mData;
+        return data;
     }
 };
 
-/// @brief  Special worker class expecting the value to match a target
-class IntWorkerThread : public WorkerThread<int>
+/// @brief  Completes the task once the data matches a target known at compile
+///         time, so the comparison is against a constant
+template<int TARGET>
+struct IsTarget
 {
-public:
-    /// @brief  Constructor
-    /// @param  name            The name of the thread
-    /// @param  colour          The colour to be used for logging
-    /// @param  target          The target value to complete the thread
-    IntWorkerThread(const std::string &name, const int colour, const int target)
-    : WorkerThread(name, colour, 0)
-    , mTarget(target)
+    bool operator()(const int &data) const
     {
+        return data == TARGET;
     }
+};
 
-protected:
-    
-    /// @brief  Indicates whether the task is complete
-    /// NOTE: This is thread safe, as its usage is protected by the lock
-    ///       within the thread method's condition variable usage.
-    virtual bool taskComplete() override
+/// @brief  Completes the task once the data matches a target chosen at run
+///         time
+struct MatchesTarget
+{
+    bool operator()(const int &data) const
     {
-        return mTarget == mData;
+        return data == target;
     }
 
     /// @brief  The target value to complete the thread
-    const int mTarget;
+    int target;
 };
 
+/// @brief  Special worker class expecting the data to be true before finishing
+using BoolWorkerThread = WorkerThread<bool, IsTrue>;
+
+/// @brief  Special worker class expecting the value to match a fixed target
+template<int TARGET>
+using IntWorkerThread = WorkerThread<int, IsTarget<TARGET>>;
+
+/// @brief  Special worker class expecting the value to match a target given
+///         to its constructor
+using TargetWorkerThread = WorkerThread<int, MatchesTarget>;
+
 
 /// @brief  Main
-int main(int argc, char** argv)
+int main()
 {
     static const std::string NAME = "Main";
-    static const int COL = COL_BLU;
+    static const Colour COL = COL_BLU;
+    // When built with THREAD_TRACE, saves the thread lifecycle events on exit
+    TRACE_SAVE_ON_EXIT("ex6-trace.json");
+    TRACE_THREAD(NAME);
 
-    static const int INT_1_TARGET = 10;
+    static constexpr int INT_1_TARGET = 10;
     static const int INT_2_TARGET = 3;
 
     static const std::string BOOL_1_THREAD_NAME = "Bool Thread 1";
@@ -250,11 +273,15 @@ int main(int argc, char** argv)
         "Target Thread (" + std::to_string(INT_1_TARGET) + ")";
     static const std::string INT_2_THREAD_NAME =
         "Target Thread (" + std::to_string(INT_2_TARGET) + ")";
+    static const std::string DEADLINE_THREAD_NAME = "Deadline Thread";
 
     BoolWorkerThread boolThread1(BOOL_1_THREAD_NAME, COL_GRN);
     BoolWorkerThread boolThread2(BOOL_2_THREAD_NAME, COL_MAG);
-    IntWorkerThread intThread1(INT_1_THREAD_NAME, COL_RED, INT_1_TARGET);
-    IntWorkerThread intThread2(INT_2_THREAD_NAME, COL_YLW, INT_2_TARGET);
+    // The first target is fixed at compile time, the second is not
+    IntWorkerThread<INT_1_TARGET> intThread1(INT_1_THREAD_NAME, COL_RED);
+    TargetWorkerThread intThread2(INT_2_THREAD_NAME, COL_YLW, 0,
+        MatchesTarget{ INT_2_TARGET });
+    BoolWorkerThread deadlineThread(DEADLINE_THREAD_NAME, COL_CYN);
     
     // Start all but the second integer thread with delay between them to
     // prevent messages interrupting
@@ -263,6 +290,9 @@ int main(int argc, char** argv)
     boolThread2.start();
     std::this_thread::sleep_for(10ms);
     intThread1.start();
+    std::this_thread::sleep_for(10ms);
+    // Never given its data, this gives up waiting once its deadline passes
+    deadlineThread.start(std::chrono::steady_clock::now() + 2s);
 
     // Allow all threads to run for a few seconds
     std::this_thread::sleep_for(4s);
@@ -271,18 +301,22 @@ int main(int argc, char** argv)
     boolThread1.setData(true);
 
     // Stop the second bool thread by politely asking it to stop, then
-    // waiting for it before continuing.
-    boolThread2.stop(true);
+    // waiting for it before continuing, though only for so long.
+    if (!boolThread2.stopUntil(std::chrono::steady_clock::now() + 500ms))
+    {
+        LOG(COL, NAME, BOOL_2_THREAD_NAME << " did not stop in time, waiting on");
+        boolThread2.join();
+    }
 
     // Set the stop callback for the first integer thread so that it 
     // triggers the start of the second
     auto lambda = [&intThread2]() {
+        TRACE("stop_callback");
         LOG(COL, NAME, "Starting thread");
         intThread2.start();
     };
-    std::unique_ptr<std::stop_callback<Callback>> startSecond(
-        intThread1.addCallback(lambda)
-    );
+    IntWorkerThread<INT_1_TARGET>::CallbackHandle startSecond =
+        intThread1.addCallback(lambda);
     // Let the first run for a brief while
     std::this_thread::sleep_for(1s);
     intThread1.stop(true);
@@ -8,61 +8,103 @@
  *          This also shows the limitation of this feature, in that threads will
  *          continue even after being told to stop if their condition variable's
  *          predicate conditions are met.
+ *          Passing "steal" as a second argument runs the same pool with a
+ *          queue per worker, allowing idle workers to steal from their peers
+ *          rather than all contending on one mutex, whilst "lockfree" uses a
+ *          single lock-free queue, and "numa" gives each NUMA node a queue
+ *          of its own, allocated on that node, with every worker pinned to the
+ *          CPUs of one node and only stealing from other nodes once its own
+ *          node's queue is empty. A third argument sets the number of items
+ *          each worker takes from the queue at once.
+ *          Each worker also records where its time goes, which is logged for
+ *          every worker at the end, and, given a fourth argument, every that
+ *          many milliseconds while the pool runs.
+ *          The shared queue has priority lanes, with the shortest tasks in the
+ *          most urgent lane so that they are not stuck behind the long ones. A
+ *          fifth argument of "strict" (the default) always serves the most
+ *          urgent lane first, whilst "weighted" shares turns between them. The
+ *          depth of each lane is logged along with the stats.
+ *          A sixth argument sets how idle workers on the shared and stealing
+ *          queues wait for work: "park" (the default) goes straight to the
+ *          condition variable, "spin" always spins and yields briefly first,
+ *          and "adaptive" spins for as long as recent gaps between tasks
+ *          suggest is worthwhile.
+ *          The workers' stop sources are linked below a single StopNode, so
+ *          that the pool is stopped by one request rather than one worker at a
+ *          time, and each task carries a token of its own from a second tree,
+ *          so that a task can be cancelled alone, whether queued or running.
+ *          A seventh argument gives every task a deadline, that many
+ *          milliseconds after it is queued, past which it is dropped unrun by
+ *          whichever worker takes it, rather than tying that worker up with
+ *          work nobody is waiting for any longer. An eighth sets how long the
+ *          extra thread is given to finish the remaining tasks once the pool
+ *          has been stopped, after which the stop is escalated by cancelling
+ *          every task.
+ *          Built with THREAD_TRACE defined, the workers' lifecycles, and each
+ *          task's enqueue and dequeue, are saved to ex7-trace.json on exit.
  *
  * @author  Kris Dunning (kris.dunning@itdev.co.uk)
  * @date    2022
  */
 
+#include <algorithm>
+#include <array>
 #include <thread>
 #include <chrono>
-#include <iostream>
-#include <sstream>
+#include <string>
 #include <functional>
-#include <mutex>
-#include <condition_variable>
-#include <queue>
+#include <span>
 #include <vector>
+#include <optional>
+
+#include "../common/adaptive-wait.h"
+#include "../common/affinity.h"
+#include "../common/async-log.h"
+#include "../common/callback-slab.h"
+#include "../common/colour.h"
+#include "../common/cpu.h"
+#include "../common/data-signal.h"
+#include "../common/fixed-array.h"
+#include "../common/interruptible-sleep.h"
+#include "../common/mpmc-queue.h"
+#include "../common/node-queue.h"
+#include "../common/stop-tree.h"
+#include "../common/task-queue.h"
+#include "../common/trace.h"
+#include "../common/work-stealing-pool.h"
+#include "../common/worker-stats.h"
 
 using namespace std::chrono_literals;
 
-/// @brief  The colour code prefix
-static const std::string COL_PRE = "\033[1;";
-/// @brief  The colour code suffix
-static const std::string COL_SUF = "m";
-/// @brief  Colour code to return to normal
-static const std::string COL_NORM = "\033[0m";
-
-/// @brief  Value to set the terminal text red
-static const int COL_RED = 31;
-/// @brief  Value to set the terminal text green
-static const int COL_GRN = 32;
-/// @brief  Value to set the terminal text blue
-static const int COL_BLU = 34;
-/// @brief  Value to set the terminal text magenta
-static const int COL_MAG = 35;
-/// @brief  Value to set the terminal text yellow
-static const int COL_YLW = 33;
-/// @brief  Value to set the terminal text cyan
-static const int COL_CYN = 36;
-
-/// @brief  Helper function to get the colour string so that it does not get
-///         flushed to the terminal before it has been combined.
-std::string getColour(int col)
+/// @brief  A work item, stamped with when it was queued
+struct Job
 {
-    std::stringstream ss;
-    ss << COL_PRE << std::to_string(col) << COL_SUF;
-    return ss.str();
-}
+    /// @brief  The task value
+    int value = 0;
+    /// @brief  When the item was added to the queue
+    WorkerStats::Clock::time_point queued;
+    /// @brief  Cancels this item alone, whether queued or running
+    std::stop_token stop;
+    /// @brief  When the item expires, being dropped unrun if not yet started
+    WorkerStats::Clock::time_point deadline = WorkerStats::Clock::time_point::max();
+};
 
-/// @brief  Provides a standardised log message with colour
-#define LOG(col, name, msg)     std::cout << getColour(col) << name << ": " << \
-                                msg << COL_NORM << std::endl;
+/// @brief  The number of priority lanes in the shared queue
+static constexpr std::size_t LANES = 3;
+/// @brief  The shared queue, with its priority lanes
+using SharedQueue = TaskQueue<Job, LANES>;
 
-/// @brief  Short-hand name for the lamda provided for callback
-using Callback = std::function<void(void)>;
+/// @brief  Chooses the lane of a task, the shortest being the most urgent
+/// @param  value   The task value, and so its length
+static std::size_t laneFor(int value)
+{
+    return (value <= 3) ? 0 : (value <= 10) ? 1 : 2;
+}
 
-/// @brief  Class that uses a std::jthread to operate stoppable actions
-class WorkerThread
+/// @brief  Class that uses a std::jthread to operate stoppable actions. Each
+///         starts a cache line of its own, so that workers held side by side
+///         do not share lines.
+class alignas(CACHE_LINE_SIZE) WorkerThread
 {
 public:
     /// @brief  Constructor
@@ -70,10 +112,15 @@ public:
     /// @param  colour          The colour to be used for logging
     /// @param  finishEarly     Indicates whether this thread is permitted to
     ///                         finish early if a stop is requested.
-    WorkerThread(const std::string name, const int colour, bool finishEarly)
+    /// @param  maxBatch        The most items taken from the queue at once
+    /// @param  waitMode        How the thread waits for work before parking
+    WorkerThread(const std::string name, const Colour colour, bool finishEarly,
+        std::size_t maxBatch = 1, WaitMode waitMode = WaitMode::PARK)
         : mName(name)
         , mColour(colour)
         , mFinishEarly(finishEarly)
+        , mMaxBatch(maxBatch > 0 ? maxBatch : 1)
+        , mWait(waitMode)
     {
         LOG(mColour, mName, "Constructed");
     }
@@ -85,21 +132,63 @@ public:
     }
 
     /// @brief  Starts the thread
-    /// @param  mutex   The mutex protecting the queue
-    /// @param  cv      The condition variable to assess the queue
     /// @param  queue   The queue of work items to process
-    void start(
-        std::mutex &mutex,
-        std::condition_variable_any &cv,
-        std::queue<int> &queue
-    )
+    void start(SharedQueue &queue)
     {
-        // Firstly, we need to bind the worker method along with this instance.
-        // Secondly, each reference value must be passed in using std::ref().
-        mThread = std::jthread(
-            std::bind_front(&WorkerThread::worker, this),
-            std::ref(mutex), std::ref(cv), std::ref(queue)
-        );
+        // The shared queue records its own lock and idle times
+        startWorker([this, &queue](std::span<Job> out, const std::stop_token &token,
+            bool finishEarly) {
+            return queue.popUpTo(out, token, finishEarly, &mStats, &mWait);
+        });
+    }
+
+    /// @brief  Starts the thread using a queue of its own, from which its
+    ///         peers may steal when they are idle
+    /// @param  pool    The pool of per-worker queues
+    void start(WorkStealingPool<Job> &pool)
+    {
+        startWorker([this, &pool, slot = pool.attach()](std::span<Job> out,
+            const std::stop_token &token, bool finishEarly) {
+            return timedTake([&]() {
+                return pool.popUpTo(slot, out, token, finishEarly, &mWait);
+            });
+        });
+    }
+
+    /// @brief  Starts the thread using a lock-free queue shared by all of the
+    ///         workers, which only parks the thread once it is out of work
+    /// @param  queue   The lock-free queue of work items to process
+    void start(BoundedMpmcQueue<Job> &queue)
+    {
+        startWorker([this, &queue](std::span<Job> out, const std::stop_token &token,
+            bool finishEarly) {
+            return timedTake([&]() {
+                return queue.popUpTo(out, token, finishEarly);
+            });
+        });
+    }
+
+    /// @brief  Starts the thread using the queue of the given node's shard,
+    ///         stealing from other nodes only once that is empty
+    /// @param  queue   The queue of per-node shards
+    /// @param  shard   The shard of the node this worker is pinned to
+    void start(NodeQueue<Job> &queue, std::size_t shard)
+    {
+        startWorker([this, &queue, shard](std::span<Job> out,
+            const std::stop_token &token, bool finishEarly) {
+            return timedTake([&]() {
+                return queue.popUpTo(shard, out, token, finishEarly);
+            });
+        });
+    }
+
+    /// @brief  Restricts the running thread to the given CPUs, such as a
+    ///         single core or every core of a NUMA node
+    /// @param  cpus    The CPUs the thread may run on
+    /// @returns    True if the thread was pinned
+    bool pin(const std::vector<std::size_t> &cpus)
+    {
+        return mThread.joinable() && pinThread(mThread, cpus);
     }
 
     /// @brief  Stops the thread, blocking if requested
@@ -108,21 +197,63 @@ public:
     {
         if (mThread.get_stop_token().stop_possible())
         {
+            TRACE("request_stop");
             mThread.request_stop();
             if (block)
             {
                 mThread.join();
+                TRACE("Joined");
             }
         }
     }
 
-    /// @brief  Adds a stop_callback as requested
+    /// @brief  Stops the thread, waiting for it only until the deadline, so
+    ///         that a worker slow to stop cannot hold up the caller for long
+    /// @param  deadline    When to give up waiting for the thread
+    /// @returns    True if the thread has stopped and been joined, false if
+    ///             it was still running at the deadline, leaving the caller
+    ///             to escalate, or to join it later
+    bool stopUntil(WorkerStats::Clock::time_point deadline)
+    {
+        if (!mThread.joinable())
+        {
+            return true;
+        }
+        TRACE("request_stop");
+        mThread.request_stop();
+        // A std::jthread cannot be joined with a timeout, so the worker
+        // signals as it leaves, and is only joined once it has
+        if (!mFinished.waitUntil(std::stop_token(), deadline, isFinished))
+        {
+            TRACE("Stop timed out");
+            return false;
+        }
+        mThread.join();
+        TRACE("Joined");
+        return true;
+    }
+
+    /// @brief  The thread's stop source, so that it may be stopped along with
+    ///         others through a StopNode
+    std::stop_source stopSource()
+    {
+        return mThread.get_stop_source();
+    }
+
+    /// @brief  The most stop callbacks that can be added at once
+    static constexpr std::size_t MAX_CALLBACKS = 4;
+    /// @brief  Deregisters a callback from addCallback() when destroyed
+    using CallbackHandle = CallbackSlab<MAX_CALLBACKS>::Handle;
+
+    /// @brief  Adds a stop_callback as requested. The callback is held within
+    ///         this object rather than on the heap, and must be released, by
+    ///         destroying the handle, before this object is destroyed.
     /// @param cb   The callback to be triggered when stop is requested
-    /// @returns    Pointer to the new stop_callback
-    std::stop_callback<Callback> *addCallback(Callback cb)
+    /// @returns    Handle owning the new stop_callback
+    template<typename F>
+    [[nodiscard]] CallbackHandle addCallback(F &&cb)
     {
-        std::stop_callback<Callback> *v = new std::stop_callback<Callback>(mThread.get_stop_token(), cb);
-        return v;
+        return mCallbacks.add(mThread.get_stop_token(), std::forward<F>(cb));
     }
 
     /// @brief  Joins the thread, if it is running
@@ -131,67 +262,146 @@ public:
         if (mThread.joinable())
         {
             mThread.join();
+            TRACE("Joined");
         }
     }
 
+    /// @brief  The thread name
+    const std::string &name() const
+    {
+        return mName;
+    }
+
+    /// @brief  The colour used in logging
+    Colour colour() const
+    {
+        return mColour;
+    }
+
+    /// @brief  A copy of the thread's counters, which may be taken whilst it
+    ///         is running
+    WorkerStats::Snapshot stats() const
+    {
+        return mStats.snapshot();
+    }
+
 protected:
 
+    /// @brief  Takes work through a queue that does not record its own
+    ///         timings, counting the whole call as idle time
+    /// @param  take    Callable taking a batch of items from the queue
+    template<typename Take>
+    std::size_t timedTake(Take take)
+    {
+        const auto start = WorkerStats::Clock::now();
+        const std::size_t count = take();
+        mStats.recordIdle(WorkerStats::Clock::now() - start);
+        return count;
+    }
+
+    /// @brief  Starts the worker with the given means of taking work
+    /// @param  take    Callable taking a batch of items from the queue
+    template<typename Take>
+    void startWorker(Take take)
+    {
+        // Firstly, we need to bind the worker method along with this instance.
+        // Secondly, any reference value must be passed in using std::ref(),
+        // or, as here, captured by reference within the callable.
+        mFinished.set(false, isFinished);
+        mThread = std::jthread(
+            std::bind_front(&WorkerThread::worker<Take>, this),
+            std::move(take)
+        );
+    }
+
     /// @brief  Worker for an interruptable thread. This takes note of the
     ///         stop_token and exits as required. A built-in delay is added
     ///         to demonstrate the delay between requesting a stop and the
     ///         thread stopping, i.e. when calling stop() as a blocking call.
+    ///
+    ///         Up to mMaxBatch items are taken from the queue at once, so the
+    ///         queue's shared state is only touched once per batch. Items that
+    ///         have been taken are always completed, even if a stop is then
+    ///         requested, as nothing else can see them anymore, unless the
+    ///         item itself has been cancelled. A cancelled item is skipped if
+    ///         it has not started, and cut short if it has, whilst an item
+    ///         taken after its deadline is dropped without being started.
     /// @param  token   The stop token associated with this thread
-    /// @param  mutex   The mutex protecting the queue
-    /// @param  cv      The condition variable used to assess the queue
-    /// @param  queue   The queue containing work items
-    void worker(
-        const std::stop_token &token,
-        std::mutex &mutex,
-        std::condition_variable_any &cv,
-        std::queue<int> &queue
-    )
+    /// @param  take    Callable taking a batch of items from the queue, which
+    ///                 waits for work and returns zero once it is time to stop
+    template<typename Take>
+    void worker(const std::stop_token &token, Take take)
     {
+        TRACE_THREAD(mName);
+        TRACE_SCOPE("Running");
         LOG(mColour, mName, "Starting worker");
-        while (true)
+        std::vector<Job> batch(mMaxBatch);
+        std::size_t count = 0;
+        while ((count = take(std::span<Job>(batch), token, mFinishEarly)) > 0)
         {
-            int value = 0;
+            // This is done outside of any lock, so that other threads may
+            // have chance to work on other items in the queue
+            for (std::size_t i = 0; i < count; ++i)
             {
-                std::unique_lock lock(mutex);
-                // The new method wait() accepts a std::stop_token, and returns
-                // the result from the predicate, and so, if the result is
-                // false, we know that stop was requested. Otherwise, there are
-                // items on the queue, and therefore, work to be done.
-                //
-                // If work remains but a stop request has been made, we cannot
-                // tell without checking the token manually, and so the
-                // mFinishEarly value lets this thread know whether it should
-                // continue working or exit immediately if a stop was requested.
-                if (!cv.wait(lock, token, [&]() { return queue.size() > 0; }) ||
-                    (mFinishEarly && token.stop_requested()))
+                const auto begin = WorkerStats::Clock::now();
+                TRACE_VALUE("Dequeue", batch[i].value);
+                if (batch[i].stop.stop_requested())
+                {
+                    LOG(mColour, mName, "Skipping cancelled action with ID: " << batch[i].value);
+                    continue;
+                }
+                if (begin >= batch[i].deadline)
+                {
+                    TRACE_VALUE("Expired", batch[i].value);
+                    LOG(mColour, mName, "Dropping expired action with ID: " << batch[i].value);
+                    mStats.recordExpired();
+                    continue;
+                }
+                TRACE_SCOPE("Task");
+                LOG(mColour, mName, "Doing action with ID: " << batch[i].value);
+                if (!interruptibleSleep(batch[i].stop, batch[i].value * 100ms))
                 {
-                    break;
+                    LOG(mColour, mName, "Action with ID " << batch[i].value << " cancelled");
                 }
-                value = queue.front();
-                LOG(mColour, mName, "Doing action with ID: " << value);
-                queue.pop();
+                mStats.recordTask(begin - batch[i].queued,
+                    WorkerStats::Clock::now() - begin);
             }
-            // This must be done outside of the lock, so that other threads
-            // may have chance to work on other items in the queue
-            std::this_thread::sleep_for(value * 100ms);
         }
         
         LOG(mColour, mName, "Leaving worker");
+        mFinished.set(true, isFinished);
     }
 
+    /// @brief  Whether mFinished shows the worker to have left
+    static bool isFinished(const bool &finished)
+    {
+        return finished;
+    }
+
+    // The read-mostly state comes first, then what is written as the thread
+    // starts and stops, and then the state written by the running thread,
+    // its stats on lines of their own. The thread follows everything its
+    // worker uses, so that it is joined before any of that is destroyed, and
+    // only the callbacks, which the worker never touches, come after it.
+
     /// @brief  The thread name
     const std::string mName;
     /// @brief  The colour to use in logging
-    const int mColour;
+    const Colour mColour;
     ///  @brief Allows the thread to finish if stop is requested, even if work remains
     const bool mFinishEarly;
+    /// @brief  The most items taken from the queue at once
+    const std::size_t mMaxBatch;
+    /// @brief  Set by the worker as it leaves, for stopUntil() to wait on
+    DataSignal<bool> mFinished{ false };
+    /// @brief  How the thread waits for work, used only by the thread
+    AdaptiveWait mWait;
+    /// @brief  Where the thread's time goes, written only by the thread
+    WorkerStats mStats;
     /// @brief  The underlying thread object
     std::jthread mThread;
-    
+    /// @brief  Inline storage for the callbacks from addCallback()
+    CallbackSlab<MAX_CALLBACKS> mCallbacks;
 };
 
 /// @brief  Main
@@ -207,42 +417,203 @@ int main(int argc, char** argv)
         {
             threadCount = std::stoi(argv[1]);
         }
-        catch (std::exception)
+        catch (const std::exception &)
         {
             LOG(COL_RED, "ERROR", "Invalid thread count: " << argv[1]);
         }        
     }
+    // Ten tasks are queued per worker, so there must be at least one worker,
+    // and few enough for the task count and queue capacity to stay sane
+    if (threadCount < 1 || threadCount > 10000)
+    {
+        LOG(COL_RED, "ERROR", "Invalid thread count: " << threadCount <<
+            " (expected 1 to 10000)");
+        return 1;
+    }
+    // An optional second argument selects how the work is queued
+    const std::string mode = (argc > 2) ? argv[2] : "shared";
+    if (mode != "shared" && mode != "steal" && mode != "lockfree" && mode != "numa")
+    {
+        LOG(COL_RED, "ERROR", "Invalid queue mode: " << mode <<
+            " (expected shared, steal, lockfree or numa)");
+        return 1;
+    }
+    // And an optional third, the number of items taken by a worker at once.
+    // The demonstration tasks are long, so the default takes one at a time.
+    std::size_t maxBatch = 1;
+    if (argc > 3)
+    {
+        try
+        {
+            maxBatch = std::stoul(argv[3]);
+        }
+        catch (const std::exception &)
+        {
+            LOG(COL_RED, "ERROR", "Invalid batch size: " << argv[3]);
+        }
+    }
+    // And an optional fourth, the period in milliseconds at which to log the
+    // stats of every worker while running, if at all
+    int statsPeriod = 0;
+    if (argc > 4)
+    {
+        try
+        {
+            statsPeriod = std::stoi(argv[4]);
+        }
+        catch (const std::exception &)
+        {
+            LOG(COL_RED, "ERROR", "Invalid stats period: " << argv[4]);
+        }
+    }
+    // And an optional fifth, how workers choose between the shared queue's
+    // priority lanes
+    const std::string lanePolicy = (argc > 5) ? argv[5] : "strict";
+    if (lanePolicy != "strict" && lanePolicy != "weighted")
+    {
+        LOG(COL_RED, "ERROR", "Invalid lane policy: " << lanePolicy <<
+            " (expected strict or weighted)");
+        return 1;
+    }
+
+    // And an optional sixth, how idle workers wait for work
+    const std::string waitName = (argc > 6) ? argv[6] : "park";
+    if (waitName != "park" && waitName != "spin" && waitName != "adaptive")
+    {
+        LOG(COL_RED, "ERROR", "Invalid wait mode: " << waitName <<
+            " (expected park, spin or adaptive)");
+        return 1;
+    }
+    const WaitMode waitMode = (waitName == "spin") ? WaitMode::SPIN :
+        (waitName == "adaptive") ? WaitMode::ADAPTIVE : WaitMode::PARK;
+
+    // And an optional seventh, the deadline of every task in milliseconds
+    // from being queued, if they have one
+    int taskDeadline = 0;
+    if (argc > 7)
+    {
+        try
+        {
+            taskDeadline = std::stoi(argv[7]);
+        }
+        catch (const std::exception &)
+        {
+            LOG(COL_RED, "ERROR", "Invalid task deadline: " << argv[7]);
+        }
+    }
+
+    // And an optional eighth, how long in milliseconds the extra thread is
+    // given to finish once the pool is stopped, before every task is cancelled
+    int stopTimeout = 20000;
+    if (argc > 8)
+    {
+        try
+        {
+            stopTimeout = std::stoi(argv[8]);
+        }
+        catch (const std::exception &)
+        {
+            LOG(COL_RED, "ERROR", "Invalid stop timeout: " << argv[8]);
+        }
+    }
 
     // Constants
     static const std::string NAME = "Main";
-    static const int COL = COL_BLU;
+    static const Colour COL = COL_BLU;
     static const int SPECIAL_THREAD = threadCount / 2;
     static const int COL_COUNT = 4;
-    static const int COLS[COL_COUNT] = { COL_GRN, COL_YLW, COL_RED, COL_CYN };
+    static const Colour COLS[COL_COUNT] = { COL_GRN, COL_YLW, COL_RED, COL_CYN };
     static const std::string NAME_PREFIX = "Worker_";
+    // When built with THREAD_TRACE, saves the thread lifecycle events, and
+    // each task's enqueue and dequeue, on exit
+    TRACE_SAVE_ON_EXIT("ex7-trace.json");
+    TRACE_THREAD(NAME);
 
-    LOG(COL, NAME, "Running with a pool of " << threadCount << " threads");
+    LOG(COL, NAME, "Running with a pool of " << threadCount << " threads (" <<
+        mode << " queue, batches of " << maxBatch << ", " << waitName << " wait)");
 
-    // The task queue for the workers to act upon
-    std::queue<int> taskQueue;
-    std::mutex mutex;
-    std::condition_variable_any cv;
+    // Only the queue for the selected mode is built. By default, the shared
+    // task queue for the workers to act upon
+    std::optional<SharedQueue> taskQueue;
+    // Alternatively, a queue for each worker, plus one for the extra thread
+    std::optional<WorkStealingPool<Job>> pool;
+    // Or a single lock-free queue, large enough to hold every task
+    std::optional<BoundedMpmcQueue<Job>> lockFreeQueue;
+    // Or a queue shard per NUMA node, each allocated on its node
+    std::optional<NodeQueue<Job>> nodeQueue;
+    CpuTopology topology;
+    if (mode == "steal")
+    {
+        pool.emplace(threadCount + 1);
+    }
+    else if (mode == "lockfree")
+    {
+        lockFreeQueue.emplace(threadCount * 10);
+    }
+    else if (mode == "numa")
+    {
+        topology = CpuTopology::detect();
+        std::vector<int> nodeIds;
+        for (const CpuTopology::Node &node : topology.nodes)
+        {
+            nodeIds.push_back(node.id);
+        }
+        nodeQueue.emplace(nodeIds);
+        LOG(COL, NAME, "Found " << topology.nodes.size() << " NUMA node(s)");
+    }
+    else
+    {
+        taskQueue.emplace(lanePolicy == "weighted" ?
+            LanePolicy::WEIGHTED : LanePolicy::STRICT);
+    }
+    // The node each worker started on the node queue is placed on, in turn
+    std::size_t nextNode = 0;
+
+    // Starts a worker on whichever queue was selected
+    auto startWorker = [&](WorkerThread &worker) {
+        if (mode == "steal")
+        {
+            worker.start(*pool);
+        }
+        else if (mode == "numa")
+        {
+            const std::size_t node = nextNode++ % topology.nodes.size();
+            worker.start(*nodeQueue, node);
+            if (!worker.pin(topology.nodes[node].cpus))
+            {
+                LOG(COL_RED, worker.name(), "Could not be pinned to node " <<
+                    topology.nodes[node].id);
+            }
+        }
+        else if (mode == "lockfree")
+        {
+            worker.start(*lockFreeQueue);
+        }
+        else
+        {
+            worker.start(*taskQueue);
+        }
+    };
 
     // Additional thread to be started on the death of another thread.
     // Note that this thread is not allowed to exit early, it must do all jobs
     // remaining in the queue before it is permitted to stop.
-    WorkerThread extraThread("Extra", COL_MAG, false);
+    WorkerThread extraThread("Extra", COL_MAG, false, maxBatch, waitMode);
 
     // Initialise a group of worker threads and start them immediately, adding
     // one special stop_callback to trigger the extra (clean-up) thread.
     // Note that these threads are allowed to exit early, even if work is
     // remaining on the queue.
-    std::vector<std::unique_ptr<WorkerThread>> threads;
+    // They are held side by side, rather than each on the heap, as a running
+    // worker may not move.
+    FixedArray<WorkerThread> threads(static_cast<std::size_t>(threadCount));
+    // Keeps the special callback registered. It is declared after the
+    // threads, so that it is released before they are destroyed.
+    WorkerThread::CallbackHandle startExtra;
     for (int i = 0; i < threadCount; ++i)
     {
-        threads.push_back(std::make_unique<WorkerThread>(
-            NAME_PREFIX + std::to_string(i + 1), COLS[i % COL_COUNT], true));
-        threads.back()->start(mutex, cv, taskQueue);
+        startWorker(threads.emplace_back(NAME_PREFIX + std::to_string(i + 1),
+            COLS[i % COL_COUNT], true, maxBatch, waitMode));
         
         // Slight pause to help prevent overlapping prints to the terminal
         std::this_thread::sleep_for(2ms);
@@ -251,25 +622,114 @@ int main(int argc, char** argv)
         // start of the extra thread
         if (i == SPECIAL_THREAD)
         {
-            threads.back()->addCallback([&]() {
-                extraThread.start(mutex, cv, taskQueue);
+            startExtra = threads.back().addCallback([&]() {
+                TRACE("stop_callback");
+                startWorker(extraThread);
             });
         }
     }
 
+    // Link every worker's stop source below one node, so that the whole pool
+    // is stopped by a single request, rather than one worker at a time. The
+    // extra thread is left out, being started by the pool's death.
+    StopNode poolStop;
+    FixedArray<StopNode> workerStops(threads.size());
+    for (WorkerThread &thread : threads)
+    {
+        workerStops.emplace_back(poolStop, thread.stopSource());
+    }
+
+    // Logs the stats of a worker
+    auto logStats = [&](const WorkerThread &worker) {
+        LOG(worker.colour(), worker.name(), worker.stats().summary());
+    };
+    // Logs the depth of each lane of the shared queue
+    auto logLanes = [&]() {
+        if (mode != "shared")
+        {
+            return;
+        }
+        for (std::size_t lane = 0; lane < SharedQueue::lanes(); ++lane)
+        {
+            const SharedQueue::LaneMetrics metrics = taskQueue->metrics(lane);
+            LOG(COL, NAME, "Lane " << lane << " | depth " << metrics.depth <<
+                " peak " << metrics.peak << " | pushed " << metrics.pushed <<
+                " taken " << metrics.taken);
+        }
+    };
+    // Optionally log the stats of every worker periodically. This is declared
+    // after the threads, so that it stops before they are destroyed.
+    std::optional<StatsDumper> dumper;
+    if (statsPeriod > 0)
+    {
+        dumper.emplace(std::chrono::milliseconds(statsPeriod), [&]() {
+            for (const WorkerThread &thread : threads)
+            {
+                logStats(thread);
+            }
+            logStats(extraThread);
+            logLanes();
+        });
+    }
+
     // Allow all threads to run briefly
     std::this_thread::sleep_for(1s);
     
     // Use the known time from the worker threads to calculate a delay
     int delayMultiplier = 0;
-    // Add a bundle of tasks to the queue
+    // Prepare a bundle of tasks
+    // Each task has a stop source of its own, linked below a node for them
+    // all, so that any one may be cancelled, or every one at once.
+    std::vector<Job> tasks;
+    StopNode taskStop;
+    FixedArray<StopNode> taskStops(static_cast<std::size_t>(threadCount * 10));
+    const auto queued = WorkerStats::Clock::now();
+    const auto deadline = (taskDeadline > 0) ?
+        queued + std::chrono::milliseconds(taskDeadline) : WorkerStats::Clock::time_point::max();
     for (int i = threadCount * 10; i > 0; --i)
     {
         delayMultiplier += i;
-        std::unique_lock lock(mutex);
-        taskQueue.push(i);
-        // Notify one thread at a time
-        cv.notify_one();
+        TRACE_VALUE("Enqueue", i);
+        tasks.push_back(Job{ i, queued, taskStops.emplace_back(taskStop).get_token(), deadline });
+    }
+    // Add them all to the queue at once, which takes the lock (if there is
+    // one) a single time, and wakes no more workers than there are tasks.
+    if (mode == "steal")
+    {
+        pool->pushBulk(tasks);
+    }
+    else if (mode == "lockfree")
+    {
+        lockFreeQueue->pushBulk(tasks);
+    }
+    else if (mode == "numa")
+    {
+        nodeQueue->pushBulk(tasks);
+    }
+    else
+    {
+        // One batch per lane, so still one lock per lane
+        std::array<std::vector<Job>, LANES> lanes;
+        for (Job &task : tasks)
+        {
+            lanes[laneFor(task.value)].push_back(task);
+        }
+        for (std::size_t lane = 0; lane < LANES; ++lane)
+        {
+            taskQueue->pushBulk(lanes[lane], lane);
+        }
+    }
+
+    // Cancel the longest task and the one with ID 10 shortly after. Which
+    // are running by then depends on the queue, but one still queued is
+    // skipped, and one running is cut short.
+    std::this_thread::sleep_for(500ms);
+    if (taskStops.size() >= 10)
+    {
+        LOG(COL, NAME, "Cancelling the tasks with IDs " << taskStops.size() << " and 10");
+        TRACE("request_stop");
+        taskStops[0].request_stop();
+        taskStops[taskStops.size() - 10].request_stop();
     }
 
     // Sleep for enough time for the extra thread to have to work for about 10
@@ -280,17 +740,35 @@ int main(int argc, char** argv)
     );
 
     // Now, kill off the thread collection, which will trigger the start of the
-    // extra thread to clean up any remaining jobs
+    // extra thread to clean up any remaining jobs. One request on their
+    // parent stops every worker.
     LOG(COL, NAME, "Killing thread pool");
-    for (auto &thread : threads)
-    {
-        thread->stop();
-    }
+    TRACE("request_stop");
+    poolStop.request_stop();
 
     LOG(COL, NAME, "Waiting for the extra thread to finish the jobs...");
-    // Stop the thread and wait until it has finished
-    extraThread.stop(true);
+    // Stop the thread and wait until it has finished, or, if it is taking too
+    // long, cancel whatever is left, queued or running, and wait for that
+    if (!extraThread.stopUntil(WorkerStats::Clock::now() + std::chrono::milliseconds(stopTimeout)))
+    {
+        LOG(COL, NAME, "Not finished after " << stopTimeout << " ms, cancelling every task");
+        TRACE("request_stop");
+        taskStop.request_stop();
+        extraThread.join();
+    }
     LOG(COL, NAME, "All jobs complete.");
 
+    // Show where each worker's time went, and the total across the pool
+    dumper.reset();
+    WorkerStats::Snapshot total = extraThread.stats();
+    for (const WorkerThread &thread : threads)
+    {
+        logStats(thread);
+        total += thread.stats();
+    }
+    logStats(extraThread);
+    LOG(COL, NAME, total.summary());
+    logLanes();
+
     return 0;
 }
@@ -0,0 +1,129 @@
+/**
+ * @file    jthread-ex8-timer-wheel.cpp
+ *
+ * @brief   Example running the periodic workers from example 2 as jobs on a
+ *          timer wheel, rather than giving each its own std::jthread. A small
+ *          number of threads then serve any number of jobs, each of which is
+ *          still cancelled through its own std::stop_source.
+ *          Alongside the coloured jobs, a large number of silent jobs are
+ *          scheduled, all cancelled at once through a single stop source.
+ *
+ *          Usage: ex8 [silent jobs] [worker threads]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <string>
+#include <atomic>
+
+#include "../common/async-log.h"
+#include "../common/colour.h"
+#include "../common/timer-wheel.h"
+
+using namespace std::chrono_literals;
+
+/// @brief  Stops a job, in the same way as stopping a thread
+/// @param  source  The stop source of the job
+/// @param  col     The colour of the log message
+/// @param  name    The name of the thread stopping the job
+/// @param  jobName The name of the job being stopped
+static void stopJob(std::stop_source &source, const Colour col,
+    const std::string &name, const std::string &jobName)
+{
+    if (source.stop_possible())
+    {
+        LOG(col, name, "Stopping the " << jobName);
+        source.request_stop();
+    }
+}
+
+// GCC 12 wrongly warns that each default constructed std::stop_source below
+// may be used uninitialized, as its constructor passes itself to its shared
+// state, so the warning is silenced for main() alone
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    static const std::string NAME = "Main";
+    static const Colour COL = COL_BLU;
+
+    int silentJobs = 1000;
+    int workers = 2;
+    try
+    {
+        if (argc > 1)
+        {
+            silentJobs = std::stoi(argv[1]);
+        }
+        if (argc > 2)
+        {
+            workers = std::stoi(argv[2]);
+        }
+    }
+    catch (const std::exception &)
+    {
+        LOG(COL_RED, "ERROR", "Usage: " << argv[0] << " [silent jobs] [worker threads]");
+        return 1;
+    }
+
+    // The wheel owns the threads. Every job below shares them, however many
+    // jobs there are.
+    TimerWheel wheel(workers > 0 ? workers : 1);
+    LOG(COL, NAME, "Running " << silentJobs + 3 << " jobs on " << workers <<
+        " worker threads");
+
+    // Each job has its own stop source, in place of the one that each
+    // std::jthread would have had.
+    std::stop_source magentaSource;
+    std::stop_source quickSource;
+    std::stop_source slowSource;
+    wheel.schedule(100ms, []() { DOT(COL_MAG); }, magentaSource.get_token());
+    std::this_thread::sleep_for(500ms);
+    wheel.schedule(25ms, []() { DOT(COL_RED); }, quickSource.get_token());
+    std::this_thread::sleep_for(500ms);
+    wheel.schedule(250ms, []() { DOT(COL_GRN); }, slowSource.get_token());
+
+    // The silent jobs share one stop source, so they can all be cancelled by
+    // a single request.
+    std::stop_source silentSource;
+    std::atomic<long long> silentRuns{ 0 };
+    for (int i = 0; i < silentJobs; ++i)
+    {
+        wheel.schedule(std::chrono::milliseconds(10 + i % 491), [&silentRuns]() {
+            silentRuns.fetch_add(1, std::memory_order_relaxed);
+        }, silentSource.get_token());
+    }
+
+    // Add a delay allowing each job to run for a few seconds
+    std::this_thread::sleep_for(3s);
+
+    stopJob(magentaSource, COL, NAME, "magenta job");
+    std::this_thread::sleep_for(1s);
+    stopJob(quickSource, COL, NAME, "quick red job");
+    std::this_thread::sleep_for(1s);
+    stopJob(slowSource, COL, NAME, "slow green job");
+    stopJob(silentSource, COL, NAME, "silent jobs");
+    NEWLINE();
+
+    LOG(COL, NAME, "The silent jobs ran " << silentRuns.load() << " times");
+
+    // Cancelled jobs are removed when they next fall due, so give the
+    // slowest of them time to come round
+    std::this_thread::sleep_for(600ms);
+    LOG(COL, NAME, "Jobs remaining on the wheel: " << wheel.size());
+
+    // Note - the wheel stops and joins its own threads
+    LOG(COL, NAME, "About to leave the main thread");
+    return 0;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
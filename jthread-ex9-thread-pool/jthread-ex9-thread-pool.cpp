@@ -0,0 +1,219 @@
+/**
+ * @file    jthread-ex9-thread-pool.cpp
+ *
+ * @brief   Example of a general purpose thread pool. Where the pool in example
+ *          7 only passes integer IDs to its workers, here any closure can be
+ *          submitted, and a future collects whatever it returns, or whatever
+ *          it throws. Small closures are held inside the queued Task itself,
+ *          so submitting them does not allocate, and since a Task only needs to
+ *          be movable, closures can own move-only objects such as
+ *          std::unique_ptr, which std::function does not allow.
+ *          An elastic pool then grows to meet a burst of work, and shrinks
+ *          again once idle, parking its spare threads for the next burst.
+ *          The same count is then made by parallelReduce(), which splits the
+ *          range itself and has the calling thread help rather than wait, and
+ *          a parallelFor() is cancelled part way through by its stop token.
+ *          Finally, the pool is shut down with a deadline. Every worker helps
+ *          to drain the queue, and whatever is left at the deadline is handed
+ *          back rather than run.
+ *
+ *          Usage: ex9 [threads]
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <thread>
+#include <chrono>
+#include <string>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <atomic>
+#include <functional>
+#include <stop_token>
+#include <optional>
+
+#include "../common/async-log.h"
+#include "../common/colour.h"
+#include "../common/parallel-for.h"
+#include "../common/thread-pool.h"
+
+using namespace std::chrono_literals;
+
+/// @brief  Counts the primes in a range, as an example of real work
+/// @param  begin   The first number to check
+/// @param  end     One past the last number to check
+/// @returns    The number of primes found
+static int countPrimes(int begin, int end)
+{
+    int count = 0;
+    for (int n = begin; n < end; ++n)
+    {
+        bool prime = n > 1;
+        for (int d = 2; prime && d * d <= n; ++d)
+        {
+            prime = (n % d) != 0;
+        }
+        count += prime ? 1 : 0;
+    }
+    return count;
+}
+
+/// @brief  Main
+int main(int argc, char** argv)
+{
+    static const std::string NAME = "Main";
+    static const Colour COL = COL_BLU;
+
+    int threadCount = 4;
+    if (argc > 1)
+    {
+        try
+        {
+            threadCount = std::stoi(argv[1]);
+        }
+        catch (const std::exception &)
+        {
+            LOG(COL_RED, "ERROR", "Invalid thread count: " << argv[1]);
+        }
+    }
+
+    ThreadPool pool(threadCount > 0 ? threadCount : 1);
+    LOG(COL, NAME, "Running with a pool of " << pool.size() << " threads, each " <<
+        "Task holding up to " << Task::INLINE_SIZE << " bytes inline");
+
+    // Fire and forget, with no result to collect
+    for (int i = 0; i < 4; ++i)
+    {
+        pool.post([i]() {
+            LOG(COL_GRN, "Task_" + std::to_string(i), "Hello from the pool");
+        });
+    }
+
+    // Split a larger job into chunks, collecting a result from each. The
+    // futures cannot be moved, so they are constructed in place in a
+    // container that never moves its elements.
+    static const int LIMIT = 2000000;
+    static const int CHUNKS = 32;
+    const auto start = std::chrono::steady_clock::now();
+    std::deque<TaskFuture<int>> counts;
+    for (int chunk = 0; chunk < CHUNKS; ++chunk)
+    {
+        const int begin = LIMIT / CHUNKS * chunk;
+        const int end = LIMIT / CHUNKS * (chunk + 1);
+        counts.emplace_back(pool, [begin, end]() {
+            return countPrimes(begin, end);
+        });
+    }
+    int total = 0;
+    for (auto &count : counts)
+    {
+        total += count.get();
+    }
+    const auto taken = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    LOG(COL, NAME, "Found " << total << " primes below " << LIMIT << " in " <<
+        CHUNKS << " tasks, taking " << taken.count() << " ms");
+
+    // The same count, with the range split by the pool itself. The main
+    // thread runs chunks too, rather than blocking until the rest are done.
+    const auto reduceStart = std::chrono::steady_clock::now();
+    const std::optional<int> reduced = parallelReduce(pool, 0, LIMIT, 0, 0,
+        countPrimes, std::plus<int>());
+    const auto reduceTaken = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - reduceStart);
+    LOG(COL, NAME, "parallelReduce found " << reduced.value_or(0) << " primes, taking " <<
+        reduceTaken.count() << " ms");
+
+    // A loop over far more numbers than it has time for, cancelled by its
+    // stop token, which abandons every chunk not yet started
+    std::stop_source cancel;
+    std::atomic<int> checked{ 0 };
+    std::atomic<int> found{ 0 };
+    pool.post([&cancel]() {
+        std::this_thread::sleep_for(50ms);
+        cancel.request_stop();
+    });
+    const bool completed = parallelFor(pool, 0, LIMIT * 100, 1000, [&](int first, int last) {
+        found.fetch_add(countPrimes(first % LIMIT, first % LIMIT + (last - first)),
+            std::memory_order_relaxed);
+        checked.fetch_add(last - first, std::memory_order_relaxed);
+    }, cancel.get_token());
+    LOG(COL, NAME, "parallelFor " << (completed ? "completed" : "was cancelled") <<
+        " after checking " << checked.load() << " of " << LIMIT * 100 << " numbers, finding " << found.load() << " primes");
+
+    // A closure that owns a move-only object, which std::function would not
+    // accept
+    auto message = std::make_unique<std::string>("moved into the task");
+    auto length = pool.submit([message = std::move(message)]() {
+        LOG(COL_CYN, "Task", "Holding a string " << *message);
+        return message->size();
+    });
+    LOG(COL, NAME, "The string was " << length.get() << " characters long");
+
+    // An exception thrown by a task is passed back through its future
+    auto failing = pool.submit([]() -> int {
+        std::this_thread::sleep_for(100ms);
+        throw std::runtime_error("The task failed");
+    });
+    try
+    {
+        failing.get();
+    }
+    catch (const std::exception &e)
+    {
+        LOG(COL_RED, NAME, "Caught from the task: " << e.what());
+    }
+
+    // An elastic pool, starting with a single worker. A burst of work grows it
+    // towards its maximum, and once idle it shrinks back to the minimum, with
+    // the spare threads parked rather than ended.
+    {
+        ThreadPool::Limits limits;
+        limits.minThreads = 1;
+        limits.maxThreads = pool.size() * 2;
+        limits.idleTimeout = 500ms;
+        ThreadPool elastic(limits);
+        for (int i = 0; i < 200; ++i)
+        {
+            elastic.post([]() { std::this_thread::sleep_for(10ms); });
+        }
+        std::this_thread::sleep_for(100ms);
+        LOG(COL_YLW, "Elastic", "During the burst: " << elastic.size() <<
+            " workers running, " << elastic.pending() << " tasks queued");
+        std::this_thread::sleep_for(1500ms);
+        LOG(COL_YLW, "Elastic", "Once idle: " << elastic.size() <<
+            " workers running, " << elastic.threads() - elastic.size() << " parked");
+    }
+
+    // Queue more work than can be finished before the deadline, then shut
+    // down. All of the workers drain the queue together.
+    static const int SLOW_TASKS = 40;
+    std::atomic<int> finished{ 0 };
+    for (int i = 0; i < SLOW_TASKS; ++i)
+    {
+        pool.post([&finished]() {
+            std::this_thread::sleep_for(50ms);
+            finished.fetch_add(1);
+        });
+    }
+    LOG(COL, NAME, "Shutting down with " << pool.pending() << " tasks queued");
+    const std::vector<Task> abandoned = pool.shutdown(300ms);
+    LOG(COL, NAME, "Shut down after running " << finished.load() <<
+        " of them, abandoning " << abandoned.size());
+
+    // Nothing more is accepted
+    try
+    {
+        pool.post([]() {});
+    }
+    catch (const std::exception &e)
+    {
+        LOG(COL_RED, NAME, "Refused: " << e.what());
+    }
+
+    LOG(COL, NAME, "About to leave the main thread");
+    return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file    test-work-stealing-pool.cpp
+ *
+ * @brief   Checks that the WorkStealingPool spreads new items across every
+ *          attached worker's queue, for single pushes and for batches, rather
+ *          than leaving the other workers to steal everything from one.
+ *
+ *          Returns non-zero, having said which check failed, on failure.
+ *
+ * @author  Kris Dunning (kris.dunning@itdev.co.uk)
+ * @date    2026
+ */
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../common/work-stealing-pool.h"
+
+/// @brief  The number of workers attached to the pool
+static constexpr std::size_t WORKERS = 4;
+
+/// @brief  The number of checks that have failed
+static int failures = 0;
+
+/// @brief  Reports a failed check
+/// @param  passed  Whether the check passed
+/// @param  what    A description of the check
+static void check(bool passed, const std::string &what)
+{
+    if (!passed)
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+/// @brief  Checks that every worker's queue holds the expected items
+/// @param  pool        The pool to be checked
+/// @param  expected    The number of items expected in each queue
+/// @param  what        A description of how the items were pushed
+static void checkShards(const WorkStealingPool<int> &pool, std::size_t expected,
+    const std::string &what)
+{
+    for (std::size_t slot = 0; slot < WORKERS; ++slot)
+    {
+        check(pool.size(slot) == expected, what + ": worker " +
+            std::to_string(slot) + " holds " + std::to_string(pool.size(slot)) +
+            " items, expected " + std::to_string(expected));
+    }
+}
+
+/// @brief  Main
+int main()
+{
+    // Single items are given to each worker in turn
+    {
+        WorkStealingPool<int> pool(WORKERS);
+        for (std::size_t i = 0; i < WORKERS; ++i)
+        {
+            pool.attach();
+        }
+        for (int i = 0; i < static_cast<int>(WORKERS * 3); ++i)
+        {
+            pool.push(i);
+        }
+        checkShards(pool, 3, "single pushes");
+    }
+
+    // Batches smaller than the number of workers carry on from the worker
+    // after the last one given an item
+    {
+        WorkStealingPool<int> pool(WORKERS);
+        for (std::size_t i = 0; i < WORKERS; ++i)
+        {
+            pool.attach();
+        }
+        for (int i = 0; i < static_cast<int>(WORKERS); ++i)
+        {
+            std::vector<int> batch{ i, i };
+            pool.pushBulk(batch);
+        }
+        checkShards(pool, 2, "batches of two");
+    }
+
+    if (failures == 0)
+    {
+        std::cout << "All checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}